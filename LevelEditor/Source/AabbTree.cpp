@@ -0,0 +1,337 @@
+#include "AabbTree.h"
+#include <algorithm>
+#include <cfloat>
+
+AabbTree::AabbTree()
+{
+	m_root = -1;
+	m_leafCount = 0;
+}
+
+AabbTree::~AabbTree()
+{
+}
+
+void AabbTree::Clear()
+{
+	m_nodes.clear();
+	m_freeNodes.clear();
+	m_root = -1;
+	m_leafCount = 0;
+}
+
+void AabbTree::Build(const std::vector<float>& boxes, std::vector<int>& leaves)
+{
+	Clear();
+
+	int count = (int)(boxes.size() / 6);
+	leaves.resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	// A binary tree over n leaves has n - 1 inner nodes
+	m_nodes.reserve(2 * count - 1);
+	for (int i = 0; i < count; i++)
+	{
+		int leaf = AllocateNode();
+		AabbTreeNode& node = m_nodes[leaf];
+		std::copy(&boxes[i * 6], &boxes[i * 6] + 3, node.min);
+		std::copy(&boxes[i * 6] + 3, &boxes[i * 6] + 6, node.max);
+		node.item = i;
+		leaves[i] = leaf;
+	}
+	m_leafCount = count;
+
+	std::vector<int> work = leaves;
+	m_root = BuildNode(work, 0, count, -1);
+}
+
+int AabbTree::BuildNode(std::vector<int>& leaves, int first, int count, int parent)
+{
+	if (count == 1)
+	{
+		m_nodes[leaves[first]].parent = parent;
+		return leaves[first];
+	}
+
+	int node = AllocateNode();
+	m_nodes[node].parent = parent;
+
+	// Split on the longest axis of the leaves' centres
+	float centreMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float centreMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int i = first; i < first + count; i++)
+	{
+		const AabbTreeNode& leaf = m_nodes[leaves[i]];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float centre = leaf.min[axis] + leaf.max[axis];
+			centreMin[axis] = std::min(centreMin[axis], centre);
+			centreMax[axis] = std::max(centreMax[axis], centre);
+		}
+	}
+
+	int axis = 0;
+	for (int i = 1; i < 3; i++)
+	{
+		if (centreMax[i] - centreMin[i] > centreMax[axis] - centreMin[axis])
+		{
+			axis = i;
+		}
+	}
+
+	int half = count / 2;
+	const std::vector<AabbTreeNode>& nodes = m_nodes;
+	std::nth_element(leaves.begin() + first, leaves.begin() + first + half, leaves.begin() + first + count,
+		[&nodes, axis](int a, int b) { return nodes[a].min[axis] + nodes[a].max[axis] < nodes[b].min[axis] + nodes[b].max[axis]; });
+
+	// Children are built before the box is taken, AllocateNode may have moved m_nodes
+	int left = BuildNode(leaves, first, half, node);
+	int right = BuildNode(leaves, first + half, count - half, node);
+	m_nodes[node].left = left;
+	m_nodes[node].right = right;
+	SetUnion(node);
+	return node;
+}
+
+int AabbTree::Insert(int item, const float min[3], const float max[3])
+{
+	int leaf = AllocateNode();
+	std::copy(min, min + 3, m_nodes[leaf].min);
+	std::copy(max, max + 3, m_nodes[leaf].max);
+	m_nodes[leaf].item = item;
+	m_leafCount++;
+
+	if (m_root == -1)
+	{
+		m_root = leaf;
+		return leaf;
+	}
+
+	// Walk down to the sibling that grows the tree's surface area least, choosing between pairing with the current
+	// node and the cheaper child each step
+	int sibling = m_root;
+	while (!m_nodes[sibling].IsLeaf())
+	{
+		const AabbTreeNode& node = m_nodes[sibling];
+		float unionMin[3], unionMax[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			unionMin[axis] = std::min(node.min[axis], min[axis]);
+			unionMax[axis] = std::max(node.max[axis], max[axis]);
+		}
+		float area = SurfaceArea(node.min, node.max);
+		float unionArea = SurfaceArea(unionMin, unionMax);
+
+		// Pairing here adds a parent as big as the union, going lower still grows this node to it
+		float pairCost = 2.0f * unionArea;
+		float inheritedCost = 2.0f * (unionArea - area);
+
+		float childCosts[2];
+		int children[2] = { node.left, node.right };
+		for (int i = 0; i < 2; i++)
+		{
+			const AabbTreeNode& child = m_nodes[children[i]];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				unionMin[axis] = std::min(child.min[axis], min[axis]);
+				unionMax[axis] = std::max(child.max[axis], max[axis]);
+			}
+			childCosts[i] = SurfaceArea(unionMin, unionMax) + inheritedCost;
+			if (!child.IsLeaf())
+			{
+				childCosts[i] -= SurfaceArea(child.min, child.max);
+			}
+		}
+
+		if (pairCost < childCosts[0] && pairCost < childCosts[1])
+		{
+			break;
+		}
+		sibling = childCosts[0] <= childCosts[1] ? children[0] : children[1];
+	}
+
+	// New parent in the sibling's place, with the sibling and the leaf under it
+	int oldParent = m_nodes[sibling].parent;
+	int parent = AllocateNode();
+	m_nodes[parent].parent = oldParent;
+	m_nodes[parent].left = sibling;
+	m_nodes[parent].right = leaf;
+	m_nodes[sibling].parent = parent;
+	m_nodes[leaf].parent = parent;
+
+	if (oldParent == -1)
+	{
+		m_root = parent;
+	}
+	else if (m_nodes[oldParent].left == sibling)
+	{
+		m_nodes[oldParent].left = parent;
+	}
+	else
+	{
+		m_nodes[oldParent].right = parent;
+	}
+
+	SetUnion(parent);
+	Refit(oldParent);
+	return leaf;
+}
+
+void AabbTree::Remove(int leaf)
+{
+	m_leafCount--;
+	int parent = m_nodes[leaf].parent;
+	FreeNode(leaf);
+
+	if (parent == -1)
+	{
+		m_root = -1;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	int sibling = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+	int grandparent = m_nodes[parent].parent;
+	m_nodes[sibling].parent = grandparent;
+	FreeNode(parent);
+
+	if (grandparent == -1)
+	{
+		m_root = sibling;
+		return;
+	}
+
+	if (m_nodes[grandparent].left == parent)
+	{
+		m_nodes[grandparent].left = sibling;
+	}
+	else
+	{
+		m_nodes[grandparent].right = sibling;
+	}
+	Refit(grandparent);
+}
+
+void AabbTree::Update(int leaf, const float min[3], const float max[3])
+{
+	std::copy(min, min + 3, m_nodes[leaf].min);
+	std::copy(max, max + 3, m_nodes[leaf].max);
+	Refit(m_nodes[leaf].parent);
+}
+
+int AabbTree::GetHeight() const
+{
+	if (m_root == -1)
+	{
+		return 0;
+	}
+
+	int height = 0;
+	std::vector<std::pair<int, int>> stack;
+	stack.push_back(std::make_pair(m_root, 1));
+	while (!stack.empty())
+	{
+		std::pair<int, int> next = stack.back();
+		stack.pop_back();
+		height = std::max(height, next.second);
+
+		const AabbTreeNode& node = m_nodes[next.first];
+		if (!node.IsLeaf())
+		{
+			stack.push_back(std::make_pair(node.left, next.second + 1));
+			stack.push_back(std::make_pair(node.right, next.second + 1));
+		}
+	}
+	return height;
+}
+
+bool AabbTree::RayIntersectsBox(const float origin[3], const float inverseDirection[3], const float min[3], const float max[3], float maxDistance, float& entry)
+{
+	float enter = 0.0f;
+	float leave = maxDistance;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+		enter = std::max(enter, t0);
+		leave = std::min(leave, t1);
+		if (enter > leave)
+		{
+			return false;
+		}
+	}
+
+	entry = enter;
+	return true;
+}
+
+int AabbTree::AllocateNode()
+{
+	int node;
+	if (!m_freeNodes.empty())
+	{
+		node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+	}
+	else
+	{
+		node = (int)m_nodes.size();
+		m_nodes.push_back(AabbTreeNode());
+	}
+
+	m_nodes[node].parent = -1;
+	m_nodes[node].left = -1;
+	m_nodes[node].right = -1;
+	m_nodes[node].item = -1;
+	return node;
+}
+
+void AabbTree::FreeNode(int node)
+{
+	m_freeNodes.push_back(node);
+}
+
+void AabbTree::Refit(int node)
+{
+	while (node != -1)
+	{
+		AabbTreeNode& current = m_nodes[node];
+		float oldMin[3] = { current.min[0], current.min[1], current.min[2] };
+		float oldMax[3] = { current.max[0], current.max[1], current.max[2] };
+		SetUnion(node);
+
+		// Nothing above can change either
+		if (std::equal(oldMin, oldMin + 3, current.min) && std::equal(oldMax, oldMax + 3, current.max))
+		{
+			return;
+		}
+		node = current.parent;
+	}
+}
+
+void AabbTree::SetUnion(int node)
+{
+	AabbTreeNode& parent = m_nodes[node];
+	const AabbTreeNode& left = m_nodes[parent.left];
+	const AabbTreeNode& right = m_nodes[parent.right];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		parent.min[axis] = std::min(left.min[axis], right.min[axis]);
+		parent.max[axis] = std::max(left.max[axis], right.max[axis]);
+	}
+}
+
+float AabbTree::SurfaceArea(const float min[3], const float max[3])
+{
+	float x = max[0] - min[0];
+	float y = max[1] - min[1];
+	float z = max[2] - min[2];
+	return 2.0f * (x * y + y * z + z * x);
+}
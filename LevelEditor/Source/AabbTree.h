@@ -0,0 +1,123 @@
+#pragma once
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Node in an AabbTree. Leaves hold an item, inner nodes have two children and a box around both.
+struct AabbTreeNode
+{
+	float min[3];
+	float max[3];
+	int parent;
+	int left;
+	int right;
+	int item;		// -1 for inner nodes
+
+	bool IsLeaf() const { return left == -1; };
+};
+
+// Dynamic bounding volume hierarchy over axis aligned boxes, e.g. objects' world space bounds. Build makes a balanced
+// tree from scratch for bulk loads, Insert and Remove add and take out single boxes, and Update refits a box that has
+// moved by walking up its ancestors. Leaves are referred to by node index, which doesn't change until they're removed.
+// Doesn't need D3D, so it's used by the editor and the headless benchmark alike.
+class AabbTree
+{
+public:
+	AabbTree();
+	~AabbTree();
+
+	void Clear();
+
+	// Replace the tree with one over boxes[i], item i. Boxes are min x, y, z then max x, y, z. leaves[i] is set to item i's leaf.
+	void Build(const std::vector<float>& boxes, std::vector<int>& leaves);
+
+	// Returns the new leaf
+	int Insert(int item, const float min[3], const float max[3]);
+	void Remove(int leaf);
+
+	// Refit a leaf to its new box
+	void Update(int leaf, const float min[3], const float max[3]);
+
+	// Renumber a leaf's item, e.g. when the items are swap-removed
+	void SetItem(int leaf, int item) { m_nodes[leaf].item = item; };
+
+	// Visit the items whose boxes the ray enters, nearest entry first. visitor(item, entry, maxDistance) is given how far
+	// along the ray the box is entered and may lower maxDistance, boxes entered beyond it are then skipped. direction
+	// needn't be normalised, distances are in multiples of it.
+	template <typename Visitor>
+	void Raycast(const float origin[3], const float direction[3], float maxDistance, Visitor visitor) const;
+
+	// Getters
+	int GetRoot() const { return m_root; };
+	const std::vector<AabbTreeNode>& GetNodes() const { return m_nodes; };
+	int GetLeafCount() const { return m_leafCount; };
+	int GetHeight() const;
+
+	// Slab test, entry is where the ray enters the box
+	static bool RayIntersectsBox(const float origin[3], const float inverseDirection[3], const float min[3], const float max[3], float maxDistance, float& entry);
+
+private:
+	int AllocateNode();
+	void FreeNode(int node);
+
+	// Subtree over leaves [first, first + count) of the work list, split at the median centre on the longest axis
+	int BuildNode(std::vector<int>& leaves, int first, int count, int parent);
+
+	// Recompute boxes from node up to the root, stopping once one doesn't change
+	void Refit(int node);
+	void SetUnion(int node);
+
+	static float SurfaceArea(const float min[3], const float max[3]);
+
+	std::vector<AabbTreeNode> m_nodes;
+	std::vector<int> m_freeNodes;
+	int m_root;
+	int m_leafCount;
+};
+
+template <typename Visitor>
+void AabbTree::Raycast(const float origin[3], const float direction[3], float maxDistance, Visitor visitor) const
+{
+	if (m_root == -1)
+	{
+		return;
+	}
+
+	float inverseDirection[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+	float entry;
+	if (!RayIntersectsBox(origin, inverseDirection, m_nodes[m_root].min, m_nodes[m_root].max, maxDistance, entry))
+	{
+		return;
+	}
+
+	// Nodes waiting to be opened, nearest entry on top. Once the nearest is further than maxDistance the rest are too.
+	typedef std::pair<float, int> QueuedNode;
+	std::priority_queue<QueuedNode, std::vector<QueuedNode>, std::greater<QueuedNode>> queue;
+	queue.push(QueuedNode(entry, m_root));
+
+	while (!queue.empty())
+	{
+		QueuedNode next = queue.top();
+		queue.pop();
+		if (next.first > maxDistance)
+		{
+			break;
+		}
+
+		const AabbTreeNode& node = m_nodes[next.second];
+		if (node.IsLeaf())
+		{
+			visitor(node.item, next.first, maxDistance);
+			continue;
+		}
+
+		int children[2] = { node.left, node.right };
+		for (int child : children)
+		{
+			if (RayIntersectsBox(origin, inverseDirection, m_nodes[child].min, m_nodes[child].max, maxDistance, entry))
+			{
+				queue.push(QueuedNode(entry, child));
+			}
+		}
+	}
+}
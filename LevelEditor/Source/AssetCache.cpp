@@ -0,0 +1,445 @@
+#include "AssetCache.h"
+#include "Game.h"
+#include "Benchmark.h"
+#include <set>
+#include <unordered_map>
+
+using namespace DirectX;
+
+AssetCache::AssetCache()
+{
+}
+
+AssetCache::~AssetCache()
+{
+}
+
+std::shared_ptr<Model> AssetCache::GetModel(ID3D11Device* device, IEffectFactory& effectFactory, const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture)
+{
+	std::shared_ptr<Model> found = FindModel(modelPath, texturePath, texture);
+	if (found)
+	{
+		return found;
+	}
+
+	// Buffers are made straight from the mapped file rather than a copy read into memory
+	CmoReader reader;
+	if (!reader.Open(modelPath.c_str()))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Model> model;
+	try
+	{
+		model = Model::CreateFromCMO(device, reader.GetData(), reader.GetSize(), effectFactory, true);	//"False" for LH coordinate system (maya)
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+
+	return AddModel(device, model, modelPath, texturePath, texture);
+}
+
+std::shared_ptr<Model> AssetCache::FindModel(const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture)
+{
+	auto found = m_models.find(std::make_pair(modelPath, texturePath));
+	if (found == m_models.end())
+	{
+		return nullptr;
+	}
+
+	m_stats.modelHits++;
+	*texture = m_textures[texturePath].view.Get();
+	return found->second.model;
+}
+
+std::shared_ptr<Model> AssetCache::GetModelCopy(ID3D11Device* device, IEffectFactory& effectFactory, const std::shared_ptr<Model>& model)
+{
+	auto pair = m_pairsByModel.find(model.get());
+	if (pair == m_pairsByModel.end())
+	{
+		return nullptr;
+	}
+
+	CachedModel& cached = m_models[pair->second];
+	if (cached.copy)
+	{
+		return cached.copy;
+	}
+
+	// Loaded again rather than cloned, the effect factory doesn't share effects so the copy's are new
+	CmoReader reader;
+	if (!reader.Open(pair->second.first.c_str()))
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Model> copy;
+	try
+	{
+		copy = Model::CreateFromCMO(device, reader.GetData(), reader.GetSize(), effectFactory, true);
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+
+	// The cached model's texture, which stays alive as long as the cached model does
+	ID3D11ShaderResourceView* texture = m_textures[cached.texturePath].view.Get();
+	copy->UpdateEffects([&](IEffect* effect)
+	{
+		auto lights = dynamic_cast<BasicEffect*>(effect);
+		if (lights)
+		{
+			lights->SetTexture(texture);
+		}
+	});
+
+	// Released along with the cached model
+	size_t bytes = GetModelBytes(*copy);
+	cached.copy = copy;
+	cached.bytes += bytes;
+	m_stats.modelBytes += bytes;
+	return copy;
+}
+
+std::shared_ptr<Model> AssetCache::RequestModel(const std::string& modelPath, const std::string& texturePath, float priority, ID3D11ShaderResourceView** texture)
+{
+	std::shared_ptr<Model> model = FindModel(modelPath, texturePath, texture);
+	if (model)
+	{
+		return model;
+	}
+
+	std::pair<std::string, std::string> pair(modelPath, texturePath);
+	if (!m_pending.insert(pair).second)
+	{
+		return nullptr;
+	}
+
+	if (!m_loader.IsRunning())
+	{
+		m_loader.Start(std::max(1, (int)std::thread::hardware_concurrency()));
+	}
+
+	// Each file is read once however many pairs need it
+	if (m_readModels.find(modelPath) == m_readModels.end() && m_requestedModels.insert(modelPath).second)
+	{
+		m_loader.Request(AssetType::MODEL, modelPath, priority);
+	}
+	if (m_textures.find(texturePath) == m_textures.end() && m_requestedTextures.insert(texturePath).second)
+	{
+		m_loader.Request(AssetType::TEXTURE, texturePath, priority);
+	}
+
+	return nullptr;
+}
+
+void AssetCache::SetPriorities(const std::map<std::pair<std::string, std::string>, float>& priorities)
+{
+	// A file is as urgent as the most urgent pair that needs it
+	std::unordered_map<std::string, float> filePriorities;
+	for (const auto& pair : priorities)
+	{
+		const std::string* paths[] = { &pair.first.first, &pair.first.second };
+		for (const std::string* path : paths)
+		{
+			auto found = filePriorities.find(*path);
+			if (found == filePriorities.end() || pair.second < found->second)
+			{
+				filePriorities[*path] = pair.second;
+			}
+		}
+	}
+
+	m_loader.Reprioritize(filePriorities);
+}
+
+void AssetCache::Update(ID3D11Device* device, IEffectFactory& effectFactory, double budgetSeconds, std::vector<std::pair<std::string, std::string>>& finished)
+{
+	if (m_pending.empty())
+	{
+		return;
+	}
+
+	// Make resources from finished files until the frame's budget is spent, the rest wait in the loader's queue
+	BenchmarkTimer timer;
+	std::shared_ptr<LoadedAsset> loaded;
+	while (timer.GetElapsedSeconds() < budgetSeconds && m_loader.PollLoaded(loaded, false))
+	{
+		AddLoaded(device, loaded);
+	}
+
+	CompletePairs(device, effectFactory, finished);
+}
+
+void AssetCache::Preload(ID3D11Device* device, IEffectFactory& effectFactory, const std::vector<SceneObject>& objects, int first, int workerCount)
+{
+	if (!m_loader.IsRunning())
+	{
+		m_loader.Start(workerCount);
+	}
+
+	ID3D11ShaderResourceView* texture;
+	for (size_t i = first; i < objects.size(); i++)
+	{
+		RequestModel(objects[i].model_path, objects[i].tex_diffuse_path, 0.0f, &texture);
+	}
+
+	// The workers keep reading while resources are made here
+	std::vector<std::pair<std::string, std::string>> finished;
+	std::shared_ptr<LoadedAsset> loaded;
+	while (m_loader.PollLoaded(loaded, true))
+	{
+		AddLoaded(device, loaded);
+		CompletePairs(device, effectFactory, finished);
+	}
+	CompletePairs(device, effectFactory, finished);
+}
+
+void AssetCache::AddLoaded(ID3D11Device* device, const std::shared_ptr<LoadedAsset>& loaded)
+{
+	if (loaded->type == AssetType::TEXTURE)
+	{
+		m_requestedTextures.erase(loaded->path);
+		if (m_textures.find(loaded->path) == m_textures.end())
+		{
+			AddTexture(device, loaded->path, loaded.get());
+		}
+	}
+	else
+	{
+		// Kept, failed or not, until the pairs waiting on it are done
+		m_requestedModels.erase(loaded->path);
+		m_readModels[loaded->path] = loaded;
+	}
+}
+
+void AssetCache::CompletePairs(ID3D11Device* device, IEffectFactory& effectFactory, std::vector<std::pair<std::string, std::string>>& finished)
+{
+	for (auto pair = m_pending.begin(); pair != m_pending.end();)
+	{
+		auto model = m_readModels.find(pair->first);
+		bool modelRead = (model != m_readModels.end());
+		bool textureMade = (m_textures.find(pair->second) != m_textures.end());
+
+		if (modelRead && !model->second->success)
+		{
+			// Left uncached, so the objects keep whatever they are showing
+			m_stats.modelFailures++;
+		}
+		else if (modelRead && textureMade)
+		{
+			try
+			{
+				const CmoReader& reader = *model->second->model;
+				std::shared_ptr<Model> created = Model::CreateFromCMO(device, reader.GetData(), reader.GetSize(), effectFactory, true);
+				ID3D11ShaderResourceView* texture;
+				AddModel(device, created, pair->first, pair->second, &texture);
+			}
+			catch (const std::exception&)
+			{
+				m_stats.modelFailures++;
+			}
+		}
+		else
+		{
+			++pair;
+			continue;
+		}
+
+		finished.push_back(*pair);
+		pair = m_pending.erase(pair);
+	}
+
+	// Model files no pair still needs
+	for (auto model = m_readModels.begin(); model != m_readModels.end();)
+	{
+		auto needed = m_pending.lower_bound(std::make_pair(model->first, std::string()));
+		if (needed == m_pending.end() || needed->first != model->first)
+		{
+			model = m_readModels.erase(model);
+		}
+		else
+		{
+			++model;
+		}
+	}
+}
+
+std::shared_ptr<Model> AssetCache::AddModel(ID3D11Device* device, std::shared_ptr<Model> model, const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture)
+{
+	m_stats.modelMisses++;
+
+	//the model has its own effects, so the texture can be set once here rather than for every object
+	CachedTexture& cachedTexture = GetTexture(device, texturePath);
+	cachedTexture.users++;
+	model->UpdateEffects([&](IEffect* effect)
+	{
+		auto lights = dynamic_cast<BasicEffect*>(effect);
+		if (lights)
+		{
+			lights->SetTexture(cachedTexture.view.Get());
+		}
+	});
+
+	CachedModel& cached = m_models[std::make_pair(modelPath, texturePath)];
+	m_pairsByModel[model.get()] = std::make_pair(modelPath, texturePath);
+	cached.model = model;
+	cached.texturePath = texturePath;
+	cached.bytes = GetModelBytes(*model);
+	m_stats.models++;
+	m_stats.modelBytes += cached.bytes;
+
+	*texture = cachedTexture.view.Get();
+	return model;
+}
+
+AssetCache::CachedTexture& AssetCache::GetTexture(ID3D11Device* device, const std::string& path)
+{
+	auto found = m_textures.find(path);
+	if (found != m_textures.end())
+	{
+		m_stats.textureHits++;
+		return found->second;
+	}
+
+	return AddTexture(device, path, NULL);
+}
+
+AssetCache::CachedTexture& AssetCache::AddTexture(ID3D11Device* device, const std::string& path, const LoadedAsset* loaded)
+{
+	m_stats.textureMisses++;
+
+	CachedTexture& cached = m_textures[path];
+	cached.users = 0;
+
+	// From the worker's copy of the file if there is one
+	std::wstring texturewstr = StringToWCHART(path);
+	HRESULT result;
+	if (loaded == NULL)
+	{
+		result = CreateDDSTextureFromFile(device, texturewstr.c_str(), nullptr, cached.view.ReleaseAndGetAddressOf());
+		cached.bytes = GetFileBytes(texturewstr);
+	}
+	else if (loaded->success)
+	{
+		result = CreateDDSTextureFromMemory(device, loaded->data.data(), loaded->data.size(), nullptr, cached.view.ReleaseAndGetAddressOf());
+		cached.bytes = loaded->data.size();
+	}
+	else
+	{
+		result = E_FAIL;
+	}
+
+	//if texture fails, load error default. It's kept under the path asked for so a missing file is only tried once.
+	if (FAILED(result))
+	{
+		texturewstr = L"database/data/Error.dds";
+		CreateDDSTextureFromFile(device, texturewstr.c_str(), nullptr, cached.view.ReleaseAndGetAddressOf());
+		cached.bytes = GetFileBytes(texturewstr);
+	}
+	m_stats.textures++;
+	m_stats.textureBytes += cached.bytes;
+
+	return cached;
+}
+
+void AssetCache::ReleaseUnused()
+{
+	// Only the cache holds it, so no display object does
+	for (auto model = m_models.begin(); model != m_models.end();)
+	{
+		if (model->second.model.use_count() == 1)
+		{
+			m_textures[model->second.texturePath].users--;
+			m_stats.models--;
+			m_stats.modelBytes -= model->second.bytes;
+			m_pairsByModel.erase(model->second.model.get());
+			model = m_models.erase(model);
+		}
+		else
+		{
+			++model;
+		}
+	}
+
+	// Textures still waiting for their model file are kept
+	std::set<std::string> pendingTextures;
+	for (const auto& pair : m_pending)
+	{
+		pendingTextures.insert(pair.second);
+	}
+
+	for (auto texture = m_textures.begin(); texture != m_textures.end();)
+	{
+		if (texture->second.users <= 0 && pendingTextures.find(texture->first) == pendingTextures.end())
+		{
+			m_stats.textures--;
+			m_stats.textureBytes -= texture->second.bytes;
+			texture = m_textures.erase(texture);
+		}
+		else
+		{
+			++texture;
+		}
+	}
+}
+
+void AssetCache::Clear()
+{
+	// Counters carry on, only what is held is reset. Loads in flight are dropped.
+	m_loader.Stop();
+	m_pending.clear();
+	m_requestedModels.clear();
+	m_requestedTextures.clear();
+	m_readModels.clear();
+	m_models.clear();
+	m_pairsByModel.clear();
+	m_textures.clear();
+	m_stats.models = 0;
+	m_stats.textures = 0;
+	m_stats.modelBytes = 0;
+	m_stats.textureBytes = 0;
+}
+
+size_t AssetCache::GetModelBytes(const Model& model)
+{
+	// Parts of a mesh can share buffers, count each once
+	std::set<ID3D11Buffer*> buffers;
+	for (const auto& mesh : model.meshes)
+	{
+		for (const auto& part : mesh->meshParts)
+		{
+			buffers.insert(part->vertexBuffer.Get());
+			buffers.insert(part->indexBuffer.Get());
+		}
+	}
+
+	size_t bytes = 0;
+	for (ID3D11Buffer* buffer : buffers)
+	{
+		if (buffer)
+		{
+			D3D11_BUFFER_DESC desc;
+			buffer->GetDesc(&desc);
+			bytes += desc.ByteWidth;
+		}
+	}
+	return bytes;
+}
+
+size_t AssetCache::GetFileBytes(const std::wstring& path)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return 0;
+	}
+	ULARGE_INTEGER size;
+	size.HighPart = attributes.nFileSizeHigh;
+	size.LowPart = attributes.nFileSizeLow;
+	return (size_t)size.QuadPart;
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include "../pch.h"
+#include "AssetLoader.h"
+#include "SceneObject.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+// Shown in place of a model that is still streaming in
+#define ASSET_PLACEHOLDER_MODEL "database/data/placeholder.cmo"
+#define ASSET_PLACEHOLDER_TEXTURE "database/data/placeholder.dds"
+
+// Seconds per frame spent making D3D resources from streamed files, and between priority updates as the camera moves
+#define ASSET_FRAME_BUDGET 0.004
+#define ASSET_PRIORITY_INTERVAL 0.25f
+
+// Counters for the asset cache. Hits and misses add up over the cache's life, the rest is what is held now.
+struct AssetCacheStats
+{
+	int modelHits;
+	int modelMisses;
+	int textureHits;
+	int textureMisses;
+	int modelFailures;		// streamed models that couldn't be loaded
+	int models;				// model and texture pairs held
+	int textures;			// textures held
+	size_t modelBytes;		// vertex and index buffers
+	size_t textureBytes;	// texture data as read from the DDS files
+
+	AssetCacheStats() : modelHits(0), modelMisses(0), textureHits(0), textureMisses(0), modelFailures(0), models(0), textures(0), modelBytes(0), textureBytes(0) {};
+};
+
+// Loads each model and texture once and hands out shared references, so a level with thousands of the same crate
+// parses one CMO and creates one texture view. The texture is set on a model's effects, so models are shared per
+// model and texture pair and objects with the same mesh but different textures get their own copy.
+// Entries live until ReleaseUnused is called with nothing else referencing them.
+class AssetCache
+{
+public:
+	AssetCache();
+	~AssetCache();
+
+	// Model with the texture applied to its effects. texture is set to the view used, Error.dds if the texture can't be loaded.
+	// Returns null if the model can't be loaded.
+	std::shared_ptr<DirectX::Model> GetModel(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture);
+
+	// The model if it's cached, otherwise null
+	std::shared_ptr<DirectX::Model> FindModel(const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture);
+
+	// Streaming. The model if it's cached, otherwise its files are queued for the worker threads, lowest priority first,
+	// and null is returned. Update reports the pair once it is loaded.
+	std::shared_ptr<DirectX::Model> RequestModel(const std::string& modelPath, const std::string& texturePath, float priority, ID3D11ShaderResourceView** texture);
+
+	// Change the priority of requested pairs that are still loading
+	void SetPriorities(const std::map<std::pair<std::string, std::string>, float>& priorities);
+
+	// Call every frame. Makes resources from finished files for up to budgetSeconds, requested pairs that are now
+	// done are added to finished. A pair that failed is finished but not cached, FindModel returns null for it.
+	void Update(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, double budgetSeconds, std::vector<std::pair<std::string, std::string>>& finished);
+
+	// A copy of a cached model with effects of its own, so one object's material can change without touching every object
+	// sharing the cached one. Made the first time it's asked for and kept with the cached model, so each model and texture
+	// pair is only loaded again once. Returns null if the model isn't from this cache or can't be loaded again.
+	std::shared_ptr<DirectX::Model> GetModelCopy(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, const std::shared_ptr<DirectX::Model>& model);
+
+	// Cooked into by the loader threads as models are read. Set before the first request, it must outlive the cache.
+	void SetCollisionCache(CollisionCache* collisionCache) { m_loader.SetCollisionCache(collisionCache); };
+
+	// Requested pairs still loading
+	int GetPendingCount() const { return (int)m_pending.size(); };
+
+	// Load the models and textures used by objects[first] onwards that aren't cached yet, blocking until they are done.
+	// Files are read and checked on workerCount threads while this thread makes the D3D resources.
+	void Preload(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, const std::vector<SceneObject>& objects, int first, int workerCount);
+
+	// Drop models that no display object holds any more, then textures no model uses
+	void ReleaseUnused();
+
+	// Drop everything, e.g. when the device is lost
+	void Clear();
+
+	const AssetCacheStats& GetStats() const { return m_stats; };
+
+private:
+	struct CachedModel
+	{
+		std::shared_ptr<DirectX::Model> model;
+		std::shared_ptr<DirectX::Model> copy;	// from GetModelCopy, null until asked for
+		std::string texturePath;
+		size_t bytes;
+	};
+
+	struct CachedTexture
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+		int users;		// cached models using it
+		size_t bytes;
+	};
+
+	// Cache a model made from the model path with the texture set on its effects
+	std::shared_ptr<DirectX::Model> AddModel(ID3D11Device* device, std::shared_ptr<DirectX::Model> model, const std::string& modelPath, const std::string& texturePath, ID3D11ShaderResourceView** texture);
+
+	// Texture view, Error.dds if the file can't be loaded. Made from the loader's copy of the file if there is one, otherwise read here.
+	CachedTexture& GetTexture(ID3D11Device* device, const std::string& path);
+	CachedTexture& AddTexture(ID3D11Device* device, const std::string& path, const LoadedAsset* loaded);
+
+	// Take a file from the loader, then make the models for pending pairs that have both their files
+	void AddLoaded(ID3D11Device* device, const std::shared_ptr<LoadedAsset>& loaded);
+	void CompletePairs(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, std::vector<std::pair<std::string, std::string>>& finished);
+
+	static size_t GetModelBytes(const DirectX::Model& model);
+	static size_t GetFileBytes(const std::wstring& path);
+
+	std::map<std::pair<std::string, std::string>, CachedModel> m_models;	// by model and texture path
+	std::unordered_map<const DirectX::Model*, std::pair<std::string, std::string>> m_pairsByModel;	// m_models' keys by model
+	std::map<std::string, CachedTexture> m_textures;						// by path
+
+	AssetCacheStats m_stats;
+
+	// Streaming, the worker threads start the first time there is something to load
+	AssetLoader m_loader;
+	std::set<std::pair<std::string, std::string>> m_pending;			// requested pairs not loaded yet
+	std::set<std::string> m_requestedModels;							// model files with the loader
+	std::set<std::string> m_requestedTextures;							// texture files with the loader
+	std::map<std::string, std::shared_ptr<LoadedAsset>> m_readModels;	// model files read, kept until their pairs are made
+};
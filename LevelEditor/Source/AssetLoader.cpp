@@ -0,0 +1,240 @@
+#include "AssetLoader.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+AssetLoader::AssetLoader()
+{
+	m_pending = 0;
+	m_stop = false;
+	m_collisionCache = nullptr;
+}
+
+AssetLoader::~AssetLoader()
+{
+	Stop();
+}
+
+bool AssetLoader::Start(int workerCount)
+{
+	Stop();
+
+	m_stop = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&AssetLoader::WorkerLoop, this));
+	}
+
+	return true;
+}
+
+void AssetLoader::Stop()
+{
+	if (m_workers.empty())
+	{
+		return;
+	}
+
+	// Reads in progress finish, anything still queued is dropped
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_queue.clear();
+	}
+	m_wake.notify_all();
+	m_space.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	m_loaded.clear();
+	m_pending = 0;
+}
+
+void AssetLoader::Request(AssetType type, const std::string& path, float priority)
+{
+	std::shared_ptr<LoadedAsset> request = std::make_shared<LoadedAsset>();
+	request->type = type;
+	request->path = path;
+	request->priority = priority;
+	request->success = false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(request);
+		m_pending++;
+	}
+	m_wake.notify_one();
+}
+
+bool AssetLoader::PollLoaded(std::shared_ptr<LoadedAsset>& loaded, bool wait)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		if (wait)
+		{
+			m_ready.wait(lock, [this] { return !m_loaded.empty() || m_pending == 0 || m_workers.empty(); });
+		}
+
+		if (m_loaded.empty())
+		{
+			return false;
+		}
+
+		loaded = m_loaded.front();
+		m_loaded.pop_front();
+		m_pending--;
+	}
+	m_space.notify_one();
+
+	return true;
+}
+
+void AssetLoader::Reprioritize(const std::unordered_map<std::string, float>& priorities)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (std::shared_ptr<LoadedAsset>& request : m_queue)
+	{
+		auto found = priorities.find(request->path);
+		if (found != priorities.end())
+		{
+			request->priority = found->second;
+		}
+	}
+}
+
+int AssetLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending;
+}
+
+void AssetLoader::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return !m_queue.empty() || m_stop; });
+
+		if (m_stop)
+		{
+			break;
+		}
+
+		// Most urgent first. Priorities change as the camera moves, so the queue is searched rather than kept sorted.
+		auto next = m_queue.begin();
+		for (auto request = m_queue.begin(); request != m_queue.end(); ++request)
+		{
+			if ((*request)->priority < (*next)->priority)
+			{
+				next = request;
+			}
+		}
+		std::shared_ptr<LoadedAsset> loaded = *next;
+		m_queue.erase(next);
+
+		// Read without holding the lock so the device thread and other workers carry on
+		lock.unlock();
+		LoadFile(*loaded, m_collisionCache);
+		lock.lock();
+
+		// Wait for the device thread to catch up rather than hold any more files in memory
+		m_space.wait(lock, [this] { return m_loaded.size() < ASSET_LOADER_QUEUE_SIZE || m_stop; });
+		if (m_stop)
+		{
+			break;
+		}
+
+		m_loaded.push_back(loaded);
+		m_ready.notify_one();
+	}
+}
+
+void AssetLoader::LoadFile(LoadedAsset& loaded, CollisionCache* collisionCache)
+{
+	loaded.success = false;
+
+	if (loaded.type == AssetType::MODEL)
+	{
+		LoadModel(loaded, collisionCache);
+		return;
+	}
+
+	FILE* pFile = fopen(loaded.path.c_str(), "rb");
+	if (pFile == NULL)
+	{
+		loaded.error = "Can't open " + loaded.path;
+		return;
+	}
+
+	fseek(pFile, 0, SEEK_END);
+	long size = ftell(pFile);
+	fseek(pFile, 0, SEEK_SET);
+
+	loaded.data.resize(size > 0 ? size : 0);
+	size_t read = fread(loaded.data.data(), 1, loaded.data.size(), pFile);
+	fclose(pFile);
+
+	if (size <= 0 || read != loaded.data.size())
+	{
+		loaded.error = "Can't read " + loaded.path;
+		return;
+	}
+
+	// Catch bad files here rather than on the device thread
+	std::string error;
+	if (!CheckTexture(loaded.data, error))
+	{
+		loaded.error = loaded.path + ": " + error;
+		loaded.data.clear();
+		return;
+	}
+
+	loaded.success = true;
+}
+
+void AssetLoader::LoadModel(LoadedAsset& loaded, CollisionCache* collisionCache)
+{
+	// Walking every section checks the whole file here and pages it in, so the device thread makes its buffers
+	// straight from the mapping without waiting on the disk
+	std::shared_ptr<CmoReader> model = std::make_shared<CmoReader>();
+	if (!model->Open(loaded.path.c_str()))
+	{
+		loaded.error = loaded.path + ": " + model->GetError();
+		return;
+	}
+
+	// Cooked here while the file is mapped, so it's in the cache before the device thread hears the model is ready.
+	// An unchanged model already in the cache is only stat'ed.
+	if (collisionCache)
+	{
+		collisionCache->Get(loaded.path, *model);
+	}
+
+	loaded.model = model;
+	loaded.success = true;
+}
+
+bool AssetLoader::CheckTexture(const std::vector<unsigned char>& data, std::string& error)
+{
+	// "DDS " then a 124 byte header that starts with its own size
+	uint32_t headerSize;
+	if (data.size() < 4 + 124 || memcmp(data.data(), "DDS ", 4) != 0)
+	{
+		error = "not a DDS file";
+		return false;
+	}
+
+	memcpy(&headerSize, data.data() + 4, sizeof(headerSize));
+	if (headerSize != 124)
+	{
+		error = "bad DDS header";
+		return false;
+	}
+
+	return true;
+}
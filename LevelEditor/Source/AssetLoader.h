@@ -0,0 +1,86 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include "CmoReader.h"
+#include "CollisionCache.h"
+
+// Finished loads waiting for the device thread. Workers stop reading once this many are waiting,
+// so the files held in memory stay bounded however far the device thread falls behind.
+#define ASSET_LOADER_QUEUE_SIZE 32
+
+enum class AssetType
+{
+	MODEL,		// .cmo
+	TEXTURE		// .dds
+};
+
+// A file read and checked by a worker, ready for the device thread to create resources from
+struct LoadedAsset
+{
+	AssetType type;
+	std::string path;
+	float priority;		// lowest is read first
+	std::vector<unsigned char> data;		// textures
+	std::shared_ptr<CmoReader> model;		// models are mapped and walked in place rather than read
+
+	bool success;
+	std::string error;
+};
+
+// Reads and checks model and texture files on worker threads. D3D resources can only be made on the device thread,
+// so finished files are handed back through a bounded queue and the device thread does the rest. Models are cooked
+// into the collision cache while they're mapped, so picking never waits for them on the device thread.
+class AssetLoader
+{
+public:
+	AssetLoader();
+	~AssetLoader();
+
+	bool Start(int workerCount);
+	void Stop();
+	bool IsRunning() { return !m_workers.empty(); };
+
+	// Cache models are cooked into as they're read, null to skip cooking. Set before Start, it must outlive the workers.
+	void SetCollisionCache(CollisionCache* collisionCache) { m_collisionCache = collisionCache; };
+
+	// Device thread. Queue a file to be read, lowest priority first.
+	void Request(AssetType type, const std::string& path, float priority = 0.0f);
+
+	// Device thread. Change the priority of files still waiting to be read, e.g. as the camera moves.
+	void Reprioritize(const std::unordered_map<std::string, float>& priorities);
+
+	// Device thread. Collect the next finished file. With wait set, blocks until one is ready.
+	// Returns false if there isn't one, or when waiting, if nothing is left to load.
+	bool PollLoaded(std::shared_ptr<LoadedAsset>& loaded, bool wait);
+
+	// Requested and not yet collected
+	int GetPendingCount();
+
+private:
+	void WorkerLoop();
+
+	// Read the file and check it
+	static void LoadFile(LoadedAsset& loaded, CollisionCache* collisionCache);
+	static void LoadModel(LoadedAsset& loaded, CollisionCache* collisionCache);
+
+	static bool CheckTexture(const std::vector<unsigned char>& data, std::string& error);
+
+	// Shared with the workers, guarded by the mutex
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;		// workers, a request or stop
+	std::condition_variable m_space;	// workers, room in the loaded queue
+	std::condition_variable m_ready;	// device thread, a finished load
+	std::deque<std::shared_ptr<LoadedAsset>> m_queue;
+	std::deque<std::shared_ptr<LoadedAsset>> m_loaded;
+	int m_pending;
+	bool m_stop;
+
+	CollisionCache* m_collisionCache;
+};
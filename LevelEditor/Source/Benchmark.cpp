@@ -0,0 +1,72 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <ctime>
+#include <sstream>
+
+Benchmark::Benchmark()
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+void Benchmark::Add(const std::string& suite, const std::string& name, int objectCount, double seconds)
+{
+	BenchmarkResult result;
+	result.suite = suite;
+	result.name = name;
+	result.objectCount = objectCount;
+	result.seconds = seconds;
+	result.itemsPerSecond = seconds > 0 ? objectCount / seconds : 0;
+	m_results.push_back(result);
+}
+
+bool Benchmark::WriteCSV(const char* path) const
+{
+	// Check if the file already exists so the header is only written once
+	FILE* pFile = fopen(path, "r");
+	bool newFile = (pFile == NULL);
+	if (pFile)
+	{
+		fclose(pFile);
+	}
+
+	pFile = fopen(path, "a");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	if (newFile)
+	{
+		fprintf(pFile, "timestamp,suite,name,objects,seconds,items_per_second\n");
+	}
+
+	// Every row from this run shares a timestamp so runs can be compared release over release
+	long long timestamp = (long long)time(NULL);
+	for (const BenchmarkResult& result : m_results)
+	{
+		fprintf(pFile, "%lld,%s,%s,%d,%.6f,%.1f\n", timestamp, result.suite.c_str(), result.name.c_str(), result.objectCount, result.seconds, result.itemsPerSecond);
+	}
+
+	fclose(pFile);
+	return true;
+}
+
+std::wstring Benchmark::GetSummary() const
+{
+	std::wstringstream summary;
+	summary.precision(4);
+
+	for (const BenchmarkResult& result : m_results)
+	{
+		summary << std::wstring(result.suite.begin(), result.suite.end()) << L" / "
+			<< std::wstring(result.name.begin(), result.name.end()) << L" ("
+			<< result.objectCount << L" objects): "
+			<< result.seconds << L"s, "
+			<< (long long)result.itemsPerSecond << L"/s\n";
+	}
+
+	return summary.str();
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <chrono>
+
+// Simple wall clock timer used for timing tool operations
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer() { Start(); };
+
+	void Start() { m_start = std::chrono::steady_clock::now(); };
+	double GetElapsedSeconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count(); };
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
+
+// A single timed measurement
+struct BenchmarkResult
+{
+	std::string suite;		// group the measurement belongs to, e.g. "save"
+	std::string name;		// what was measured, e.g. "bulk"
+	int objectCount;		// size of the data set
+	double seconds;			// time taken
+	double itemsPerSecond;	// throughput
+};
+
+// Collects benchmark results and writes them out in a machine readable format
+class Benchmark
+{
+public:
+	Benchmark();
+	~Benchmark();
+
+	// Record a result, throughput is worked out from the object count
+	void Add(const std::string& suite, const std::string& name, int objectCount, double seconds);
+
+	// Append all results to a csv file, header is written if the file is new
+	bool WriteCSV(const char* path) const;
+
+	// Human readable summary for displaying in a message box
+	std::wstring GetSummary() const;
+
+	const std::vector<BenchmarkResult>& GetResults() const { return m_results; };
+	void Clear() { m_results.clear(); };
+
+private:
+	std::vector<BenchmarkResult> m_results;
+};
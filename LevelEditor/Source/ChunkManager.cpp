@@ -0,0 +1,300 @@
+#include "ChunkManager.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+ChunkManager::ChunkManager()
+{
+	m_pinnedChunkID = -1;
+	m_residentMemory = 0;
+	m_stop = false;
+}
+
+ChunkManager::~ChunkManager()
+{
+	Stop();
+}
+
+bool ChunkManager::Start(const char* databasePath, const std::vector<ChunkObject>& chunks, int pinnedChunkID, int workerCount)
+{
+	Stop();
+
+	m_databasePath = databasePath;
+	m_pinnedChunkID = pinnedChunkID;
+	for (const ChunkObject& chunk : chunks)
+	{
+		m_chunks[chunk.ID] = chunk;
+	}
+
+	m_stop = false;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&ChunkManager::WorkerLoop, this));
+	}
+
+	return true;
+}
+
+void ChunkManager::Stop()
+{
+	if (m_workers.empty())
+	{
+		return;
+	}
+
+	// Loads in progress finish, anything still queued is dropped
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+		m_queue.clear();
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	m_loaded.clear();
+	m_chunks.clear();
+	m_lru.clear();
+	m_lruPositions.clear();
+	m_residentBytes.clear();
+	m_residentMemory = 0;
+	m_requested.clear();
+	m_failed.clear();
+}
+
+void ChunkManager::Update(float cameraX, float cameraZ, std::vector<int>& evicted)
+{
+	// Chunks in the square around the camera, nearest first so they are loaded first
+	ChunkCoord centre = GetCoordAt(cameraX, cameraZ);
+	std::vector<std::pair<int, int>> wanted;	// distance squared, ID
+
+	for (int z = centre.z - CHUNK_WORKING_SET_RADIUS; z <= centre.z + CHUNK_WORKING_SET_RADIUS; z++)
+	{
+		for (int x = centre.x - CHUNK_WORKING_SET_RADIUS; x <= centre.x + CHUNK_WORKING_SET_RADIUS; x++)
+		{
+			if (x < 0 || x >= CHUNK_GRID_WIDTH || z < 0)
+			{
+				continue;
+			}
+
+			int ID = z * CHUNK_GRID_WIDTH + x;
+			if (ID != m_pinnedChunkID && m_chunks.find(ID) != m_chunks.end())
+			{
+				int dx = x - centre.x;
+				int dz = z - centre.z;
+				wanted.push_back(std::make_pair(dx * dx + dz * dz, ID));
+			}
+		}
+	}
+	std::sort(wanted.begin(), wanted.end());
+
+	std::unordered_set<int> workingSet;
+	std::vector<int> requests;
+	for (const std::pair<int, int>& chunk : wanted)
+	{
+		int ID = chunk.second;
+		workingSet.insert(ID);
+
+		if (m_residentBytes.find(ID) != m_residentBytes.end())
+		{
+			Touch(ID);
+		}
+		else if (m_requested.find(ID) == m_requested.end() && m_failed.find(ID) == m_failed.end())
+		{
+			requests.push_back(ID);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Drop queued loads the camera has moved away from
+		for (auto it = m_queue.begin(); it != m_queue.end();)
+		{
+			if (workingSet.find(*it) == workingSet.end())
+			{
+				m_requested.erase(*it);
+				it = m_queue.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+
+		for (int ID : requests)
+		{
+			m_queue.push_back(ID);
+			m_requested.insert(ID);
+		}
+	}
+
+	if (!requests.empty())
+	{
+		m_wake.notify_all();
+	}
+
+	// Evict least recently used chunks outside the working set until back under budget
+	auto it = m_lru.end();
+	while (m_residentMemory > CHUNK_MEMORY_BUDGET && it != m_lru.begin())
+	{
+		--it;
+		int ID = *it;
+		if (workingSet.find(ID) == workingSet.end())
+		{
+			it = m_lru.erase(it);
+			Evict(ID);
+			evicted.push_back(ID);
+		}
+	}
+}
+
+bool ChunkManager::PollLoaded(std::shared_ptr<LoadedChunk>& loaded)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		if (m_loaded.empty())
+		{
+			return false;
+		}
+
+		loaded = m_loaded.front();
+		m_loaded.pop_front();
+	}
+
+	int ID = loaded->chunk.ID;
+	m_requested.erase(ID);
+
+	if (!loaded->success)
+	{
+		m_failed.insert(ID);
+	}
+	else if (m_residentBytes.find(ID) == m_residentBytes.end())
+	{
+		m_residentBytes[ID] = loaded->memoryBytes;
+		m_residentMemory += loaded->memoryBytes;
+		m_lru.push_front(ID);
+		m_lruPositions[ID] = m_lru.begin();
+	}
+
+	return true;
+}
+
+ChunkCoord ChunkManager::GetChunkCoord(int chunkID)
+{
+	ChunkCoord coord;
+	coord.x = chunkID % CHUNK_GRID_WIDTH;
+	coord.z = chunkID / CHUNK_GRID_WIDTH;
+	return coord;
+}
+
+ChunkCoord ChunkManager::GetCoordAt(float x, float z)
+{
+	// Chunks are centred on their origin, so offset by half a chunk before rounding down
+	ChunkCoord coord;
+	coord.x = (int)std::floor((x + CHUNK_SIZE_METRES * 0.5f) / CHUNK_SIZE_METRES);
+	coord.z = (int)std::floor((z + CHUNK_SIZE_METRES * 0.5f) / CHUNK_SIZE_METRES);
+	return coord;
+}
+
+void ChunkManager::GetChunkOrigin(int chunkID, float& x, float& z)
+{
+	ChunkCoord coord = GetChunkCoord(chunkID);
+	x = coord.x * CHUNK_SIZE_METRES;
+	z = coord.z * CHUNK_SIZE_METRES;
+}
+
+void ChunkManager::WorkerLoop()
+{
+	// sqlite connections aren't shared between threads, so each worker has its own
+	SceneDatabase database;
+	bool databaseOpen = database.Open(m_databasePath.c_str());
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return !m_queue.empty() || m_stop; });
+
+		if (m_stop)
+		{
+			break;
+		}
+
+		int ID = m_queue.front();
+		m_queue.pop_front();
+
+		std::shared_ptr<LoadedChunk> loaded = std::make_shared<LoadedChunk>();
+		loaded->chunk = m_chunks[ID];
+
+		// Load without holding the lock so the main thread and other workers carry on
+		lock.unlock();
+
+		if (databaseOpen)
+		{
+			LoadChunk(&database, *loaded);
+		}
+		else
+		{
+			loaded->success = false;
+			loaded->error = database.GetLastError();
+		}
+
+		lock.lock();
+		m_loaded.push_back(loaded);
+	}
+}
+
+void ChunkManager::LoadChunk(SceneDatabase* database, LoadedChunk& loaded)
+{
+	loaded.success = false;
+	loaded.memoryBytes = 0;
+
+	FILE* pFile = fopen(loaded.chunk.heightmap_path.c_str(), "rb");
+	if (pFile == NULL)
+	{
+		loaded.error = "Can't find the height map " + loaded.chunk.heightmap_path;
+		return;
+	}
+
+	loaded.heightMap.resize(TERRAINRESOLUTION * TERRAINRESOLUTION);
+	size_t read = fread(loaded.heightMap.data(), 1, loaded.heightMap.size(), pFile);
+	fclose(pFile);
+
+	if (read != loaded.heightMap.size())
+	{
+		loaded.error = "Height map is too small " + loaded.chunk.heightmap_path;
+		return;
+	}
+
+	if (!database->LoadObjectsInChunk(loaded.chunk.ID, loaded.objects))
+	{
+		loaded.error = database->GetLastError();
+		return;
+	}
+
+	// Heightmap, the vertices built from it and the objects. Their strings are interned and shared, so not counted.
+	loaded.memoryBytes = loaded.heightMap.size() * (1 + CHUNK_VERTEX_BYTES) + loaded.objects.size() * sizeof(SceneObject);
+
+	loaded.success = true;
+}
+
+void ChunkManager::Touch(int chunkID)
+{
+	auto position = m_lruPositions.find(chunkID);
+	if (position != m_lruPositions.end())
+	{
+		m_lru.splice(m_lru.begin(), m_lru, position->second);
+	}
+}
+
+void ChunkManager::Evict(int chunkID)
+{
+	m_residentMemory -= m_residentBytes[chunkID];
+	m_residentBytes.erase(chunkID);
+	m_lruPositions.erase(chunkID);
+}
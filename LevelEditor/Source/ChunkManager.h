@@ -0,0 +1,104 @@
+#pragma once
+#include "ChunkObject.h"
+#include "SceneObject.h"
+#include "SceneDatabase.h"
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Width of a chunk in metres, matches the terrain size in DisplayChunk
+#define CHUNK_SIZE_METRES 512.0f
+
+// Chunks are laid out on a grid by ID, this many to a row. Chunk 0 is centred on the origin.
+#define CHUNK_GRID_WIDTH 64
+
+// Chunks within this many grid cells of the camera are kept resident
+#define CHUNK_WORKING_SET_RADIUS 1
+
+// Once resident chunks cost more than this, the least recently used ones outside the working set are evicted
+#define CHUNK_MEMORY_BUDGET (256 * 1024 * 1024)
+
+// Bytes per terrain vertex once built for display, the size of DirectX::VertexPositionNormalTexture
+#define CHUNK_VERTEX_BYTES 32
+
+struct ChunkCoord
+{
+	int x;
+	int z;
+};
+
+// Everything a worker loads for one chunk
+struct LoadedChunk
+{
+	ChunkObject chunk;
+	std::vector<unsigned char> heightMap;
+	std::vector<SceneObject> objects;
+
+	bool success;
+	std::string error;
+	size_t memoryBytes;		// estimate of what the chunk costs once it is resident
+};
+
+// Keeps the chunks around the camera resident. Heightmaps and objects are loaded on worker threads,
+// each with its own database connection, and handed back to the main thread to be built for display.
+// The chunk being edited is pinned: the tool loads it itself and it is never evicted.
+class ChunkManager
+{
+public:
+	ChunkManager();
+	~ChunkManager();
+
+	bool Start(const char* databasePath, const std::vector<ChunkObject>& chunks, int pinnedChunkID, int workerCount = 2);
+	void Stop();
+	bool IsRunning() { return !m_workers.empty(); };
+
+	// Call every frame. Queues loads for the working set around the camera, nearest first, and evicts chunks
+	// over the memory budget. Evicted chunk IDs are added to evicted so their display data can be released.
+	void Update(float cameraX, float cameraZ, std::vector<int>& evicted);
+
+	// Collect the next finished load, returns false if there isn't one. Successful loads become resident.
+	bool PollLoaded(std::shared_ptr<LoadedChunk>& loaded);
+
+	// Getters
+	size_t GetResidentMemory() { return m_residentMemory; };
+	int GetResidentCount() { return (int)m_residentBytes.size(); };
+
+	// Grid layout
+	static ChunkCoord GetChunkCoord(int chunkID);
+	static ChunkCoord GetCoordAt(float x, float z);
+	static void GetChunkOrigin(int chunkID, float& x, float& z);	// centre of the chunk in world space
+
+private:
+	void WorkerLoop();
+	void LoadChunk(SceneDatabase* database, LoadedChunk& loaded);
+	void Touch(int chunkID);	// move to the front of the LRU list
+	void Evict(int chunkID);
+
+	// Set in Start, read only after
+	std::string m_databasePath;
+	std::unordered_map<int, ChunkObject> m_chunks;
+	int m_pinnedChunkID;
+
+	// Main thread only
+	std::list<int> m_lru;												// resident chunks, most recently wanted first
+	std::unordered_map<int, std::list<int>::iterator> m_lruPositions;
+	std::unordered_map<int, size_t> m_residentBytes;
+	size_t m_residentMemory;
+	std::unordered_set<int> m_requested;								// queued or being loaded
+	std::unordered_set<int> m_failed;									// not retried, the error is reported once
+
+	// Shared with the workers, guarded by the mutex
+	std::vector<std::thread> m_workers;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<int> m_queue;
+	std::deque<std::shared_ptr<LoadedChunk>> m_loaded;
+	bool m_stop;
+};
@@ -2,6 +2,9 @@
 
 #include <string>
 
+//geometric resoltuion - note,  hard coded. Heightmaps are TERRAINRESOLUTION x TERRAINRESOLUTION bytes.
+#define TERRAINRESOLUTION 128
+
 class ChunkObject
 {
 public:
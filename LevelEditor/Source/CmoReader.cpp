@@ -0,0 +1,310 @@
+#include "CmoReader.h"
+#include <cfloat>
+
+// Fixed size parts of the format that are skipped over
+#define CMO_MATERIAL_SIZE 132		// ambient, diffuse, specular, specular power, emissive, UV transform
+#define CMO_MATERIAL_TEXTURES 8
+#define CMO_SKINNING_VERTEX_SIZE 32	// four bone indices and weights
+#define CMO_BONE_SIZE 196			// parent index and three matrices
+#define CMO_CLIP_SIZE 12			// start time, end time, keyframe count
+#define CMO_KEYFRAME_SIZE 72		// bone index, time and a matrix
+
+static_assert(sizeof(CmoVertex) == 52, "CmoVertex must match the file");
+static_assert(sizeof(CmoSubmesh) == 20, "CmoSubmesh must match the file");
+static_assert(sizeof(CmoExtents) == 40, "CmoExtents must match the file");
+
+CmoReader::CmoReader()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_offset = 0;
+}
+
+CmoReader::~CmoReader()
+{
+	Close();
+}
+
+bool CmoReader::Open(const char* path)
+{
+	Close();
+
+	if (!m_file.Open(path))
+	{
+		m_error = "can't open the file";
+		return false;
+	}
+
+	return Parse(m_file.GetData(), m_file.GetSize());
+}
+
+bool CmoReader::Parse(const unsigned char* data, size_t size)
+{
+	m_data = data;
+	m_size = size;
+	m_offset = 0;
+	m_meshes.clear();
+	m_error.clear();
+
+	uint32_t meshCount;
+	if (!ReadUInt(meshCount) || meshCount == 0)
+	{
+		return Fail("not a model");
+	}
+
+	// Each mesh takes at least a few bytes, so a huge count is caught before anything is allocated for it
+	if (meshCount > m_size / sizeof(uint32_t))
+	{
+		return Fail("bad mesh count");
+	}
+
+	m_meshes.resize(meshCount);
+	for (CmoMesh& mesh : m_meshes)
+	{
+		if (!ParseMesh(mesh))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void CmoReader::Close()
+{
+	m_meshes.clear();
+	m_file.Close();
+	m_data = NULL;
+	m_size = 0;
+	m_offset = 0;
+}
+
+void CmoReader::GetBounds(float min[3], float max[3]) const
+{
+	for (int i = 0; i < 3; i++)
+	{
+		min[i] = FLT_MAX;
+		max[i] = -FLT_MAX;
+	}
+
+	for (const CmoMesh& mesh : m_meshes)
+	{
+		CmoExtents extents;
+		memcpy(&extents, mesh.extents, sizeof(extents));
+		float meshMin[3] = { extents.minX, extents.minY, extents.minZ };
+		float meshMax[3] = { extents.maxX, extents.maxY, extents.maxZ };
+		for (int i = 0; i < 3; i++)
+		{
+			min[i] = meshMin[i] < min[i] ? meshMin[i] : min[i];
+			max[i] = meshMax[i] > max[i] ? meshMax[i] : max[i];
+		}
+	}
+}
+
+size_t CmoReader::GetTriangleCount() const
+{
+	size_t count = 0;
+	for (const CmoMesh& mesh : m_meshes)
+	{
+		for (const CmoSubmesh& submesh : mesh.submeshes)
+		{
+			count += submesh.primCount;
+		}
+	}
+	return count;
+}
+
+bool CmoReader::ReadUInt(uint32_t& value)
+{
+	if (m_size - m_offset < sizeof(value))
+	{
+		return false;
+	}
+
+	memcpy(&value, m_data + m_offset, sizeof(value));
+	m_offset += sizeof(value);
+	return true;
+}
+
+bool CmoReader::ReadName(CmoArray<uint16_t>& name)
+{
+	uint32_t length;
+	return ReadUInt(length) && ReadArray(length, name);
+}
+
+bool CmoReader::Skip(uint64_t bytes)
+{
+	if (m_size - m_offset < bytes)
+	{
+		return false;
+	}
+
+	m_offset += (size_t)bytes;
+	return true;
+}
+
+template <typename T>
+bool CmoReader::ReadArray(uint64_t count, CmoArray<T>& array)
+{
+	// Checked in 64 bits so a huge count can't wrap round
+	if (count > (m_size - m_offset) / sizeof(T))
+	{
+		return false;
+	}
+
+	array = CmoArray<T>(reinterpret_cast<const T*>(m_data + m_offset), (size_t)count);
+	m_offset += (size_t)count * sizeof(T);
+	return true;
+}
+
+bool CmoReader::ParseMesh(CmoMesh& mesh)
+{
+	uint32_t count;
+	CmoArray<uint16_t> name;
+
+	if (!ReadName(mesh.name))
+	{
+		return Fail("truncated mesh name");
+	}
+
+	// Materials, the renderer's effect factory reads these so they are only stepped over
+	if (!ReadUInt(count))
+	{
+		return Fail("truncated materials");
+	}
+	mesh.materialCount = (int)count;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		if (!ReadName(name) || !Skip(CMO_MATERIAL_SIZE) || !ReadName(name))
+		{
+			return Fail("truncated material");
+		}
+		for (int texture = 0; texture < CMO_MATERIAL_TEXTURES; texture++)
+		{
+			if (!ReadName(name))
+			{
+				return Fail("truncated material textures");
+			}
+		}
+	}
+
+	CmoArray<unsigned char> skeleton;
+	if (!ReadArray(1, skeleton))
+	{
+		return Fail("truncated mesh");
+	}
+	mesh.skeleton = (skeleton[0] != 0);
+
+	if (!ReadUInt(count) || !ReadArray(count, mesh.submeshes))
+	{
+		return Fail("truncated submeshes");
+	}
+
+	if (!ReadUInt(count) || count > (m_size - m_offset) / sizeof(uint32_t))
+	{
+		return Fail("truncated index buffers");
+	}
+	mesh.indexBuffers.resize(count);
+	for (CmoArray<uint16_t>& indices : mesh.indexBuffers)
+	{
+		if (!ReadUInt(count) || !ReadArray(count, indices))
+		{
+			return Fail("truncated index buffer");
+		}
+	}
+
+	if (!ReadUInt(count) || count > (m_size - m_offset) / sizeof(uint32_t))
+	{
+		return Fail("truncated vertex buffers");
+	}
+	mesh.vertexBuffers.resize(count);
+	for (CmoArray<CmoVertex>& vertices : mesh.vertexBuffers)
+	{
+		if (!ReadUInt(count) || !ReadArray(count, vertices))
+		{
+			return Fail("truncated vertex buffer");
+		}
+	}
+
+	// Skinning weights, one buffer per vertex buffer
+	uint32_t skinningBuffers;
+	if (!ReadUInt(skinningBuffers))
+	{
+		return Fail("truncated skinning");
+	}
+	for (uint32_t i = 0; i < skinningBuffers; i++)
+	{
+		if (!ReadUInt(count) || !Skip((uint64_t)count * CMO_SKINNING_VERTEX_SIZE))
+		{
+			return Fail("truncated skinning buffer");
+		}
+	}
+
+	CmoArray<CmoExtents> extents;
+	if (!ReadArray(1, extents))
+	{
+		return Fail("truncated extents");
+	}
+	mesh.extents = extents.data;
+
+	if (mesh.skeleton)
+	{
+		if (!ReadUInt(count))
+		{
+			return Fail("truncated bones");
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (!ReadName(name) || !Skip(CMO_BONE_SIZE))
+			{
+				return Fail("truncated bone");
+			}
+		}
+
+		if (!ReadUInt(count))
+		{
+			return Fail("truncated animation clips");
+		}
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint32_t keyframes;
+			if (!ReadName(name) || !Skip(CMO_CLIP_SIZE - sizeof(keyframes)) || !ReadUInt(keyframes) || !Skip((uint64_t)keyframes * CMO_KEYFRAME_SIZE))
+			{
+				return Fail("truncated animation clip");
+			}
+		}
+	}
+
+	// Submeshes are walked without further checks, so every index they reach must be in range
+	for (const CmoSubmesh& submesh : mesh.submeshes)
+	{
+		if (submesh.indexBufferIndex >= mesh.indexBuffers.size() || submesh.vertexBufferIndex >= mesh.vertexBuffers.size())
+		{
+			return Fail("submesh buffer out of range");
+		}
+
+		const CmoArray<uint16_t>& indices = mesh.indexBuffers[submesh.indexBufferIndex];
+		if ((uint64_t)submesh.startIndex + (uint64_t)submesh.primCount * 3 > indices.size())
+		{
+			return Fail("submesh indices out of range");
+		}
+
+		size_t vertexCount = mesh.vertexBuffers[submesh.vertexBufferIndex].size();
+		for (size_t i = 0; i < (size_t)submesh.primCount * 3; i++)
+		{
+			if (indices[submesh.startIndex + i] >= vertexCount)
+			{
+				return Fail("vertex index out of range");
+			}
+		}
+	}
+
+	return true;
+}
+
+bool CmoReader::Fail(const char* error)
+{
+	m_error = error;
+	m_meshes.clear();
+	return false;
+}
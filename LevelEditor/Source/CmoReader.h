@@ -0,0 +1,145 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// A run of elements inside the mapped file, nothing is copied. Sections can start on any byte, so elements are
+// read with memcpy rather than through a T reference unless T is one of the packed structs below.
+template <typename T>
+struct CmoArray
+{
+	const T* data;
+	size_t count;
+
+	CmoArray() : data(NULL), count(0) {};
+	CmoArray(const T* data, size_t count) : data(data), count(count) {};
+
+	const T* begin() const { return data; };
+	const T* end() const { return data + count; };
+	T operator[](size_t i) const { T value; memcpy(&value, data + i, sizeof(T)); return value; };
+	size_t size() const { return count; };
+	bool empty() const { return count == 0; };
+};
+
+// Layouts as written by the Visual Studio model exporter, read in place. Packed because the sections aren't aligned.
+#pragma pack(push, 1)
+struct CmoVertex
+{
+	float position[3];
+	float normal[3];
+	float tangent[4];
+	uint32_t color;
+	float texCoord[2];
+};
+
+struct CmoSubmesh
+{
+	uint32_t materialIndex;
+	uint32_t indexBufferIndex;
+	uint32_t vertexBufferIndex;
+	uint32_t startIndex;
+	uint32_t primCount;		// triangles
+};
+
+struct CmoExtents
+{
+	float centerX, centerY, centerZ;
+	float radius;
+	float minX, minY, minZ;
+	float maxX, maxY, maxZ;
+};
+#pragma pack(pop)
+
+struct CmoMesh
+{
+	CmoArray<uint16_t> name;		// UTF-16
+	int materialCount;
+	bool skeleton;
+	CmoArray<CmoSubmesh> submeshes;
+	std::vector<CmoArray<uint16_t>> indexBuffers;
+	std::vector<CmoArray<CmoVertex>> vertexBuffers;
+	const CmoExtents* extents;
+};
+
+// Reads a .cmo model by mapping the file and pointing into it, so vertex and index data goes from the page cache
+// to wherever it's needed without being copied on the way. Every count and offset is checked against the file size
+// before anything is pointed at, so a bad file fails Open rather than reading off the end.
+// Doesn't need D3D, the device side hands GetData to DirectXTK to make the GPU buffers.
+class CmoReader
+{
+public:
+	CmoReader();
+	~CmoReader();
+
+	// Map and walk the file. False with GetError set if it isn't a model.
+	bool Open(const char* path);
+
+	// Walk a model already in memory, which must outlive the reader
+	bool Parse(const unsigned char* data, size_t size);
+
+	void Close();
+
+	// Getters
+	const unsigned char* GetData() const { return m_data; };
+	size_t GetSize() const { return m_size; };
+	const std::vector<CmoMesh>& GetMeshes() const { return m_meshes; };
+	const std::string& GetError() const { return m_error; };
+
+	// Model space box around every mesh, from the extents the exporter wrote
+	void GetBounds(float min[3], float max[3]) const;
+
+	// Triangles across every submesh, three corners of three floats each
+	size_t GetTriangleCount() const;
+	template <typename Function>
+	void ForEachTriangle(Function function) const;
+
+private:
+	// Not copyable, the meshes point into the mapping
+	CmoReader(const CmoReader&);
+	CmoReader& operator=(const CmoReader&);
+
+	// Cursor over m_data, each fails once the file runs out
+	bool ReadUInt(uint32_t& value);
+	bool ReadName(CmoArray<uint16_t>& name);
+	bool Skip(uint64_t bytes);
+	template <typename T>
+	bool ReadArray(uint64_t count, CmoArray<T>& array);
+
+	bool ParseMesh(CmoMesh& mesh);
+	bool Fail(const char* error);
+
+	MappedFile m_file;
+	const unsigned char* m_data;
+	size_t m_size;
+	size_t m_offset;
+
+	std::vector<CmoMesh> m_meshes;
+	std::string m_error;
+};
+
+template <typename Function>
+void CmoReader::ForEachTriangle(Function function) const
+{
+	for (const CmoMesh& mesh : m_meshes)
+	{
+		for (const CmoSubmesh& submesh : mesh.submeshes)
+		{
+			const CmoArray<uint16_t>& indices = mesh.indexBuffers[submesh.indexBufferIndex];
+			const CmoArray<CmoVertex>& vertices = mesh.vertexBuffers[submesh.vertexBufferIndex];
+			for (uint32_t i = 0; i < submesh.primCount; i++)
+			{
+				// Only the positions are copied out, see CmoArray
+				float corners[3][3];
+				for (int c = 0; c < 3; c++)
+				{
+					const CmoVertex* vertex = vertices.data + indices[submesh.startIndex + i * 3 + c];
+					memcpy(corners[c], vertex->position, sizeof(corners[c]));
+				}
+				function(corners[0], corners[1], corners[2]);
+			}
+		}
+	}
+}
@@ -0,0 +1,344 @@
+#include "CollisionCache.h"
+#include "MappedFile.h"
+#include <cstdio>
+#include <cstring>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Layout: header, then for each model its path length, path, size, modified time and hash, then for each mesh its
+// hash, byte count and CollisionMesh::Write bytes
+struct CollisionCacheHeader
+{
+	char magic[4];			// "LCOL"
+	uint32_t version;		// COLLISION_CACHE_VERSION
+	uint32_t modelCount;
+	uint32_t meshCount;
+	uint64_t payloadSize;
+	uint64_t checksum;		// HashContents of the payload
+};
+
+static const char s_cacheMagic[4] = { 'L', 'C', 'O', 'L' };
+
+// Bounds checked reads from the payload, each fails once it runs out
+struct PayloadReader
+{
+	const unsigned char* data;
+	size_t size;
+	size_t offset;
+
+	bool Read(void* value, size_t bytes)
+	{
+		if (size - offset < bytes)
+		{
+			return false;
+		}
+		memcpy(value, data + offset, bytes);
+		offset += bytes;
+		return true;
+	}
+
+	bool Skip(uint64_t bytes, const unsigned char*& start)
+	{
+		if (size - offset < bytes)
+		{
+			return false;
+		}
+		start = data + offset;
+		offset += (size_t)bytes;
+		return true;
+	}
+};
+
+template <typename T>
+static void Append(std::string& bytes, const T& value)
+{
+	bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+CollisionCache::CollisionCache()
+{
+	m_modified = false;
+	m_hits = 0;
+	m_cooked = 0;
+}
+
+CollisionCache::~CollisionCache()
+{
+}
+
+bool CollisionCache::Load(const char* path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_models.clear();
+	m_meshes.clear();
+	m_checked.clear();
+	m_modified = false;
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		m_lastError = "No collision cache";
+		return false;
+	}
+
+	CollisionCacheHeader header;
+	if (file.GetSize() < sizeof(header))
+	{
+		m_lastError = "Collision cache is truncated";
+		return false;
+	}
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	if (memcmp(header.magic, s_cacheMagic, sizeof(s_cacheMagic)) != 0 || header.version != COLLISION_CACHE_VERSION)
+	{
+		m_lastError = "Collision cache is from a different version";
+		return false;
+	}
+
+	PayloadReader reader = { file.GetData() + sizeof(header), file.GetSize() - sizeof(header), 0 };
+	if (header.payloadSize != reader.size || HashContents(reader.data, reader.size) != header.checksum)
+	{
+		m_lastError = "Collision cache checksum doesn't match";
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.modelCount; i++)
+	{
+		uint32_t pathLength;
+		const unsigned char* pathData;
+		ModelStamp stamp;
+		if (!reader.Read(&pathLength, sizeof(pathLength)) || !reader.Skip(pathLength, pathData)
+			|| !reader.Read(&stamp.size, sizeof(stamp.size)) || !reader.Read(&stamp.modified, sizeof(stamp.modified)) || !reader.Read(&stamp.hash, sizeof(stamp.hash)))
+		{
+			m_models.clear();
+			m_lastError = "Collision cache model list is damaged";
+			return false;
+		}
+		m_models[std::string(reinterpret_cast<const char*>(pathData), pathLength)] = stamp;
+	}
+
+	for (uint32_t i = 0; i < header.meshCount; i++)
+	{
+		uint64_t hash;
+		uint64_t byteCount;
+		const unsigned char* bytes;
+		std::shared_ptr<CollisionMesh> mesh = std::make_shared<CollisionMesh>();
+		if (!reader.Read(&hash, sizeof(hash)) || !reader.Read(&byteCount, sizeof(byteCount)) || !reader.Skip(byteCount, bytes)
+			|| !mesh->Read(bytes, (size_t)byteCount))
+		{
+			m_models.clear();
+			m_meshes.clear();
+			m_lastError = "Collision cache mesh is damaged";
+			return false;
+		}
+		m_meshes[hash] = mesh;
+	}
+
+	return true;
+}
+
+bool CollisionCache::Save(const char* path)
+{
+	// The payload is put together under the lock and written outside it, so workers can carry on cooking
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_modified)
+	{
+		return true;
+	}
+	m_modified = false;
+
+	std::string payload;
+	for (const auto& model : m_models)
+	{
+		Append(payload, (uint32_t)model.first.size());
+		payload.append(model.first);
+		Append(payload, model.second.size);
+		Append(payload, model.second.modified);
+		Append(payload, model.second.hash);
+	}
+
+	std::string meshBytes;
+	for (const auto& mesh : m_meshes)
+	{
+		meshBytes.clear();
+		mesh.second->Write(meshBytes);
+		Append(payload, mesh.first);
+		Append(payload, (uint64_t)meshBytes.size());
+		payload.append(meshBytes);
+	}
+
+	CollisionCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, s_cacheMagic, sizeof(s_cacheMagic));
+	header.version = COLLISION_CACHE_VERSION;
+	header.modelCount = (uint32_t)m_models.size();
+	header.meshCount = (uint32_t)m_meshes.size();
+	header.payloadSize = payload.size();
+	header.checksum = HashContents(reinterpret_cast<const unsigned char*>(payload.data()), payload.size());
+	lock.unlock();
+
+	// Write to a temporary file and swap it in, so a crash part way through never leaves a half written cache
+	std::string tempPath = std::string(path) + ".tmp";
+	FILE* pFile = fopen(tempPath.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		lock.lock();
+		m_modified = true;
+		m_lastError = "Can't create " + tempPath;
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, pFile) == 1
+		&& (payload.empty() || fwrite(payload.data(), payload.size(), 1, pFile) == 1);
+	written = (fclose(pFile) == 0) && written;
+
+	remove(path);
+	if (!written || rename(tempPath.c_str(), path) != 0)
+	{
+		remove(tempPath.c_str());
+		lock.lock();
+		m_modified = true;
+		m_lastError = std::string("Can't write ") + path;
+		return false;
+	}
+
+	return true;
+}
+
+std::shared_ptr<const CollisionMesh> CollisionCache::Get(const std::string& modelPath)
+{
+	return Check(modelPath, nullptr);
+}
+
+std::shared_ptr<const CollisionMesh> CollisionCache::Get(const std::string& modelPath, const CmoReader& model)
+{
+	return Check(modelPath, &model);
+}
+
+bool CollisionCache::Lookup(const std::string& modelPath, std::shared_ptr<const CollisionMesh>& mesh)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto checked = m_checked.find(modelPath);
+	if (checked == m_checked.end())
+	{
+		return false;
+	}
+
+	m_hits++;
+	mesh = checked->second;
+	return true;
+}
+
+std::shared_ptr<const CollisionMesh> CollisionCache::Check(const std::string& modelPath, const CmoReader* opened)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto checked = m_checked.find(modelPath);
+		if (checked != m_checked.end())
+		{
+			m_hits++;
+			return checked->second;
+		}
+	}
+
+	std::shared_ptr<const CollisionMesh> mesh = Find(modelPath, opened);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_checked[modelPath] = mesh;
+	return mesh;
+}
+
+std::shared_ptr<const CollisionMesh> CollisionCache::Find(const std::string& modelPath, const CmoReader* opened)
+{
+	ModelStamp current;
+	if (!ReadModelStamp(modelPath.c_str(), current))
+	{
+		return nullptr;
+	}
+
+	// Unchanged since it was last hashed, the file doesn't need opening
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto model = m_models.find(modelPath);
+		if (model != m_models.end() && model->second.size == current.size && model->second.modified == current.modified)
+		{
+			auto mesh = m_meshes.find(model->second.hash);
+			if (mesh != m_meshes.end())
+			{
+				m_hits++;
+				return mesh->second;
+			}
+		}
+	}
+
+	CmoReader reader;
+	if (opened == nullptr)
+	{
+		if (!reader.Open(modelPath.c_str()))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_lastError = modelPath + ": " + reader.GetError();
+			return nullptr;
+		}
+		opened = &reader;
+	}
+
+	current.hash = HashContents(opened->GetData(), opened->GetSize());
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_models[modelPath] = current;
+		m_modified = true;
+
+		// Touched but not changed, or a copy of a model already cooked
+		auto mesh = m_meshes.find(current.hash);
+		if (mesh != m_meshes.end())
+		{
+			m_hits++;
+			return mesh->second;
+		}
+	}
+
+	std::shared_ptr<CollisionMesh> cooked = std::make_shared<CollisionMesh>();
+	cooked->Build(*opened);
+
+	// Another worker may have cooked a copy of the same model meanwhile, the first one in is kept
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto inserted = m_meshes.insert(std::make_pair(current.hash, std::shared_ptr<const CollisionMesh>(cooked)));
+	if (inserted.second)
+	{
+		m_cooked++;
+	}
+	return inserted.first->second;
+}
+
+bool CollisionCache::ReadModelStamp(const char* path, ModelStamp& stamp)
+{
+	memset(&stamp, 0, sizeof(stamp));
+
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(path, &info) != 0)
+#else
+	struct stat info;
+	if (stat(path, &info) != 0)
+#endif
+	{
+		return false;
+	}
+	stamp.size = (uint64_t)info.st_size;
+	stamp.modified = (int64_t)info.st_mtime;
+	return true;
+}
+
+uint64_t CollisionCache::HashContents(const unsigned char* data, size_t size)
+{
+	// FNV-1a, 64 bit so different models don't share a key
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
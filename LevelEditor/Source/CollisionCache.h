@@ -0,0 +1,76 @@
+#pragma once
+#include "CollisionMesh.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Bump whenever CollisionMesh's cooking or layout changes, old caches are then ignored
+#define COLLISION_CACHE_VERSION 1
+#define COLLISION_CACHE_PATH "database/data/collision.cache"
+
+// Size and modified time of a model file, checked before trusting the content hash recorded for its path
+struct ModelStamp
+{
+	uint64_t size;
+	int64_t modified;
+	uint64_t hash;		// FNV-1a of the file's contents
+};
+
+// Cooked collision meshes for every model that has been asked for, kept in one file in database/data.
+// Meshes are keyed by a hash of the .cmo's contents, so copies of a model under other names share an entry and an
+// edited model is cooked again. Each model path also records the file's size and modified time, so while those
+// match the mesh comes straight from the cache and the model file is never opened. A path is only checked the first
+// time it's asked for, later calls are a lookup.
+// The asset loader's workers cook while the device thread looks meshes up, so every call is guarded by a mutex and
+// hashing and cooking happen outside it.
+class CollisionCache
+{
+public:
+	CollisionCache();
+	~CollisionCache();
+
+	// Read the cache file. Returns false, with the cache left empty, if it's missing, damaged or from another version.
+	bool Load(const char* path);
+
+	// Write the cache file if anything has been cooked since it was loaded
+	bool Save(const char* path);
+
+	// Collision mesh for the model, cooked and added if it's new or has changed. Null if the model can't be read.
+	std::shared_ptr<const CollisionMesh> Get(const std::string& modelPath);
+
+	// The same, for a model the caller has already opened, so it isn't mapped a second time
+	std::shared_ptr<const CollisionMesh> Get(const std::string& modelPath, const CmoReader& model);
+
+	// Never touches the file. False if the path hasn't been checked yet, otherwise mesh is set to what Get returned.
+	bool Lookup(const std::string& modelPath, std::shared_ptr<const CollisionMesh>& mesh);
+
+	// Entries in the cache, by content hash. Not guarded, only for use while nothing else is cooking.
+	const std::map<uint64_t, std::shared_ptr<const CollisionMesh>>& GetMeshes() const { return m_meshes; };
+
+	// Counters since construction
+	int GetHits() const { std::lock_guard<std::mutex> lock(m_mutex); return m_hits; };
+	int GetCooked() const { std::lock_guard<std::mutex> lock(m_mutex); return m_cooked; };
+
+	std::string GetLastError() const { std::lock_guard<std::mutex> lock(m_mutex); return m_lastError; };
+
+	static bool ReadModelStamp(const char* path, ModelStamp& stamp);
+	static uint64_t HashContents(const unsigned char* data, size_t size);
+
+private:
+	// Check the model file against its stamp, cooking it if it's new or has changed. opened is null if the file still needs mapping.
+	std::shared_ptr<const CollisionMesh> Check(const std::string& modelPath, const CmoReader* opened);
+	std::shared_ptr<const CollisionMesh> Find(const std::string& modelPath, const CmoReader* opened);
+
+	mutable std::mutex m_mutex;
+	std::map<std::string, ModelStamp> m_models;							// by model path
+	std::map<uint64_t, std::shared_ptr<const CollisionMesh>> m_meshes;	// by content hash
+	std::unordered_map<std::string, std::shared_ptr<const CollisionMesh>> m_checked;	// paths already checked, null if they couldn't be read
+
+	bool m_modified;
+	int m_hits;
+	int m_cooked;
+	std::string m_lastError;
+};
@@ -0,0 +1,359 @@
+#include "CollisionMesh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+// Layout of a written mesh: these counts, the origin and step, then the positions, indices and nodes
+struct CollisionMeshHeader
+{
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+	uint32_t nodeCount;
+	uint32_t padding;
+	float origin[3];
+	float step[3];
+};
+
+CollisionMesh::CollisionMesh()
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		m_origin[axis] = 0.0f;
+		m_step[axis] = 0.0f;
+	}
+}
+
+CollisionMesh::~CollisionMesh()
+{
+}
+
+void CollisionMesh::Build(const CmoReader& model)
+{
+	m_positions.clear();
+	m_indices.clear();
+	m_nodes.clear();
+
+	// Quantize across the model's own extents, so precision follows the model's size
+	float min[3], max[3];
+	model.GetBounds(min, max);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (!(min[axis] <= max[axis]))
+		{
+			min[axis] = max[axis] = 0.0f;
+		}
+		m_origin[axis] = min[axis];
+		m_step[axis] = (max[axis] - min[axis]) / 65535.0f;
+	}
+
+	// Weld corners that quantize to the same point, normals and UVs split vertices the collision mesh doesn't need
+	std::map<std::tuple<uint16_t, uint16_t, uint16_t>, uint32_t> welded;
+	model.ForEachTriangle([&](const float* vertex0, const float* vertex1, const float* vertex2)
+	{
+		const float* corners[3] = { vertex0, vertex1, vertex2 };
+		for (const float* corner : corners)
+		{
+			uint16_t quantized[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float steps = m_step[axis] > 0.0f ? (corner[axis] - m_origin[axis]) / m_step[axis] : 0.0f;
+				quantized[axis] = (uint16_t)std::min(std::max(floorf(steps + 0.5f), 0.0f), 65535.0f);
+			}
+
+			auto key = std::make_tuple(quantized[0], quantized[1], quantized[2]);
+			auto found = welded.find(key);
+			if (found == welded.end())
+			{
+				found = welded.insert(std::make_pair(key, (uint32_t)GetVertexCount())).first;
+				m_positions.insert(m_positions.end(), quantized, quantized + 3);
+			}
+			m_indices.push_back(found->second);
+		}
+	});
+
+	if (m_indices.empty())
+	{
+		return;
+	}
+
+	std::vector<float> centroids(GetTriangleCount() * 3);
+	for (uint32_t triangle = 0; triangle < GetTriangleCount(); triangle++)
+	{
+		float vertices[3][3];
+		GetTriangle(triangle, vertices[0], vertices[1], vertices[2]);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			centroids[triangle * 3 + axis] = (vertices[0][axis] + vertices[1][axis] + vertices[2][axis]) / 3.0f;
+		}
+	}
+
+	// Only nodes over COLLISION_LEAF_SIZE are split, so every leaf has at least two triangles and there are no more nodes than triangles
+	m_nodes.reserve(GetTriangleCount());
+	m_nodes.push_back(CollisionNode());
+	BuildNode(0, 0, (uint32_t)GetTriangleCount(), centroids);
+}
+
+void CollisionMesh::BuildNode(uint32_t node, uint32_t first, uint32_t count, std::vector<float>& centroids)
+{
+	GetTriangleBounds(first, count, m_nodes[node].min, m_nodes[node].max);
+
+	if (count <= COLLISION_LEAF_SIZE)
+	{
+		m_nodes[node].first = first;
+		m_nodes[node].count = count;
+		return;
+	}
+
+	// Split at the median centroid along the axis the centroids spread furthest on
+	float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (uint32_t triangle = first; triangle < first + count; triangle++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			min[axis] = std::min(min[axis], centroids[triangle * 3 + axis]);
+			max[axis] = std::max(max[axis], centroids[triangle * 3 + axis]);
+		}
+	}
+	int splitAxis = 0;
+	for (int axis = 1; axis < 3; axis++)
+	{
+		if (max[axis] - min[axis] > max[splitAxis] - min[splitAxis])
+		{
+			splitAxis = axis;
+		}
+	}
+
+	// Triangles and their centroids are moved together, so sort an order and apply it to both
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		order[i] = first + i;
+	}
+	uint32_t half = count / 2;
+	std::nth_element(order.begin(), order.begin() + half, order.end(), [&](uint32_t a, uint32_t b)
+	{
+		return centroids[a * 3 + splitAxis] < centroids[b * 3 + splitAxis];
+	});
+
+	std::vector<uint32_t> indices(count * 3);
+	std::vector<float> sortedCentroids(count * 3);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		std::copy(m_indices.begin() + order[i] * 3, m_indices.begin() + order[i] * 3 + 3, indices.begin() + i * 3);
+		std::copy(centroids.begin() + order[i] * 3, centroids.begin() + order[i] * 3 + 3, sortedCentroids.begin() + i * 3);
+	}
+	std::copy(indices.begin(), indices.end(), m_indices.begin() + first * 3);
+	std::copy(sortedCentroids.begin(), sortedCentroids.end(), centroids.begin() + first * 3);
+
+	// Left child follows its parent, the right child goes after the whole left subtree
+	m_nodes[node].count = 0;
+	uint32_t left = (uint32_t)m_nodes.size();
+	m_nodes.push_back(CollisionNode());
+	BuildNode(left, first, half, centroids);
+
+	uint32_t right = (uint32_t)m_nodes.size();
+	m_nodes.push_back(CollisionNode());
+	m_nodes[node].first = right;
+	BuildNode(right, first + half, count - half, centroids);
+}
+
+void CollisionMesh::GetTriangleBounds(uint32_t first, uint32_t count, float min[3], float max[3]) const
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		min[axis] = FLT_MAX;
+		max[axis] = -FLT_MAX;
+	}
+
+	for (uint32_t i = first * 3; i < (first + count) * 3; i++)
+	{
+		float position[3];
+		GetVertex(m_indices[i], position);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			min[axis] = std::min(min[axis], position[axis]);
+			max[axis] = std::max(max[axis], position[axis]);
+		}
+	}
+}
+
+void CollisionMesh::GetVertex(uint32_t index, float position[3]) const
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		position[axis] = m_origin[axis] + m_positions[index * 3 + axis] * m_step[axis];
+	}
+}
+
+void CollisionMesh::GetTriangle(uint32_t triangle, float vertex0[3], float vertex1[3], float vertex2[3]) const
+{
+	GetVertex(m_indices[triangle * 3], vertex0);
+	GetVertex(m_indices[triangle * 3 + 1], vertex1);
+	GetVertex(m_indices[triangle * 3 + 2], vertex2);
+}
+
+void CollisionMesh::GetBounds(float min[3], float max[3]) const
+{
+	if (m_nodes.empty())
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			min[axis] = max[axis] = 0.0f;
+		}
+		return;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		min[axis] = m_nodes[0].min[axis];
+		max[axis] = m_nodes[0].max[axis];
+	}
+}
+
+void CollisionMesh::Write(std::string& bytes) const
+{
+	CollisionMeshHeader header;
+	memset(&header, 0, sizeof(header));
+	header.vertexCount = (uint32_t)GetVertexCount();
+	header.triangleCount = (uint32_t)GetTriangleCount();
+	header.nodeCount = (uint32_t)m_nodes.size();
+	memcpy(header.origin, m_origin, sizeof(m_origin));
+	memcpy(header.step, m_step, sizeof(m_step));
+
+	bytes.append(reinterpret_cast<const char*>(&header), sizeof(header));
+	bytes.append(reinterpret_cast<const char*>(m_positions.data()), m_positions.size() * sizeof(uint16_t));
+	bytes.append(reinterpret_cast<const char*>(m_indices.data()), m_indices.size() * sizeof(uint32_t));
+	bytes.append(reinterpret_cast<const char*>(m_nodes.data()), m_nodes.size() * sizeof(CollisionNode));
+}
+
+bool CollisionMesh::Read(const unsigned char* bytes, size_t size)
+{
+	CollisionMeshHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, bytes, sizeof(header));
+
+	uint64_t positionsSize = (uint64_t)header.vertexCount * 3 * sizeof(uint16_t);
+	uint64_t indicesSize = (uint64_t)header.triangleCount * 3 * sizeof(uint32_t);
+	uint64_t nodesSize = (uint64_t)header.nodeCount * sizeof(CollisionNode);
+	if (sizeof(header) + positionsSize + indicesSize + nodesSize != size)
+	{
+		return false;
+	}
+
+	memcpy(m_origin, header.origin, sizeof(m_origin));
+	memcpy(m_step, header.step, sizeof(m_step));
+
+	const unsigned char* data = bytes + sizeof(header);
+	m_positions.resize(header.vertexCount * 3);
+	memcpy(m_positions.data(), data, (size_t)positionsSize);
+	data += positionsSize;
+	m_indices.resize(header.triangleCount * 3);
+	memcpy(m_indices.data(), data, (size_t)indicesSize);
+	data += indicesSize;
+	m_nodes.resize(header.nodeCount);
+	memcpy(m_nodes.data(), data, (size_t)nodesSize);
+
+	// Queries walk the nodes and indices without checks
+	std::string error;
+	return Validate(error);
+}
+
+bool CollisionMesh::Validate(std::string& error) const
+{
+	for (uint32_t index : m_indices)
+	{
+		if (index >= GetVertexCount())
+		{
+			error = "vertex index out of range";
+			return false;
+		}
+	}
+
+	if (m_nodes.empty())
+	{
+		if (!m_indices.empty())
+		{
+			error = "triangles without a BVH";
+			return false;
+		}
+		return true;
+	}
+
+	// Walk from the root, every triangle must be reached exactly once
+	std::vector<uint32_t> stack(1, 0);
+	std::vector<uint32_t> parents(1, 0);
+	uint32_t trianglesReached = 0;
+	uint32_t nodesReached = 0;
+	while (!stack.empty())
+	{
+		uint32_t index = stack.back();
+		uint32_t parentIndex = parents.back();
+		stack.pop_back();
+		parents.pop_back();
+
+		if (index >= m_nodes.size() || ++nodesReached > m_nodes.size())
+		{
+			error = "node out of range";
+			return false;
+		}
+
+		const CollisionNode& node = m_nodes[index];
+		const CollisionNode& parent = m_nodes[parentIndex];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (node.min[axis] < parent.min[axis] || node.max[axis] > parent.max[axis])
+			{
+				error = "node outside its parent";
+				return false;
+			}
+		}
+
+		if (node.IsLeaf())
+		{
+			if (node.first != trianglesReached || (uint64_t)node.first + node.count > GetTriangleCount())
+			{
+				error = "leaf triangles out of order";
+				return false;
+			}
+			trianglesReached += node.count;
+
+			float min[3], max[3];
+			GetTriangleBounds(node.first, node.count, min, max);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (min[axis] < node.min[axis] || max[axis] > node.max[axis])
+				{
+					error = "triangle outside its leaf";
+					return false;
+				}
+			}
+		}
+		else
+		{
+			// Right pushed first so the left subtree's triangles are reached first
+			stack.push_back(node.first);
+			parents.push_back(index);
+			stack.push_back(index + 1);
+			parents.push_back(index);
+		}
+	}
+
+	if (trianglesReached != GetTriangleCount())
+	{
+		error = "triangles not in the BVH";
+		return false;
+	}
+
+	return true;
+}
+
+size_t CollisionMesh::GetBytes() const
+{
+	return m_positions.size() * sizeof(uint16_t) + m_indices.size() * sizeof(uint32_t) + m_nodes.size() * sizeof(CollisionNode);
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "CmoReader.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Triangles per BVH leaf. Small leaves mean more nodes but fewer triangle tests per ray.
+#define COLLISION_LEAF_SIZE 4
+
+// Box around a run of triangles. Leaves have a count and their triangles start at first, inner nodes have a count
+// of 0, their left child straight after them and their right child at first.
+struct CollisionNode
+{
+	float min[3];
+	float max[3];
+	uint32_t first;
+	uint32_t count;
+
+	bool IsLeaf() const { return count != 0; };
+};
+
+// A model's triangles cooked for picking and snapping: positions quantized to 16 bits a axis across the model's
+// bounds, welded indices, and a BVH built over them. Node boxes are made from the quantized positions, so they
+// always contain the triangles as they are stored. Everything is in model space.
+class CollisionMesh
+{
+public:
+	CollisionMesh();
+	~CollisionMesh();
+
+	// Cook from a model's mapped file
+	void Build(const CmoReader& model);
+
+	// Flat binary copy for the collision cache. Read checks every index so a bad entry is rejected.
+	void Write(std::string& bytes) const;
+	bool Read(const unsigned char* bytes, size_t size);
+
+	// Getters
+	size_t GetVertexCount() const { return m_positions.size() / 3; };
+	size_t GetTriangleCount() const { return m_indices.size() / 3; };
+	const std::vector<CollisionNode>& GetNodes() const { return m_nodes; };
+	void GetVertex(uint32_t index, float position[3]) const;
+	void GetTriangle(uint32_t triangle, float vertex0[3], float vertex1[3], float vertex2[3]) const;
+	void GetBounds(float min[3], float max[3]) const;
+
+	// Structure checks for the validate command: indices in range, every triangle inside its leaf and every node inside its parent.
+	// Returns false with the first problem in error.
+	bool Validate(std::string& error) const;
+
+	// Memory held, for reporting
+	size_t GetBytes() const;
+
+private:
+	// Split triangles [first, first + count) of m_indices under node, depth first
+	void BuildNode(uint32_t node, uint32_t first, uint32_t count, std::vector<float>& centroids);
+	void GetTriangleBounds(uint32_t first, uint32_t count, float min[3], float max[3]) const;
+
+	float m_origin[3];		// position of quantized 0
+	float m_step[3];		// size of one quantized step
+	std::vector<uint16_t> m_positions;		// x, y, z a vertex
+	std::vector<uint32_t> m_indices;		// three a triangle, in leaf order
+	std::vector<CollisionNode> m_nodes;		// root first
+};
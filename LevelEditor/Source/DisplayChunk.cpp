@@ -14,15 +14,25 @@ DisplayChunk::DisplayChunk()
 	m_textureCoordStep = 1.0 / (TERRAINRESOLUTION-1);	//-1 becuase its split into chunks. not vertices.  we want tthe last one in each row to have tex coord 1
 	m_terrainPositionScalingFactor = m_terrainSize / (TERRAINRESOLUTION-1);
 	m_sculptScale = 10;
+	m_heightMapDirty = false;
+	m_texture_diffuse = NULL;
+	m_chunkID = 0;
+	m_originX = 0;
+	m_originZ = 0;
 }
 
 
 DisplayChunk::~DisplayChunk()
 {
+	if (m_texture_diffuse)
+	{
+		m_texture_diffuse->Release();
+	}
 }
 
 void DisplayChunk::PopulateChunkData(ChunkObject * SceneChunk)
 {
+	m_chunkID = SceneChunk->ID;
 	m_name = SceneChunk->name;
 	m_chunk_x_size_metres = SceneChunk->chunk_x_size_metres;
 	m_chunk_y_size_metres = SceneChunk->chunk_y_size_metres;
@@ -72,7 +82,7 @@ void DisplayChunk::InitialiseBatch()
 		for (size_t j = 0; j < TERRAINRESOLUTION; j++)
 		{
 			index = (TERRAINRESOLUTION * i) + j;
-			m_terrainGeometry[i][j].position =			Vector3(j*m_terrainPositionScalingFactor-(0.5*m_terrainSize), (float)(m_heightMap[index])*m_terrainHeightScale, i*m_terrainPositionScalingFactor-(0.5*m_terrainSize));	//This will create a terrain going from -64->64.  rather than 0->128.  So the center of the terrain is on the origin
+			m_terrainGeometry[i][j].position =			Vector3(m_originX + j*m_terrainPositionScalingFactor-(0.5*m_terrainSize), (float)(m_heightMap[index])*m_terrainHeightScale, m_originZ + i*m_terrainPositionScalingFactor-(0.5*m_terrainSize));	//This will create a terrain going from -64->64.  rather than 0->128.  So the center of the terrain is on the chunk's origin
 			m_terrainGeometry[i][j].normal =			Vector3(0.0f, 1.0f, 0.0f);						//standard y =up
 			m_terrainGeometry[i][j].textureCoordinate =	Vector2(((float)m_textureCoordStep*j)*m_tex_diffuse_tiling, ((float)m_textureCoordStep*i)*m_tex_diffuse_tiling);				//Spread tex coords so that its distributed evenly across the terrain from 0-1
 			
@@ -84,9 +94,6 @@ void DisplayChunk::InitialiseBatch()
 
 void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources)
 {
-	auto device = DevResources->GetD3DDevice();
-	auto devicecontext = DevResources->GetD3DDeviceContext();
-
 	//load in heightmap .raw
 	FILE *pFile = NULL;
 
@@ -106,10 +113,30 @@ void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResour
 	fread(m_heightMap, 1, TERRAINRESOLUTION*TERRAINRESOLUTION, pFile);
 
 	fclose(pFile);
+	m_heightMapDirty = false;
 
-	//load in texture diffuse
-	
-	//load the diffuse texture
+	CreateRenderResources(DevResources);
+}
+
+void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources, const std::vector<BYTE>& heightMap)
+{
+	memcpy(m_heightMap, heightMap.data(), std::min(heightMap.size(), sizeof(m_heightMap)));
+	m_heightMapDirty = false;
+
+	CreateRenderResources(DevResources);
+}
+
+void DisplayChunk::CreateRenderResources(std::shared_ptr<DX::DeviceResources>  DevResources)
+{
+	auto device = DevResources->GetD3DDevice();
+	auto devicecontext = DevResources->GetD3DDeviceContext();
+
+	//load the diffuse texture, releasing the one from a previous load
+	if (m_texture_diffuse)
+	{
+		m_texture_diffuse->Release();
+		m_texture_diffuse = NULL;
+	}
 	std::wstring texturewstr = StringToWCHART(m_tex_diffuse_path);
 	HRESULT rs;	
 	rs = CreateDDSTextureFromFile(device, texturewstr.c_str(), NULL, &m_texture_diffuse);	//load tex into Shader resource	view and resource
@@ -132,7 +159,7 @@ void DisplayChunk::LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResour
 			VertexPositionNormalTexture::InputElementCount,
 			shaderByteCode,
 			byteCodeLength,
-			m_terrainInputLayout.GetAddressOf())
+			m_terrainInputLayout.ReleaseAndGetAddressOf())
 		);
 
 	m_batch = std::make_unique<PrimitiveBatch<VertexPositionNormalTexture>>(devicecontext);
@@ -161,9 +188,27 @@ void DisplayChunk::SaveHeightMap()
 
 	fwrite(m_heightMap, 1, TERRAINRESOLUTION*TERRAINRESOLUTION, pFile);
 	fclose(pFile);
+	m_heightMapDirty = false;
 	
 }
 
+void DisplayChunk::CopyHeightMap(std::vector<BYTE>& heightMap)
+{
+	heightMap.assign(m_heightMap, m_heightMap + TERRAINRESOLUTION*TERRAINRESOLUTION);
+}
+
+void DisplayChunk::SetHeightMap(const std::vector<BYTE>& heightMap)
+{
+	if (heightMap.size() != TERRAINRESOLUTION*TERRAINRESOLUTION)
+	{
+		return;
+	}
+
+	memcpy(m_heightMap, heightMap.data(), heightMap.size());
+	m_heightMapDirty = true;
+	UpdateTerrain();
+}
+
 void DisplayChunk::UpdateTerrain()
 {
 	//all this is doing is transferring the height from the heigtmap into the terrain geometry.
@@ -195,6 +240,7 @@ void DisplayChunk::GenerateHeightmap(int index, float magnitude)
 	{
 		m_heightMap[index] += magnitude * m_sculptScale;
 	}
+	m_heightMapDirty = true;
 	
 	UpdateTerrain();
 }
@@ -203,9 +249,71 @@ void DisplayChunk::FlattenHeightmap(int index)
 {
 	// Set height map at index to 0
 	m_heightMap[index] = 0;
+	m_heightMapDirty = true;
 	UpdateTerrain();
 }
 
+// Same calculation as CalculateTerrainNormals, from the vertices either side
+static Vector3 NormalFromNeighbours(const Vector3& left, const Vector3& right, const Vector3& down, const Vector3& up)
+{
+	Vector3 upDownVector = up - down;
+	Vector3 leftRightVector = left - right;
+	Vector3 normalVector;
+
+	leftRightVector.Cross(upDownVector, normalVector);
+	normalVector.Normalize();
+	return normalVector;
+}
+
+void DisplayChunk::StitchEdge(ChunkEdge edge, DisplayChunk* neighbour)
+{
+	// The edge vertices of neighbouring chunks sit in the same place, so take the neighbour's heights
+	// and work out the normals with the neighbour's next row in, as if the two were one terrain
+	const int last = TERRAINRESOLUTION - 1;
+	VertexPositionNormalTexture (*other)[TERRAINRESOLUTION] = neighbour->m_terrainGeometry;
+
+	for (int k = 0; k < TERRAINRESOLUTION; k++)
+	{
+		switch (edge)
+		{
+		case ChunkEdge::EAST:
+			m_terrainGeometry[k][last].position.y = other[k][0].position.y;
+			break;
+		case ChunkEdge::WEST:
+			m_terrainGeometry[k][0].position.y = other[k][last].position.y;
+			break;
+		case ChunkEdge::NORTH:
+			m_terrainGeometry[last][k].position.y = other[0][k].position.y;
+			break;
+		case ChunkEdge::SOUTH:
+			m_terrainGeometry[0][k].position.y = other[last][k].position.y;
+			break;
+		}
+	}
+
+	for (int k = 0; k < TERRAINRESOLUTION; k++)
+	{
+		int before = std::max(k - 1, 0);
+		int after = std::min(k + 1, last);
+
+		switch (edge)
+		{
+		case ChunkEdge::EAST:
+			m_terrainGeometry[k][last].normal = NormalFromNeighbours(m_terrainGeometry[k][last - 1].position, other[k][1].position, m_terrainGeometry[before][last].position, m_terrainGeometry[after][last].position);
+			break;
+		case ChunkEdge::WEST:
+			m_terrainGeometry[k][0].normal = NormalFromNeighbours(other[k][last - 1].position, m_terrainGeometry[k][1].position, m_terrainGeometry[before][0].position, m_terrainGeometry[after][0].position);
+			break;
+		case ChunkEdge::NORTH:
+			m_terrainGeometry[last][k].normal = NormalFromNeighbours(m_terrainGeometry[last][before].position, m_terrainGeometry[last][after].position, m_terrainGeometry[last - 1][k].position, other[1][k].position);
+			break;
+		case ChunkEdge::SOUTH:
+			m_terrainGeometry[0][k].normal = NormalFromNeighbours(m_terrainGeometry[0][before].position, m_terrainGeometry[0][after].position, other[last - 1][k].position, m_terrainGeometry[1][k].position);
+			break;
+		}
+	}
+}
+
 void DisplayChunk::CalculateTerrainNormals()
 {
 	int index1, index2, index3, index4;
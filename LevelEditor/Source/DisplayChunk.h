@@ -3,8 +3,14 @@
 #include "DeviceResources.h"
 #include "ChunkObject.h"
 
-//geometric resoltuion - note,  hard coded.
-#define TERRAINRESOLUTION 128
+// Sides of a chunk, +z is north and +x is east
+enum class ChunkEdge
+{
+	NORTH,
+	SOUTH,
+	EAST,
+	WEST
+};
 
 class DisplayChunk
 {
@@ -15,7 +21,16 @@ public:
 	void RenderBatch(std::shared_ptr<DX::DeviceResources>  DevResources);
 	void InitialiseBatch();	//initial setup, base coordinates etc based on scale
 	void LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources);
+	void LoadHeightMap(std::shared_ptr<DX::DeviceResources>  DevResources, const std::vector<BYTE>& heightMap);	//heightmap already read, e.g. by a chunk loading thread
+	void SetOrigin(float x, float z) { m_originX = x; m_originZ = z; };	//centre of the chunk in the world, call before InitialiseBatch
+	void StitchEdge(ChunkEdge edge, DisplayChunk* neighbour);		//match this chunk's edge to its neighbour's so there is no seam
+	int GetChunkID() { return m_chunkID; };
 	void SaveHeightMap();			//saves the heigtmap back to file.
+	bool IsHeightMapDirty() { return m_heightMapDirty; };	//heightmap has been edited since it was loaded or saved
+	void SetHeightMapDirty(bool dirty) { m_heightMapDirty = dirty; };
+	void CopyHeightMap(std::vector<BYTE>& heightMap);		//copy of the heightmap, for saving in the background
+	void SetHeightMap(const std::vector<BYTE>& heightMap);	//replace the heightmap and update the geometry, e.g. with recovered edits
+	const std::string& GetHeightMapPath() { return m_heightmap_path; };
 	void UpdateTerrain();			//updates the geometry based on the heigtmap
 	void GenerateHeightmap(int index, float magnitude);		//creates or alters the heightmap
 	void FlattenHeightmap(int index); // set height map at index to 0
@@ -31,7 +46,13 @@ private:
 	
 	
 	BYTE m_heightMap[TERRAINRESOLUTION*TERRAINRESOLUTION];
+	bool m_heightMapDirty;
 	void CalculateTerrainNormals();
+	void CreateRenderResources(std::shared_ptr<DX::DeviceResources>  DevResources);	//texture, effect and batch
+
+	int m_chunkID;
+	float m_originX;
+	float m_originZ;
 
 	float	m_terrainHeightScale;
 	int		m_terrainSize;				//size of terrain in metres
@@ -24,6 +24,10 @@ DisplayObject::DisplayObject()
 	m_light_constant = 0.0f;
 	m_light_linear = 0.0f;
 	m_light_quadratic = 0.0f;
+
+	m_localMin = DirectX::SimpleMath::Vector3::Zero;
+	m_localMax = DirectX::SimpleMath::Vector3::Zero;
+	m_transformDirty = true;
 }
 
 
@@ -31,3 +35,74 @@ DisplayObject::~DisplayObject()
 {
 //	delete m_texture_diffuse;
 }
+
+void DisplayObject::SetLocalBounds(const DirectX::SimpleMath::Vector3& min, const DirectX::SimpleMath::Vector3& max)
+{
+	m_localMin = min;
+	m_localMax = max;
+	m_transformDirty = true;
+}
+
+void DisplayObject::SetCachedTransform(const float world[16], const float inverse[16], const float box[6])
+{
+	m_world = DirectX::SimpleMath::Matrix(world);
+	m_worldInverse = DirectX::SimpleMath::Matrix(inverse);
+	m_worldMin = DirectX::SimpleMath::Vector3(box[0], box[1], box[2]);
+	m_worldMax = DirectX::SimpleMath::Vector3(box[3], box[4], box[5]);
+	m_transformDirty = false;
+}
+
+const DirectX::SimpleMath::Matrix& DisplayObject::GetWorldMatrix() const
+{
+	UpdateTransform();
+	return m_world;
+}
+
+const DirectX::SimpleMath::Matrix& DisplayObject::GetWorldInverse() const
+{
+	UpdateTransform();
+	return m_worldInverse;
+}
+
+const DirectX::SimpleMath::Vector3& DisplayObject::GetWorldMin() const
+{
+	UpdateTransform();
+	return m_worldMin;
+}
+
+const DirectX::SimpleMath::Vector3& DisplayObject::GetWorldMax() const
+{
+	UpdateTransform();
+	return m_worldMax;
+}
+
+void DisplayObject::UpdateTransform() const
+{
+	using namespace DirectX;
+	using namespace DirectX::SimpleMath;
+
+	if (!m_transformDirty)
+	{
+		return;
+	}
+
+	// Orientation is stored in degrees
+	Quaternion rotate = Quaternion::CreateFromYawPitchRoll(XMConvertToRadians(m_orientation.y),
+		XMConvertToRadians(m_orientation.x),
+		XMConvertToRadians(m_orientation.z));
+
+	m_world = XMMatrixTransformation(g_XMZero, Quaternion::Identity, m_scale, g_XMZero, rotate, m_position);
+	m_worldInverse = m_world.Invert();
+
+	// World box around the rotated local box, each world axis takes the local extents along it
+	Vector3 center = Vector3::Transform((m_localMin + m_localMax) * 0.5f, m_world);
+	Vector3 extents = (m_localMax - m_localMin) * 0.5f;
+	Vector3 worldExtents(
+		fabsf(m_world._11) * extents.x + fabsf(m_world._21) * extents.y + fabsf(m_world._31) * extents.z,
+		fabsf(m_world._12) * extents.x + fabsf(m_world._22) * extents.y + fabsf(m_world._32) * extents.z,
+		fabsf(m_world._13) * extents.x + fabsf(m_world._23) * extents.y + fabsf(m_world._33) * extents.z);
+	m_worldMin = center - worldExtents;
+	m_worldMax = center + worldExtents;
+
+	m_transformDirty = false;
+}
@@ -9,7 +9,7 @@ public:
 	~DisplayObject();
 
 	std::shared_ptr<DirectX::Model>						m_model;							//main Mesh
-	ID3D11ShaderResourceView *							m_texture_diffuse;					//diffuse texture
+	ID3D11ShaderResourceView *							m_texture_diffuse;					//diffuse texture, owned by Game's AssetCache
 
 
 	int m_ID;
@@ -27,5 +27,36 @@ public:
 	float	m_light_constant;
 	float	m_light_linear;
 	float	m_light_quadratic;
+
+	// Anything that changes m_position, m_orientation or m_scale must call this so the cached transform is rebuilt
+	void MarkTransformDirty() { m_transformDirty = true; };
+
+	// Model space box the world box is taken around
+	void SetLocalBounds(const DirectX::SimpleMath::Vector3& min, const DirectX::SimpleMath::Vector3& max);
+
+	const DirectX::SimpleMath::Vector3& GetLocalMin() const { return m_localMin; };
+	const DirectX::SimpleMath::Vector3& GetLocalMax() const { return m_localMax; };
+
+	// Fill the cache with results already worked out for the current transform, e.g. by TransformKernel for a batch.
+	// Matrices are 16 floats, the box is min x, y, z then max x, y, z.
+	void SetCachedTransform(const float world[16], const float inverse[16], const float box[6]);
+
+	// World transform, its inverse and the world box around the local bounds, rebuilt on first use after a change
+	const DirectX::SimpleMath::Matrix& GetWorldMatrix() const;
+	const DirectX::SimpleMath::Matrix& GetWorldInverse() const;
+	const DirectX::SimpleMath::Vector3& GetWorldMin() const;
+	const DirectX::SimpleMath::Vector3& GetWorldMax() const;
+
+private:
+	void UpdateTransform() const;
+
+	DirectX::SimpleMath::Vector3			m_localMin;
+	DirectX::SimpleMath::Vector3			m_localMax;
+
+	mutable DirectX::SimpleMath::Matrix		m_world;
+	mutable DirectX::SimpleMath::Matrix		m_worldInverse;
+	mutable DirectX::SimpleMath::Vector3	m_worldMin;
+	mutable DirectX::SimpleMath::Vector3	m_worldMax;
+	mutable bool							m_transformDirty;
 };
 
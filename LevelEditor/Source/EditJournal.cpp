@@ -0,0 +1,481 @@
+#include "EditJournal.h"
+#include "SceneCache.h"
+#include "SceneFields.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+struct JournalHeader
+{
+	char magic[4];				// "LJRN"
+	uint32_t version;			// EDIT_JOURNAL_VERSION
+	uint32_t objectVersion;		// SCENE_CACHE_VERSION, OBJECT records use the cache's record format
+	uint32_t padding;
+};
+
+// Every record is this, then the payload, then a checksum of both
+struct JournalRecordHeader
+{
+	uint8_t type;
+	uint8_t padding[3];
+	uint32_t size;
+};
+
+struct JournalTileHeader
+{
+	int32_t chunkID;
+	int32_t tileX;
+	int32_t tileZ;
+};
+
+static const char s_journalMagic[4] = { 'L', 'J', 'R', 'N' };
+
+// FNV-1a, catches a record torn by a crash part way through writing it
+static uint32_t Checksum(const unsigned char* data, size_t size, uint32_t hash = 2166136261u)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static JournalHeader MakeHeader()
+{
+	JournalHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, s_journalMagic, sizeof(s_journalMagic));
+	header.version = EDIT_JOURNAL_VERSION;
+	header.objectVersion = SCENE_CACHE_VERSION;
+	return header;
+}
+
+static bool ReadWholeFile(const char* path, std::string& data)
+{
+	FILE* pFile = fopen(path, "rb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	char buffer[64 * 1024];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+	{
+		data.append(buffer, read);
+	}
+
+	fclose(pFile);
+	return true;
+}
+
+static bool DecodeRecord(JournalRecordType type, const unsigned char* payload, size_t size, JournalRecord& record)
+{
+	record.type = type;
+	record.chunkID = record.tileX = record.tileZ = 0;
+
+	switch (type)
+	{
+	case JournalRecordType::OBJECT:
+		return SceneCache::UnpackObject(payload, size, record.object);
+
+	case JournalRecordType::DELETE_OBJECT:
+	{
+		if (size != sizeof(int32_t))
+		{
+			return false;
+		}
+		int32_t ID;
+		memcpy(&ID, payload, sizeof(ID));
+		record.object.ID = ID;
+		return true;
+	}
+
+	case JournalRecordType::TRANSFORM:
+	{
+		// ID then the transform fields in the cache's record format
+		if (size < sizeof(int32_t))
+		{
+			return false;
+		}
+		int32_t ID;
+		memcpy(&ID, payload, sizeof(ID));
+		record.object.ID = ID;
+		return SceneCache::UnpackFields(payload + sizeof(ID), size - sizeof(ID), FIELD_TRANSFORM, record.object);
+	}
+
+	case JournalRecordType::TERRAIN_TILE:
+	{
+		if (size != sizeof(JournalTileHeader) + JOURNAL_TILE_SIZE * JOURNAL_TILE_SIZE)
+		{
+			return false;
+		}
+		JournalTileHeader tile;
+		memcpy(&tile, payload, sizeof(tile));
+		record.chunkID = tile.chunkID;
+		record.tileX = tile.tileX;
+		record.tileZ = tile.tileZ;
+		record.heights.assign(payload + sizeof(tile), payload + size);
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
+
+// Walks the records in a journal file. recordEnds gets the offset just past each intact record.
+// Stops at the first record that is cut short, fails its checksum or can't be decoded.
+static bool ParseJournal(const std::string& data, std::vector<JournalRecord>* records, std::vector<size_t>& recordEnds)
+{
+	JournalHeader expected = MakeHeader();
+	if (data.size() < sizeof(JournalHeader) || memcmp(data.data(), &expected, sizeof(JournalHeader)) != 0)
+	{
+		return false;
+	}
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+	size_t offset = sizeof(JournalHeader);
+
+	while (offset + sizeof(JournalRecordHeader) <= data.size())
+	{
+		JournalRecordHeader header;
+		memcpy(&header, bytes + offset, sizeof(header));
+
+		size_t end = offset + sizeof(header) + header.size + sizeof(uint32_t);
+		if (header.size > data.size() || end > data.size())
+		{
+			break;
+		}
+
+		uint32_t checksum;
+		memcpy(&checksum, bytes + end - sizeof(uint32_t), sizeof(checksum));
+		if (Checksum(bytes + offset, sizeof(header) + header.size) != checksum)
+		{
+			break;
+		}
+
+		if (records)
+		{
+			JournalRecord record;
+			if (!DecodeRecord((JournalRecordType)header.type, bytes + offset + sizeof(header), header.size, record))
+			{
+				break;
+			}
+			records->push_back(record);
+		}
+
+		recordEnds.push_back(end);
+		offset = end;
+	}
+
+	return true;
+}
+
+// Write the file in full to a temporary file and swap it in
+static bool ReplaceFile(const std::string& path, const std::string& data)
+{
+	std::string tempPath = path + ".tmp";
+	FILE* pFile = fopen(tempPath.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	bool written = fwrite(data.data(), 1, data.size(), pFile) == data.size() && fflush(pFile) == 0;
+#ifdef _WIN32
+	written = written && _commit(_fileno(pFile)) == 0;
+#else
+	written = written && fsync(fileno(pFile)) == 0;
+#endif
+	written = (fclose(pFile) == 0) && written;
+
+	if (!written)
+	{
+		remove(tempPath.c_str());
+		return false;
+	}
+
+	remove(path.c_str());
+	return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+EditJournal::EditJournal()
+{
+	m_appended = 0;
+	m_compactCheckpoint = 0;
+	m_stop = false;
+	m_file = NULL;
+	m_fileFirstRecord = 0;
+}
+
+EditJournal::~EditJournal()
+{
+	Stop();
+}
+
+bool EditJournal::Start(const char* databasePath, std::vector<JournalRecord>& recovered)
+{
+	Stop();
+	m_path = GetJournalPath(databasePath);
+
+	// Keep the intact records and drop anything torn or from another version
+	std::string data;
+	std::vector<size_t> recordEnds;
+	JournalHeader header = MakeHeader();
+	std::string kept(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (ReadWholeFile(m_path.c_str(), data))
+	{
+		if (ParseJournal(data, &recovered, recordEnds))
+		{
+			if (!recordEnds.empty())
+			{
+				kept.append(data, sizeof(JournalHeader), recordEnds.back() - sizeof(JournalHeader));
+			}
+		}
+		else
+		{
+			m_lastError = "Journal is from a different version, its edits can't be recovered";
+		}
+	}
+
+	if (!ReplaceFile(m_path, kept))
+	{
+		m_lastError = "Can't write " + m_path;
+		return false;
+	}
+
+	m_file = fopen(m_path.c_str(), "ab");
+	if (m_file == NULL)
+	{
+		m_lastError = "Can't open " + m_path;
+		return false;
+	}
+
+	m_pending.clear();
+	m_appended = recovered.size();
+	m_compactCheckpoint = 0;
+	m_fileFirstRecord = 0;
+	m_stop = false;
+	m_thread = std::thread(&EditJournal::WriterLoop, this);
+	return true;
+}
+
+void EditJournal::Stop()
+{
+	if (!m_thread.joinable())
+	{
+		return;
+	}
+
+	// The writer finishes what is pending before it exits
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_thread.join();
+
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = NULL;
+	}
+}
+
+void EditJournal::AppendObject(const SceneObject& object)
+{
+	std::string payload;
+	SceneCache::PackObject(object, payload);
+	Append(JournalRecordType::OBJECT, payload);
+}
+
+void EditJournal::AppendDelete(int ID)
+{
+	int32_t value = ID;
+	Append(JournalRecordType::DELETE_OBJECT, std::string(reinterpret_cast<const char*>(&value), sizeof(value)));
+}
+
+void EditJournal::AppendTransform(const SceneObject& object)
+{
+	int32_t ID = object.ID;
+	std::string fields;
+	SceneCache::PackFields(object, FIELD_TRANSFORM, fields);
+	Append(JournalRecordType::TRANSFORM, std::string(reinterpret_cast<const char*>(&ID), sizeof(ID)) + fields);
+}
+
+void EditJournal::AppendTerrainTile(int chunkID, int tileX, int tileZ, const unsigned char* heightMap, int heightMapWidth)
+{
+	JournalTileHeader tile;
+	tile.chunkID = chunkID;
+	tile.tileX = tileX;
+	tile.tileZ = tileZ;
+
+	std::string payload(reinterpret_cast<const char*>(&tile), sizeof(tile));
+	for (int row = 0; row < JOURNAL_TILE_SIZE; row++)
+	{
+		const unsigned char* source = heightMap + (tileZ * JOURNAL_TILE_SIZE + row) * heightMapWidth + tileX * JOURNAL_TILE_SIZE;
+		payload.append(reinterpret_cast<const char*>(source), JOURNAL_TILE_SIZE);
+	}
+
+	Append(JournalRecordType::TERRAIN_TILE, payload);
+}
+
+uint64_t EditJournal::GetCheckpoint()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_appended;
+}
+
+void EditJournal::Compact(uint64_t checkpoint)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (checkpoint > m_compactCheckpoint)
+		{
+			m_compactCheckpoint = checkpoint;
+		}
+	}
+	m_wake.notify_all();
+}
+
+std::string EditJournal::GetJournalPath(const char* databasePath)
+{
+	return std::string(databasePath) + ".journal";
+}
+
+std::string EditJournal::GetLastError()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_lastError;
+}
+
+bool EditJournal::Read(const char* path, std::vector<JournalRecord>& records)
+{
+	std::string data;
+	std::vector<size_t> recordEnds;
+	return ReadWholeFile(path, data) && ParseJournal(data, &records, recordEnds);
+}
+
+void EditJournal::Append(JournalRecordType type, const std::string& payload)
+{
+	JournalRecordHeader header;
+	memset(&header, 0, sizeof(header));
+	header.type = (uint8_t)type;
+	header.size = (uint32_t)payload.size();
+
+	std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+	record += payload;
+	uint32_t checksum = Checksum(reinterpret_cast<const unsigned char*>(record.data()), record.size());
+	record.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+	bool wake;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pending += record;
+		m_appended++;
+		wake = m_pending.size() >= JOURNAL_SYNC_BYTES;
+	}
+
+	if (wake)
+	{
+		m_wake.notify_all();
+	}
+}
+
+void EditJournal::WriterLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		// Batch up whatever arrives in the interval, so many edits share one sync
+		m_wake.wait_for(lock, std::chrono::milliseconds(JOURNAL_SYNC_INTERVAL_MS),
+			[this] { return m_stop || m_pending.size() >= JOURNAL_SYNC_BYTES || m_compactCheckpoint > m_fileFirstRecord; });
+
+		std::string pending;
+		pending.swap(m_pending);
+		uint64_t compactCheckpoint = m_compactCheckpoint;
+		bool stop = m_stop;
+		lock.unlock();
+
+		if (!pending.empty())
+		{
+			bool written = m_file && fwrite(pending.data(), 1, pending.size(), m_file) == pending.size() && Sync();
+			if (!written)
+			{
+				std::lock_guard<std::mutex> errorLock(m_mutex);
+				m_lastError = "Can't write " + m_path;
+			}
+		}
+
+		// Everything before the checkpoint is in the file now, so it can be dropped
+		if (compactCheckpoint > m_fileFirstRecord)
+		{
+			if (Rewrite(compactCheckpoint - m_fileFirstRecord))
+			{
+				m_fileFirstRecord = compactCheckpoint;
+			}
+			else
+			{
+				std::lock_guard<std::mutex> errorLock(m_mutex);
+				m_lastError = "Can't compact " + m_path;
+			}
+		}
+
+		lock.lock();
+		if (stop && m_pending.empty())
+		{
+			break;
+		}
+	}
+}
+
+bool EditJournal::Sync()
+{
+	if (fflush(m_file) != 0)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	return _commit(_fileno(m_file)) == 0;
+#else
+	return fsync(fileno(m_file)) == 0;
+#endif
+}
+
+bool EditJournal::Rewrite(uint64_t skipRecords)
+{
+	fclose(m_file);
+	m_file = NULL;
+
+	std::string data;
+	std::vector<size_t> recordEnds;
+	bool success = ReadWholeFile(m_path.c_str(), data) && ParseJournal(data, NULL, recordEnds);
+
+	if (success)
+	{
+		size_t start = sizeof(JournalHeader);
+		if (skipRecords > 0 && !recordEnds.empty())
+		{
+			start = recordEnds[(size_t)std::min<uint64_t>(skipRecords, recordEnds.size()) - 1];
+		}
+		size_t end = recordEnds.empty() ? sizeof(JournalHeader) : recordEnds.back();
+
+		JournalHeader header = MakeHeader();
+		std::string kept(reinterpret_cast<const char*>(&header), sizeof(header));
+		kept.append(data, start, end - start);
+		success = ReplaceFile(m_path, kept);
+	}
+
+	// Carry on appending either way, a journal that wasn't compacted is only bigger
+	m_file = fopen(m_path.c_str(), "ab");
+	return success && m_file != NULL;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "SceneObject.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Bump whenever a record layout changes, journals from other versions are not replayed
+#define EDIT_JOURNAL_VERSION 1
+
+// Appended records are written and synced to disk at least this often
+#define JOURNAL_SYNC_INTERVAL_MS 250
+
+// Or as soon as this much is waiting
+#define JOURNAL_SYNC_BYTES (64 * 1024)
+
+// Terrain edits are journaled in square tiles of this many heightmap samples a side
+#define JOURNAL_TILE_SIZE 16
+
+enum class JournalRecordType : uint8_t
+{
+	OBJECT = 1,			// whole object, added or changed
+	DELETE_OBJECT = 2,	// ID only
+	TRANSFORM = 3,		// ID, position, rotation and scale. Most edits only move an object, so this keeps them small.
+	TERRAIN_TILE = 4,	// one tile of the heightmap
+};
+
+struct JournalRecord
+{
+	JournalRecordType type;
+	SceneObject object;					// OBJECT, or the ID and transform for TRANSFORM and DELETE_OBJECT
+	int chunkID;						// TERRAIN_TILE, chunk the heightmap belongs to
+	int tileX, tileZ;					// TERRAIN_TILE, in tiles
+	std::vector<unsigned char> heights;	// TERRAIN_TILE, JOURNAL_TILE_SIZE rows of JOURNAL_TILE_SIZE samples
+};
+
+// Append only log of scene edits kept next to the database, e.g. "database/test.db.journal", so unsaved work
+// survives a crash. Records are buffered and written by a background thread, which syncs the file to disk in
+// batches rather than on every edit. Each record carries a checksum, so a record torn by a crash is dropped on
+// the next start. Once a save has put edits in the database, Compact drops their records from the file.
+class EditJournal
+{
+public:
+	EditJournal();
+	~EditJournal();
+
+	// Open the journal for the database, returning any records left by a session that didn't save them.
+	// The caller replays those; they stay in the journal until the next save.
+	bool Start(const char* databasePath, std::vector<JournalRecord>& recovered);
+	void Stop();
+	bool IsRunning() { return m_thread.joinable(); };
+
+	// Queue records, they are on disk within JOURNAL_SYNC_INTERVAL_MS
+	void AppendObject(const SceneObject& object);
+	void AppendDelete(int ID);
+	void AppendTransform(const SceneObject& object);
+	void AppendTerrainTile(int chunkID, int tileX, int tileZ, const unsigned char* heightMap, int heightMapWidth);
+
+	// Number of records appended so far, taken when a save is queued
+	uint64_t GetCheckpoint();
+
+	// Drop the records before the checkpoint, call once the save queued at that checkpoint has succeeded
+	void Compact(uint64_t checkpoint);
+
+	static std::string GetJournalPath(const char* databasePath);
+
+	// Reads every intact record, stopping at the first damaged one
+	static bool Read(const char* path, std::vector<JournalRecord>& records);
+
+	std::string GetLastError();
+
+private:
+	void Append(JournalRecordType type, const std::string& payload);
+	void WriterLoop();
+	bool Sync();
+	bool Rewrite(uint64_t skipRecords);		// writer thread only
+
+	std::string m_path;
+	std::thread m_thread;
+
+	// Shared with the writer, guarded by the mutex
+	std::mutex m_mutex;
+	std::string m_lastError;
+	std::condition_variable m_wake;
+	std::string m_pending;					// records not yet written
+	uint64_t m_appended;					// records appended since Start, including recovered ones
+	uint64_t m_compactCheckpoint;			// compaction requested up to here
+	bool m_stop;
+
+	// Writer thread only, apart from Start and Stop
+	FILE* m_file;
+	uint64_t m_fileFirstRecord;				// checkpoint of the first record in the file
+};
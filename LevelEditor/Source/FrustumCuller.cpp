@@ -0,0 +1,141 @@
+#include "FrustumCuller.h"
+#include <cmath>
+
+Frustum Frustum::FromMatrix(const float viewProjection[16])
+{
+	// Clip space x, y and z are the dot products with the matrix's columns, a point is inside when -w <= x <= w,
+	// -w <= y <= w and 0 <= z <= w, so each plane is w's column plus or minus another
+	const float* m = viewProjection;
+	float columns[4][4];
+	for (int column = 0; column < 4; column++)
+	{
+		for (int row = 0; row < 4; row++)
+		{
+			columns[column][row] = m[row * 4 + column];
+		}
+	}
+
+	Frustum frustum;
+	for (int i = 0; i < 4; i++)
+	{
+		frustum.planes[0][i] = columns[3][i] + columns[0][i];	// left
+		frustum.planes[1][i] = columns[3][i] - columns[0][i];	// right
+		frustum.planes[2][i] = columns[3][i] + columns[1][i];	// bottom
+		frustum.planes[3][i] = columns[3][i] - columns[1][i];	// top
+		frustum.planes[4][i] = columns[2][i];					// near
+		frustum.planes[5][i] = columns[3][i] - columns[2][i];	// far
+	}
+
+	// Normalised so the plane distances are in world units
+	for (int plane = 0; plane < 6; plane++)
+	{
+		float* p = frustum.planes[plane];
+		float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+		if (length > 0.0f)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				p[i] /= length;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+Frustum::Containment Frustum::ClassifyBox(const float min[3], const float max[3]) const
+{
+	Containment result = INSIDE;
+	for (int plane = 0; plane < 6; plane++)
+	{
+		const float* p = planes[plane];
+
+		// The corners furthest along and furthest against the plane's normal
+		float furthest = p[3];
+		float nearest = p[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (p[axis] >= 0.0f)
+			{
+				furthest += p[axis] * max[axis];
+				nearest += p[axis] * min[axis];
+			}
+			else
+			{
+				furthest += p[axis] * min[axis];
+				nearest += p[axis] * max[axis];
+			}
+		}
+
+		if (furthest < 0.0f)
+		{
+			return OUTSIDE;
+		}
+		if (nearest < 0.0f)
+		{
+			result = INTERSECTS;
+		}
+	}
+	return result;
+}
+
+FrustumCuller::FrustumCuller()
+{
+	m_stats.objects = 0;
+	m_stats.nodesTested = 0;
+	m_stats.visible = 0;
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Cull(const AabbTree& tree, const Frustum& frustum, std::vector<int>& visible)
+{
+	visible.clear();
+	m_stats.objects = tree.GetLeafCount();
+	m_stats.nodesTested = 0;
+	m_stats.visible = 0;
+
+	if (tree.GetRoot() == -1)
+	{
+		return;
+	}
+
+	// Nodes are pushed with a flag in the sign, negative once an ancestor was found fully inside
+	const std::vector<AabbTreeNode>& nodes = tree.GetNodes();
+	m_stack.clear();
+	m_stack.push_back(tree.GetRoot());
+
+	while (!m_stack.empty())
+	{
+		int entry = m_stack.back();
+		m_stack.pop_back();
+
+		bool inside = entry < 0;
+		int index = inside ? -entry - 1 : entry;
+		const AabbTreeNode& node = nodes[index];
+
+		if (!inside)
+		{
+			m_stats.nodesTested++;
+			Frustum::Containment containment = frustum.ClassifyBox(node.min, node.max);
+			if (containment == Frustum::OUTSIDE)
+			{
+				continue;
+			}
+			inside = containment == Frustum::INSIDE;
+		}
+
+		if (node.IsLeaf())
+		{
+			visible.push_back(node.item);
+			continue;
+		}
+
+		m_stack.push_back(inside ? -node.left - 1 : node.left);
+		m_stack.push_back(inside ? -node.right - 1 : node.right);
+	}
+
+	m_stats.visible = (int)visible.size();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "AabbTree.h"
+#include <vector>
+
+// Six planes bounding what the camera sees, each a, b, c, d with ax + by + cz + d >= 0 on the inside
+struct Frustum
+{
+	float planes[6][4];
+
+	// From a row major view * projection matrix that transforms row vectors, D3D style with clip space z from 0 to w
+	static Frustum FromMatrix(const float viewProjection[16]);
+
+	enum Containment { OUTSIDE, INTERSECTS, INSIDE };
+	Containment ClassifyBox(const float min[3], const float max[3]) const;
+};
+
+// Counts from the last Cull
+struct CullStats
+{
+	int objects;		// leaves in the tree
+	int nodesTested;	// boxes tested against the frustum
+	int visible;		// objects at least partly inside
+};
+
+// Finds the objects whose world space boxes are inside the frustum by walking an AabbTree. Branches outside are skipped
+// whole and branches fully inside are taken without testing anything under them. No D3D, so it can run headless.
+class FrustumCuller
+{
+public:
+	FrustumCuller();
+	~FrustumCuller();
+
+	// Items of every leaf at least partly inside, in no particular order
+	void Cull(const AabbTree& tree, const Frustum& frustum, std::vector<int>& visible);
+
+	const CullStats& GetStats() const { return m_stats; };
+
+private:
+	std::vector<int> m_stack;
+	CullStats m_stats;
+};
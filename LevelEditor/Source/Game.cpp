@@ -5,7 +5,12 @@
 #include "../pch.h"
 #include "Game.h"
 #include "DisplayObject.h"
+#include "SceneFields.h"
+#include "Benchmark.h"
 #include <string>
+#include <cfloat>
+#include <random>
+#include <thread>
 
 
 using namespace DirectX;
@@ -25,6 +30,10 @@ Game::Game()
     m_wireframeObjects = false;
     m_wireframeTerrain = false;
     m_highlight = true;
+    m_assetPriorityTimer = 0.0f;
+    m_drawnObjects = 0;
+    m_drawCalls = 0;
+    m_renderSeconds = 0.0;
     m_focus = 2;
     m_focusMin = 1;
     m_focusMax = 10;
@@ -34,8 +43,10 @@ Game::Game()
     m_spherePos = DirectX::SimpleMath::Vector3(0,0,0);
     m_spawnDistance = 3;
     m_toolbarHeight = 16;
+    m_storedTopID = -1;
     m_terrainSculpter.SetInput(&m_InputCommands);
     m_terrainSculpter.SetToolbarHeight(m_toolbarHeight);
+    m_objectManipulator.SetChangeTracker(&m_changeTracker);
 }
 
 Game::~Game()
@@ -69,6 +80,10 @@ void Game::Initialize(HWND window, int width, int height)
 
     GetClientRect(window, &m_ScreenDimensions);
 
+    // Cooked collision meshes from earlier runs, anything missing is cooked by the asset loader as its model is read
+    m_collisionCache.Load(COLLISION_CACHE_PATH);
+    m_assetCache.SetCollisionCache(&m_collisionCache);
+
     // Create primitive sphere
     m_sphere = GeometricPrimitive::CreateSphere(m_deviceResources->GetD3DDeviceContext());
 
@@ -131,6 +146,9 @@ void Game::Update(DX::StepTimer const& timer)
     // Update camera with inputs.
     m_camera.Update(timer, &m_InputCommands);
 
+    // Swap in models that have finished loading
+    UpdateAssetStreaming(timer);
+
     // When in sculpt mode...
     if (m_sculptModeActive)
     {
@@ -138,6 +156,12 @@ void Game::Update(DX::StepTimer const& timer)
         {
             m_terrainSculpter.Sculpt(&m_displayChunk, m_spherePos, timer);
             m_objectManipulator.CreateTriangles(&m_displayChunk);
+
+            // Neighbours follow the edited chunk's edges
+            if (!m_neighbourChunks.empty())
+            {
+                StitchChunks();
+            }
         }
     }
     else // when in object manipulation mode, update object manipulator
@@ -145,6 +169,12 @@ void Game::Update(DX::StepTimer const& timer)
         m_objectManipulator.Update(timer, &m_InputCommands, &m_camera);
     }
 
+    // The manipulator and object dialog only ever change the selected object
+    if (*m_currentSelection >= 0 && *m_currentSelection < m_sceneStore.Size() && *m_currentSelection < (int)m_sceneGraph->size())
+    {
+        m_sceneStore.SetTransform(*m_currentSelection, m_sceneGraph->at(*m_currentSelection));
+    }
+
     // Only register object manipulation inputs for undo if they last for more than 0.2s to prevent single clicks to select from being registered as actions
     if (m_objectManipulator.GetActive() && m_objectManipulator.GetClickLength() > 0.2f && !m_ManipulatorUndoFlag)
     {
@@ -160,6 +190,12 @@ void Game::Update(DX::StepTimer const& timer)
     // Snap object to ground if needed
     m_objectManipulator.SnapToGround(&m_displayChunk);
 
+    // The selection is the only object that moves between edits, refit its leaf in the picking tree
+    if (*m_currentSelection >= 0 && *m_currentSelection < m_objectPicker.Size())
+    {
+        m_objectPicker.SetTransform(*m_currentSelection, m_displayList[*m_currentSelection]);
+    }
+
 	//apply camera vectors
     m_view = Matrix::CreateLookAt(m_camera.GetPosition(), m_camera.GetLookAt(), Vector3::UnitY);
 
@@ -167,6 +203,10 @@ void Game::Update(DX::StepTimer const& timer)
     m_batchEffect->SetWorld(Matrix::Identity);
 	m_displayChunk.m_terrainEffect->SetView(m_view);
 	m_displayChunk.m_terrainEffect->SetWorld(Matrix::Identity);
+    for (auto& neighbour : m_neighbourChunks)
+    {
+        neighbour.second->m_terrainEffect->SetView(m_view);
+    }
 
 #ifdef DXTK_AUDIO
     m_audioTimerAcc -= (float)timer.GetElapsedSeconds();
@@ -207,6 +247,7 @@ void Game::Render()
         return;
     }
 
+    BenchmarkTimer frameTimer;
     Clear();
 
     m_deviceResources->PIXBeginEvent(L"Render");
@@ -225,71 +266,61 @@ void Game::Render()
 
  
 	//RENDER OBJECTS FROM SCENEGRAPH
-	int numRenderObjects = m_displayList.size();
-	for (int i = 0; i < numRenderObjects; i++)
-	{
-        if (m_displayList[i].m_render)
+    // Only objects whose world boxes are in view, found through the picking tree which already keeps them up to date
+    Matrix viewProjection = m_world * m_view * m_projection;
+    m_frustumCuller.Cull(m_objectPicker.GetTree(), Frustum::FromMatrix(&viewProjection._11), m_visibleObjects);
+
+    // Highlight override for the selected object, its effects only change when the selection does
+    bool highlighting = m_highlight && m_currentSelection && *m_currentSelection >= 0 && *m_currentSelection < (int)m_displayList.size();
+    m_selectionHighlight.Update(m_deviceResources->GetD3DDevice(), *m_fxFactory, m_assetCache, highlighting ? m_displayList[*m_currentSelection].m_model : nullptr, m_camera.GetPosition());
+
+    // Grouped by model, texture, fill mode and highlight, so each group's state is set up once
+    m_renderQueue.Clear();
+    for (int i : m_visibleObjects)
+    {
+        const DisplayObject& object = m_displayList[i];
+        if (object.m_render && object.m_model)
         {
+            bool selected = highlighting && i == *m_currentSelection && m_selectionHighlight.GetModel();
+            m_renderQueue.Add(i, m_renderQueue.GetResourceKey(object.m_model.get()), m_renderQueue.GetResourceKey(object.m_texture_diffuse), m_wireframeObjects, selected);
+        }
+    }
+    m_renderQueue.Sort();
+    m_drawnObjects = 0;
+    m_drawCalls = 0;
 
-            m_deviceResources->PIXBeginEvent(L"Draw model");
+    const std::vector<RenderItem>& renderItems = m_renderQueue.GetItems();
+    for (const RenderBatch& batch : m_renderQueue.GetBatches())
+    {
+        m_deviceResources->PIXBeginEvent(L"Draw batch");
 
+        // Models are shared by every object using the same model and texture, so the whole batch has the same one.
+        // The selected object is drawn with its highlighted copy.
+        Model& model = batch.selected ? *m_selectionHighlight.GetModel() : *m_displayList[renderItems[batch.first].index].m_model;
 
-            if (m_currentSelection)
+        // What Model::Draw does, opaque parts then alpha parts, but each mesh's states are set once for the batch.
+        // Nothing is instanced, every part of every object is still a draw of its own.
+        for (int alpha = 0; alpha < 2; alpha++)
+        {
+            for (const auto& mesh : model.meshes)
             {
-                // If the current object being rendered is the selected object, and highlights are enabled. Toggle fog on.
-                if (i == *m_currentSelection && m_highlight)
+                mesh->PrepareForRendering(context, *m_states, alpha == 1, batch.wireframe);
+                for (const auto& part : mesh->meshParts)
                 {
-                    m_displayList[i].m_model->UpdateEffects([&](IEffect* effect)
-                        {
-                            auto fog = dynamic_cast<IEffectFog*>(effect);
-                    if (fog)
-                    {
-
-                        // Distance from camera to centre of object
-                        float dist = DirectX::SimpleMath::Vector3(m_camera.GetPosition() - m_displayList[i].m_model->meshes[0]->boundingBox.Center).Length();
-
-                        fog->SetFogEnabled(true);
-
-                        // dynamically adjust the fog intensity based on distance
-                        fog->SetFogStart(-dist / 2); 
-                        fog->SetFogEnd(dist * 2);
-                        fog->SetFogColor(Colors::HotPink);
-
-                    }
-                        });
+                    m_drawCalls += part->isAlpha == (alpha == 1) ? batch.count : 0;
                 }
-                else // Otherwise turn fog off.
+                for (int item = batch.first; item < batch.first + batch.count; item++)
                 {
-                    m_displayList[i].m_model->UpdateEffects([&](IEffect* effect)
-                        {
-                            auto fog = dynamic_cast<IEffectFog*>(effect);
-                    if (fog)
-                    {
-                        fog->SetFogEnabled(false);
-
-                    }
-                        });
+                    //world matrix is cached on the object, only rebuilt after it moves
+                    XMMATRIX local = m_world * m_displayList[renderItems[item].index].GetWorldMatrix();
+                    mesh->Draw(context, local, m_view, m_projection, alpha == 1);
                 }
             }
-
-            const XMVECTORF32 scale = { m_displayList[i].m_scale.x, m_displayList[i].m_scale.y, m_displayList[i].m_scale.z };
-            const XMVECTORF32 translate = { m_displayList[i].m_position.x, m_displayList[i].m_position.y, m_displayList[i].m_position.z };
-
-            //convert degrees into radians for rotation matrix
-            XMVECTOR rotate = Quaternion::CreateFromYawPitchRoll(m_displayList[i].m_orientation.y * 3.1415 / 180,
-                m_displayList[i].m_orientation.x * 3.1415 / 180,
-                m_displayList[i].m_orientation.z * 3.1415 / 180);
-
-            XMMATRIX local = m_world * XMMatrixTransformation(g_XMZero, Quaternion::Identity, scale, g_XMZero, rotate, translate);
-
-            m_displayList[i].m_model->Draw(context, *m_states, local, m_view, m_projection, m_wireframeObjects);	// draw object, wireframe toggle determines how to render it
-            
-
-
-            m_deviceResources->PIXEndEvent();
         }
+        m_drawnObjects += batch.count;
 
-	}
+        m_deviceResources->PIXEndEvent();
+    }
     m_deviceResources->PIXEndEvent();
 
 	//RENDER TERRAIN
@@ -305,6 +336,10 @@ void Game::Render()
 
 	//Render the batch,  This is handled in the Display chunk becuase it has the potential to get complex
 	m_displayChunk.RenderBatch(m_deviceResources);
+    for (auto& neighbour : m_neighbourChunks)
+    {
+        neighbour.second->RenderBatch(m_deviceResources);
+    }
    
     // If in the sculpt mode, draw sphere at mouse position
     if (m_sculptModeActive)
@@ -334,8 +369,20 @@ void Game::Render()
     //WCHAR   Buffer[256];
     std::wstring var = L"Camera - X: " + std::to_wstring(m_camera.GetPosition().x) + L", Y: " + std::to_wstring(m_camera.GetPosition().y) + L", Z: " + std::to_wstring(m_camera.GetPosition().z);
     m_font->DrawString(m_sprites.get(), var.c_str(), XMFLOAT2(100, 10), Colors::Yellow);
+
+    // Culling results for this frame
+    const CullStats& cullStats = m_frustumCuller.GetStats();
+    std::wstring culling = L"Objects - drawn: " + std::to_wstring(m_drawnObjects) + L" with " + std::to_wstring(m_drawCalls) + L" draw calls, "
+        + std::to_wstring(m_renderQueue.GetStats().batches) + L" state batches"
+        + L", culled: " + std::to_wstring(cullStats.objects - cullStats.visible) + L", boxes tested: " + std::to_wstring(cullStats.nodesTested);
+    m_font->DrawString(m_sprites.get(), culling.c_str(), XMFLOAT2(100, 40), Colors::Yellow);
+
+    // Last frame's render time, this frame's is only known once the HUD is drawn
+    std::wstring frame = L"Frame - CPU: " + std::to_wstring(m_renderSeconds * 1000.0) + L" ms, highlight changes: " + std::to_wstring(m_selectionHighlight.GetChanges());
+    m_font->DrawString(m_sprites.get(), frame.c_str(), XMFLOAT2(100, 70), Colors::Yellow);
     m_sprites->End();
 
+    m_renderSeconds = frameTimer.GetElapsedSeconds();
     m_deviceResources->Present();
 }
 
@@ -444,83 +491,85 @@ void Game::OnWindowSizeChanged(int width, int height)
 
 void Game::BuildDisplayList(std::vector<SceneObject> * SceneGraph)
 {
-	auto device = m_deviceResources->GetD3DDevice();
-	auto devicecontext = m_deviceResources->GetD3DDeviceContext();
     m_sceneGraph = SceneGraph;
-    m_topID = FindHighestID(SceneGraph);
+    m_sceneStore.Build(*SceneGraph);
+    m_topID = std::max(FindHighestID(), m_storedTopID);
 
 	if (!m_displayList.empty())		//is the vector empty
 	{
 		m_displayList.clear();		//if not, empty it
 	}
+	m_objectPicker.Clear();
+	m_waitingForAssets.clear();
+	m_renderQueue.ForgetResources();
+
+	AppendDisplayList(SceneGraph, 0);
+
+	// Models and textures only the old display list used
+	m_assetCache.ReleaseUnused();
+}
 
-	//for every item in the scenegraph
+void Game::AppendDisplayList(std::vector<SceneObject> * SceneGraph, int firstIndex)
+{
+	m_sceneGraph = SceneGraph;
+
+	//for every item in the scenegraph that doesn't have a display object yet
 	int numObjects = SceneGraph->size();
-	for (int i = 0; i < numObjects; i++)
+	for (int i = m_sceneStore.Size(); i < numObjects; i++)
+	{
+		m_sceneStore.Append(SceneGraph->at(i));
+	}
+
+	for (int i = firstIndex; i < numObjects; i++)
 	{
-		
 		//create a temp display object that we will populate then append to the display list.
 		DisplayObject newDisplayObject;
-		
-		//load model
-		std::wstring modelwstr = StringToWCHART(SceneGraph->at(i).model_path);							//convect string to Wchar
-        newDisplayObject.m_model = Model::CreateFromCMO(device, modelwstr.c_str(), *m_fxFactory, true);	//get DXSDK to load model "False" for LH coordinate system (maya)
-     
-		//Load Texture
-		std::wstring texturewstr = StringToWCHART(SceneGraph->at(i).tex_diffuse_path);								//convect string to Wchar
-		HRESULT rs;
-		rs = CreateDDSTextureFromFile(device, texturewstr.c_str(), nullptr, &newDisplayObject.m_texture_diffuse);	//load tex into Shader resource
-
-		//if texture fails.  load error default
-		if (rs)
-		{
-			CreateDDSTextureFromFile(device, L"database/data/Error.dds", nullptr, &newDisplayObject.m_texture_diffuse);	//load tex into Shader resource
-		}
+		MakeDisplayObject(SceneGraph->at(i), newDisplayObject);
+		m_displayList.push_back(newDisplayObject);
+	}
 
-		//apply new texture to models effect
-		newDisplayObject.m_model->UpdateEffects([&](IEffect* effect) //This uses a Lambda function,  if you dont understand it: Look it up.
-		{	
-			auto lights = dynamic_cast<BasicEffect*>(effect);
-			if (lights)
-			{
-				lights->SetTexture(newDisplayObject.m_texture_diffuse);			
-			}
-		});
+	// World transforms for the whole batch at once from the scene store's arrays, rather than one by one when each
+	// object is first drawn or picked
+	int count = numObjects - firstIndex;
+	std::vector<float> localBounds[6];
+	for (std::vector<float>& bounds : localBounds)
+	{
+		bounds.resize(count);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		const DisplayObject& displayObject = m_displayList[firstIndex + i];
+		localBounds[0][i] = displayObject.GetLocalMin().x;
+		localBounds[1][i] = displayObject.GetLocalMin().y;
+		localBounds[2][i] = displayObject.GetLocalMin().z;
+		localBounds[3][i] = displayObject.GetLocalMax().x;
+		localBounds[4][i] = displayObject.GetLocalMax().y;
+		localBounds[5][i] = displayObject.GetLocalMax().z;
+	}
 
-		//set position
-		newDisplayObject.m_position.x = SceneGraph->at(i).posX;
-		newDisplayObject.m_position.y = SceneGraph->at(i).posY;
-		newDisplayObject.m_position.z = SceneGraph->at(i).posZ;
-		
-		//setorientation
-		newDisplayObject.m_orientation.x = SceneGraph->at(i).rotX;
-		newDisplayObject.m_orientation.y = SceneGraph->at(i).rotY;
-		newDisplayObject.m_orientation.z = SceneGraph->at(i).rotZ;
-
-		//set scale
-		newDisplayObject.m_scale.x = SceneGraph->at(i).scaX;
-		newDisplayObject.m_scale.y = SceneGraph->at(i).scaY;
-		newDisplayObject.m_scale.z = SceneGraph->at(i).scaZ;
-
-		//set wireframe / render flags
-		newDisplayObject.m_render		= SceneGraph->at(i).editor_render;
-		newDisplayObject.m_wireframe	= SceneGraph->at(i).editor_wireframe;
-        newDisplayObject.m_snap_to_ground = SceneGraph->at(i).snapToGround;
-
-		newDisplayObject.m_light_type		= SceneGraph->at(i).light_type;
-		newDisplayObject.m_light_diffuse_r	= SceneGraph->at(i).light_diffuse_r;
-		newDisplayObject.m_light_diffuse_g	= SceneGraph->at(i).light_diffuse_g;
-		newDisplayObject.m_light_diffuse_b	= SceneGraph->at(i).light_diffuse_b;
-		newDisplayObject.m_light_specular_r = SceneGraph->at(i).light_specular_r;
-		newDisplayObject.m_light_specular_g = SceneGraph->at(i).light_specular_g;
-		newDisplayObject.m_light_specular_b = SceneGraph->at(i).light_specular_b;
-		newDisplayObject.m_light_spot_cutoff = SceneGraph->at(i).light_spot_cutoff;
-		newDisplayObject.m_light_constant	= SceneGraph->at(i).light_constant;
-		newDisplayObject.m_light_linear		= SceneGraph->at(i).light_linear;
-		newDisplayObject.m_light_quadratic	= SceneGraph->at(i).light_quadratic;
-		
-		m_displayList.push_back(newDisplayObject);
-		
+	TransformInput transformInput = {
+		m_sceneStore.GetPositionX() + firstIndex, m_sceneStore.GetPositionY() + firstIndex, m_sceneStore.GetPositionZ() + firstIndex,
+		m_sceneStore.GetRotationX() + firstIndex, m_sceneStore.GetRotationY() + firstIndex, m_sceneStore.GetRotationZ() + firstIndex,
+		m_sceneStore.GetScaleX() + firstIndex, m_sceneStore.GetScaleY() + firstIndex, m_sceneStore.GetScaleZ() + firstIndex,
+		localBounds[0].data(), localBounds[1].data(), localBounds[2].data(),
+		localBounds[3].data(), localBounds[4].data(), localBounds[5].data() };
+	std::vector<float> worlds((size_t)count * 16);
+	std::vector<float> inverses((size_t)count * 16);
+	std::vector<float> boxes((size_t)count * 6);
+	TransformOutput transformOutput = { worlds.data(), inverses.data(), boxes.data() };
+	TransformKernel::Build(transformInput, count, transformOutput, std::max(1, (int)std::thread::hardware_concurrency()));
+
+	for (int i = 0; i < count; i++)
+	{
+		int index = firstIndex + i;
+		m_displayList[index].SetCachedTransform(&worlds[(size_t)i * 16], &inverses[(size_t)i * 16], &boxes[(size_t)i * 6]);
+		m_objectPicker.Append(m_displayList[index], FindCollisionMesh(SceneGraph->at(index).model_path));
+	}
+
+	// Inserting one at a time leaves a worse tree than building it over everything, which is worth it for a big batch
+	if (numObjects - firstIndex > m_objectPicker.Size() / 4)
+	{
+		m_objectPicker.Rebuild();
 	}
 		
     // Set object for manipulating
@@ -531,17 +580,473 @@ void Game::BuildDisplayList(std::vector<SceneObject> * SceneGraph)
 		
 }
 
+void Game::MakeDisplayObject(const SceneObject& object, DisplayObject& displayObject)
+{
+	auto device = m_deviceResources->GetD3DDevice();
+
+	//model and texture shared with every other object using the same pair. If they aren't loaded yet they are streamed in,
+	//nearest the camera first, and the placeholder is shown until UpdateAssetStreaming swaps them in.
+	Vector3 offset = Vector3(object.posX, object.posY, object.posZ) - m_camera.GetPosition();
+	displayObject.m_model = m_assetCache.RequestModel(object.model_path, object.tex_diffuse_path, offset.LengthSquared(), &displayObject.m_texture_diffuse);
+	if (!displayObject.m_model)
+	{
+		displayObject.m_model = m_assetCache.GetModel(device, *m_fxFactory, ASSET_PLACEHOLDER_MODEL, ASSET_PLACEHOLDER_TEXTURE, &displayObject.m_texture_diffuse);
+		m_waitingForAssets[std::make_pair(object.model_path, object.tex_diffuse_path)].push_back(object.ID);
+	}
+	displayObject.m_ID = object.ID;
+
+	//set position
+	displayObject.m_position.x = object.posX;
+	displayObject.m_position.y = object.posY;
+	displayObject.m_position.z = object.posZ;
+	
+	//setorientation
+	displayObject.m_orientation.x = object.rotX;
+	displayObject.m_orientation.y = object.rotY;
+	displayObject.m_orientation.z = object.rotZ;
+
+	//set scale
+	displayObject.m_scale.x = object.scaX;
+	displayObject.m_scale.y = object.scaY;
+	displayObject.m_scale.z = object.scaZ;
+	displayObject.MarkTransformDirty();
+	SetLocalBounds(displayObject, FindCollisionMesh(object.model_path));
+
+	//set wireframe / render flags
+	displayObject.m_render		= object.editor_render;
+	displayObject.m_wireframe	= object.editor_wireframe;
+	displayObject.m_snap_to_ground = object.snapToGround;
+
+	const SceneObjectCold& cold = object.GetCold();
+	displayObject.m_light_type		= cold.light_type;
+	displayObject.m_light_diffuse_r	= cold.light_diffuse_r;
+	displayObject.m_light_diffuse_g	= cold.light_diffuse_g;
+	displayObject.m_light_diffuse_b	= cold.light_diffuse_b;
+	displayObject.m_light_specular_r = cold.light_specular_r;
+	displayObject.m_light_specular_g = cold.light_specular_g;
+	displayObject.m_light_specular_b = cold.light_specular_b;
+	displayObject.m_light_spot_cutoff = cold.light_spot_cutoff;
+	displayObject.m_light_constant	= cold.light_constant;
+	displayObject.m_light_linear		= cold.light_linear;
+	displayObject.m_light_quadratic	= cold.light_quadratic;
+}
+
+void Game::SetLocalBounds(DisplayObject& displayObject, const std::shared_ptr<const CollisionMesh>& mesh)
+{
+	// Box around the triangles picking traces, or around the drawn model if there aren't any
+	if (mesh && mesh->GetTriangleCount() > 0)
+	{
+		Vector3 min, max;
+		mesh->GetBounds(&min.x, &max.x);
+		displayObject.SetLocalBounds(min, max);
+	}
+	else if (displayObject.m_model && !displayObject.m_model->meshes.empty())
+	{
+		Vector3 min(FLT_MAX, FLT_MAX, FLT_MAX);
+		Vector3 max(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (const auto& modelMesh : displayObject.m_model->meshes)
+		{
+			Vector3 center = modelMesh->boundingBox.Center;
+			Vector3 extents = modelMesh->boundingBox.Extents;
+			min = Vector3::Min(min, center - extents);
+			max = Vector3::Max(max, center + extents);
+		}
+		displayObject.SetLocalBounds(min, max);
+	}
+	else
+	{
+		displayObject.SetLocalBounds(Vector3::Zero, Vector3::Zero);
+	}
+}
+
+std::shared_ptr<const CollisionMesh> Game::FindCollisionMesh(const std::string& modelPath)
+{
+	// Never cooks here, so adding objects doesn't wait on the model file. Picking uses the box until
+	// UpdateAssetStreaming swaps the mesh in with the model.
+	std::shared_ptr<const CollisionMesh> mesh;
+	m_collisionCache.Lookup(modelPath, mesh);
+	return mesh;
+}
+
+void Game::UpdateAssetStreaming(DX::StepTimer const& timer)
+{
+	if (m_waitingForAssets.empty())
+	{
+		return;
+	}
+
+	// The camera moves every frame but the queue only needs to be roughly right, so the priorities are redone a few times a second
+	m_assetPriorityTimer -= (float)timer.GetElapsedSeconds();
+	if (m_assetPriorityTimer <= 0.0f)
+	{
+		m_assetPriorityTimer = ASSET_PRIORITY_INTERVAL;
+
+		const float* posX = m_sceneStore.GetPositionX();
+		const float* posY = m_sceneStore.GetPositionY();
+		const float* posZ = m_sceneStore.GetPositionZ();
+		Vector3 camera = m_camera.GetPosition();
+		int selectedID = (*m_currentSelection >= 0 && *m_currentSelection < m_sceneStore.Size()) ? m_sceneStore.GetIDs()[*m_currentSelection] : -1;
+
+		// A pair is as urgent as its nearest waiting object, and the selection comes before everything
+		std::map<std::pair<std::string, std::string>, float> priorities;
+		for (const auto& waiting : m_waitingForAssets)
+		{
+			float priority = FLT_MAX;
+			for (int ID : waiting.second)
+			{
+				int index = m_sceneStore.FindIndex(ID);
+				if (index == -1)
+				{
+					continue;
+				}
+				if (ID == selectedID)
+				{
+					priority = -1.0f;
+					break;
+				}
+				Vector3 offset = Vector3(posX[index], posY[index], posZ[index]) - camera;
+				priority = std::min(priority, offset.LengthSquared());
+			}
+			priorities[waiting.first] = priority;
+		}
+		m_assetCache.SetPriorities(priorities);
+	}
+
+	std::vector<std::pair<std::string, std::string>> finished;
+	m_assetCache.Update(m_deviceResources->GetD3DDevice(), *m_fxFactory, ASSET_FRAME_BUDGET, finished);
+	if (finished.empty())
+	{
+		return;
+	}
+
+	for (const auto& pair : finished)
+	{
+		auto waiting = m_waitingForAssets.find(pair);
+		if (waiting == m_waitingForAssets.end())
+		{
+			continue;
+		}
+
+		// Failed pairs aren't cached, their objects keep the placeholder
+		ID3D11ShaderResourceView* texture;
+		std::shared_ptr<Model> model = m_assetCache.FindModel(pair.first, pair.second, &texture);
+		if (model)
+		{
+			for (int ID : waiting->second)
+			{
+				// Skip objects deleted or given another model while they waited
+				int index = m_sceneStore.FindIndex(ID);
+				if (index == -1 || m_sceneGraph->at(index).model_path != pair.first || m_sceneGraph->at(index).tex_diffuse_path != pair.second)
+				{
+					continue;
+				}
+				std::shared_ptr<const CollisionMesh> mesh = FindCollisionMesh(pair.first);
+				m_displayList[index].m_model = model;
+				m_displayList[index].m_texture_diffuse = texture;
+				SetLocalBounds(m_displayList[index], mesh);
+				m_objectPicker.Set(index, m_displayList[index], mesh);
+			}
+		}
+		m_waitingForAssets.erase(waiting);
+	}
+
+	// Keep what the loader cooked for the next run, once rather than as each model arrives
+	if (m_assetCache.GetPendingCount() == 0)
+	{
+		m_collisionCache.Save(COLLISION_CACHE_PATH);
+	}
+
+	// The placeholder if nothing shows it any more
+	m_assetCache.ReleaseUnused();
+}
+
+double Game::TimePicking(int objectCount, int rayCount)
+{
+	if (m_displayList.empty() || rayCount <= 0)
+	{
+		return 0.0;
+	}
+
+	// A picker of its own with the display list repeated on a 10m grid, as SceneBenchmark::ReplicateObjects lays out objects
+	ObjectPicker picker;
+	std::vector<Vector3> positions;
+	for (int i = 0; i < objectCount; i++)
+	{
+		int source = i % (int)m_displayList.size();
+		DisplayObject object = m_displayList[source];
+		object.m_position.x += (i % 100) * 10.0f;
+		object.m_position.z += (i / 100) * 10.0f;
+		object.MarkTransformDirty();
+		picker.Append(object, m_collisionCache.Get(m_sceneGraph->at(source).model_path));
+		positions.push_back(object.m_position);
+	}
+	picker.Rebuild();
+
+	// Looking down at a random object from a few metres away, as a click on it would
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int> pickTarget(0, objectCount - 1);
+	std::vector<std::pair<Vector3, Vector3>> rays;
+	for (int i = 0; i < rayCount; i++)
+	{
+		Vector3 target = positions[pickTarget(random)];
+		Vector3 origin = target + Vector3(0.0f, 20.0f, -20.0f);
+		Vector3 direction = target - origin;
+		direction.Normalize();
+		rays.push_back(std::make_pair(origin, direction));
+	}
+
+	BenchmarkTimer timer;
+	float distance;
+	for (const auto& ray : rays)
+	{
+		picker.Pick(ray.first, ray.second, distance);
+	}
+	return timer.GetElapsedSeconds() / rayCount;
+}
+
+double Game::TimeRender(int frameCount, int selection)
+{
+	if (frameCount <= 0)
+	{
+		return 0.0;
+	}
+
+	int previousSelection = *m_currentSelection;
+	*m_currentSelection = selection;
+
+	double seconds = 0.0;
+	for (int i = 0; i < frameCount; i++)
+	{
+		Render();
+		seconds += m_renderSeconds;
+	}
+
+	*m_currentSelection = previousSelection;
+	return seconds / frameCount;
+}
+
+double Game::TimeAssetLoad(int workerCount)
+{
+	// A cache of its own, so everything is loaded from disk and the display list is left alone
+	BenchmarkTimer timer;
+	AssetCache assetCache;
+	assetCache.Preload(m_deviceResources->GetD3DDevice(), *m_fxFactory, *m_sceneGraph, 0, workerCount);
+	return timer.GetElapsedSeconds();
+}
+
+int Game::InsertObject(const SceneObject& object)
+{
+	// Added at the end of all three, so no other display object moves
+	int index = (int)m_sceneGraph->size();
+	m_sceneGraph->push_back(object);
+	m_sceneStore.Append(object);
+
+	DisplayObject newDisplayObject;
+	MakeDisplayObject(object, newDisplayObject);
+	m_displayList.push_back(newDisplayObject);
+	m_objectPicker.Append(m_displayList.back(), FindCollisionMesh(object.model_path));
+
+	m_topID = std::max(m_topID, object.ID);
+	return index;
+}
+
+void Game::RemoveObject(int ID)
+{
+	int index;
+	if (GetObjectByID(ID, index) == nullptr)
+	{
+		return;
+	}
+
+	// The last object fills the gap, so only it changes index
+	int last = (int)m_sceneGraph->size() - 1;
+	if (index != last)
+	{
+		m_sceneGraph->at(index) = std::move(m_sceneGraph->at(last));
+		m_displayList[index] = std::move(m_displayList[last]);
+	}
+	m_sceneGraph->pop_back();
+	m_displayList.pop_back();
+	m_sceneStore.Remove(index);
+	m_objectPicker.Remove(index);
+
+	// Keep the selection on the same object
+	if (*m_currentSelection == index)
+	{
+		*m_currentSelection = -1;
+		m_objectManipulator.SetObject(NULL);
+	}
+	else if (*m_currentSelection == last)
+	{
+		*m_currentSelection = index;
+		m_objectManipulator.SetObject(&m_displayList[index]);
+	}
+
+	m_assetCache.ReleaseUnused();
+}
+
+void Game::UpdateObject(int ID)
+{
+	int index;
+	SceneObject* object = GetObjectByID(ID, index);
+	if (object == nullptr)
+	{
+		return;
+	}
+
+	// Rewritten in place, so the manipulator's pointer stays valid
+	m_sceneStore.Set(index, *object);
+	MakeDisplayObject(*object, m_displayList[index]);
+	m_objectPicker.Set(index, m_displayList[index], FindCollisionMesh(object->model_path));
+	m_assetCache.ReleaseUnused();
+}
+
 void Game::BuildDisplayChunk(ChunkObject * SceneChunk)
 {
 	//populate our local DISPLAYCHUNK with all the chunk info we need from the object stored in toolmain
 	//which, to be honest, is almost all of it. Its mostly rendering related info so...
 	m_displayChunk.PopulateChunkData(SceneChunk);		//migrate chunk data
+	float originX, originZ;
+	ChunkManager::GetChunkOrigin(SceneChunk->ID, originX, originZ);
+	m_displayChunk.SetOrigin(originX, originZ);		//in its own grid cell, as the neighbours are placed around it
 	m_displayChunk.LoadHeightMap(m_deviceResources);
 	m_displayChunk.m_terrainEffect->SetProjection(m_projection);
 	m_displayChunk.InitialiseBatch();
     m_objectManipulator.CreateTriangles(&m_displayChunk); // generate triangle data
 }
 
+void Game::ApplyHeightMap(const std::vector<BYTE>& heightMap)
+{
+    m_displayChunk.SetHeightMap(heightMap);
+    m_objectManipulator.CreateTriangles(&m_displayChunk); // snapping uses the new heights
+
+    if (!m_neighbourChunks.empty())
+    {
+        StitchChunks();
+    }
+}
+
+void Game::AddNeighbourChunk(ChunkObject * SceneChunk, float originX, float originZ, const std::vector<BYTE>& heightMap)
+{
+    // Heightmap has already been read on a loading thread, only the device resources are made here
+    std::unique_ptr<DisplayChunk> chunk = std::make_unique<DisplayChunk>();
+    chunk->PopulateChunkData(SceneChunk);
+    chunk->SetOrigin(originX, originZ);
+    chunk->LoadHeightMap(m_deviceResources, heightMap);
+    chunk->m_terrainEffect->SetProjection(m_projection);
+    chunk->m_terrainEffect->SetView(m_view);
+    chunk->m_terrainEffect->SetWorld(Matrix::Identity);
+    chunk->InitialiseBatch();
+
+    m_neighbourChunks[SceneChunk->ID] = std::move(chunk);
+    StitchChunks();
+}
+
+void Game::RemoveNeighbourChunk(int chunkID)
+{
+    m_neighbourChunks.erase(chunkID);
+}
+
+void Game::ClearNeighbourChunks()
+{
+    m_neighbourChunks.clear();
+}
+
+void Game::StitchChunks()
+{
+    // Find chunks by grid position, the edited chunk included
+    std::map<std::pair<int, int>, DisplayChunk*> grid;
+    ChunkCoord coord = ChunkManager::GetChunkCoord(m_displayChunk.GetChunkID());
+    grid[std::make_pair(coord.x, coord.z)] = &m_displayChunk;
+    for (auto& neighbour : m_neighbourChunks)
+    {
+        coord = ChunkManager::GetChunkCoord(neighbour.first);
+        grid[std::make_pair(coord.x, coord.z)] = neighbour.second.get();
+    }
+
+    struct Side
+    {
+        int dx, dz;
+        ChunkEdge edge;
+    };
+    const Side sides[] = { { 0, 1, ChunkEdge::NORTH }, { 0, -1, ChunkEdge::SOUTH }, { 1, 0, ChunkEdge::EAST }, { -1, 0, ChunkEdge::WEST } };
+
+    // Each seam is only matched one way: neighbours take their edges from the edited chunk,
+    // which is never changed, and from neighbours with a lower ID
+    for (auto& neighbour : m_neighbourChunks)
+    {
+        coord = ChunkManager::GetChunkCoord(neighbour.first);
+        for (const Side& side : sides)
+        {
+            auto other = grid.find(std::make_pair(coord.x + side.dx, coord.z + side.dz));
+            if (other == grid.end())
+            {
+                continue;
+            }
+
+            if (other->second == &m_displayChunk || other->second->GetChunkID() < neighbour.first)
+            {
+                neighbour.second->StitchEdge(side.edge, other->second);
+            }
+        }
+    }
+}
+
+void Game::RemoveChunkObjects(int chunkID, const std::unordered_set<int>& keep, std::vector<int>& removed)
+{
+    RemoveObjects([chunkID](const SceneObject& object) { return object.chunk_ID == chunkID; }, keep, removed);
+}
+
+void Game::RemoveObjects(const std::function<bool(const SceneObject&)>& unload, const std::unordered_set<int>& keep, std::vector<int>& removed)
+{
+    int selectedID = -1;
+    if (*m_currentSelection >= 0 && *m_currentSelection < (int)m_sceneGraph->size())
+    {
+        selectedID = m_sceneGraph->at(*m_currentSelection).ID;
+    }
+
+    // Scene graph and display list are in step, so compact both together. The selected object is always kept.
+    int kept = 0;
+    int numObjects = m_sceneGraph->size();
+    for (int i = 0; i < numObjects; i++)
+    {
+        int ID = m_sceneGraph->at(i).ID;
+        if (ID != selectedID && keep.find(ID) == keep.end() && unload(m_sceneGraph->at(i)))
+        {
+            removed.push_back(ID);
+            continue;
+        }
+
+        if (kept != i)
+        {
+            (*m_sceneGraph)[kept] = std::move((*m_sceneGraph)[i]);
+            m_displayList[kept] = std::move(m_displayList[i]);
+            m_objectPicker.Move(i, kept);
+        }
+        if (ID == selectedID)
+        {
+            *m_currentSelection = kept;
+        }
+        kept++;
+    }
+    if (kept == numObjects)
+    {
+        return;
+    }
+
+    m_sceneGraph->resize(kept);
+    m_displayList.resize(kept);
+    m_objectPicker.Resize(kept);
+    m_sceneStore.Build(*m_sceneGraph);
+    m_assetCache.ReleaseUnused();
+
+    // Objects have moved, so point the manipulator at the selection again
+    if (*m_currentSelection != -1)
+    {
+        m_objectManipulator.SetObject(&m_displayList[*m_currentSelection]);
+    }
+}
+
 void Game::SaveDisplayChunk(ChunkObject * SceneChunk)
 {
 	m_displayChunk.SaveHeightMap();			//save heightmap to file.
@@ -608,13 +1113,6 @@ int Game::MousePicking(int curID)
 
 
     int selectedID = -1;
-    float pickedDistance = 0;
-    float closestDistance = 9999999; // big number for initial closest distance, first object will be closer than this
-    bool hit = false;
-
-    std::vector<int> intersectedObjects;
-    std::vector<float> intersectedDistances;
-
 
     if (m_InputCommands.pickerY > m_toolbarHeight) // only check if the user has clicked below the toolbar
     {
@@ -624,63 +1122,15 @@ int Game::MousePicking(int curID)
     const XMVECTOR nearSource = XMVectorSet(m_InputCommands.pickerX, m_InputCommands.pickerY, 0.0f, 1.0f);
     const XMVECTOR farSource = XMVectorSet(m_InputCommands.pickerX, m_InputCommands.pickerY, 1.0f, 1.0f);
 
-    //Loop through entire display list of objects and pick with each in turn. 
-    for (int i = 0; i < m_displayList.size(); i++)
-    {
-        //Get the scale factor and translation of the object
-        const XMVECTORF32 scale = { m_displayList[i].m_scale.x,		m_displayList[i].m_scale.y,		m_displayList[i].m_scale.z };
-        const XMVECTORF32 translate = { m_displayList[i].m_position.x,	m_displayList[i].m_position.y,	m_displayList[i].m_position.z };
-
-        //convert euler angles into a quaternion for the rotation of the object
-        XMVECTOR rotate = Quaternion::CreateFromYawPitchRoll(m_displayList[i].m_orientation.y * 3.1415 / 180,
-            m_displayList[i].m_orientation.x * 3.1415 / 180,
-            m_displayList[i].m_orientation.z * 3.1415 / 180);
-
-        //create set the matrix of the selected object in the world based on the translation, scale and rotation.
-        XMMATRIX local = m_world * XMMatrixTransformation(g_XMZero, Quaternion::Identity, scale, g_XMZero, rotate, translate);
-
-        //Unproject the points on the near and far plane, with respect to the matrix we just created.
-        XMVECTOR nearPoint = XMVector3Unproject(nearSource, 0.0f, 0.0f, m_ScreenDimensions.right, m_ScreenDimensions.bottom, m_deviceResources->GetScreenViewport().MinDepth, m_deviceResources->GetScreenViewport().MaxDepth, m_projection, m_view, local);
-        XMVECTOR farPoint = XMVector3Unproject(farSource, 0.0f, 0.0f, m_ScreenDimensions.right, m_ScreenDimensions.bottom, m_deviceResources->GetScreenViewport().MinDepth, m_deviceResources->GetScreenViewport().MaxDepth, m_projection, m_view, local);
-
-        //turn the transformed points into our picking vector. 
-        XMVECTOR pickingVector = farPoint - nearPoint;
-        pickingVector = XMVector3Normalize(pickingVector);
+    //Unproject once into the world, the picker takes the ray into each object's space itself
+    Vector3 nearPoint = XMVector3Unproject(nearSource, 0.0f, 0.0f, m_ScreenDimensions.right, m_ScreenDimensions.bottom, m_deviceResources->GetScreenViewport().MinDepth, m_deviceResources->GetScreenViewport().MaxDepth, m_projection, m_view, m_world);
+    Vector3 farPoint = XMVector3Unproject(farSource, 0.0f, 0.0f, m_ScreenDimensions.right, m_ScreenDimensions.bottom, m_deviceResources->GetScreenViewport().MinDepth, m_deviceResources->GetScreenViewport().MaxDepth, m_projection, m_view, m_world);
+    Vector3 pickingVector = farPoint - nearPoint;
+    pickingVector.Normalize();
 
-        //loop through mesh list for object
-        for (int y = 0; y < m_displayList[i].m_model.get()->meshes.size(); y++)
-        {
-            //checking for ray intersection
-            if (m_displayList[i].m_model.get()->meshes[y]->boundingBox.Intersects(nearPoint, pickingVector, pickedDistance))
-            {
-                intersectedObjects.push_back(i);
-                intersectedDistances.push_back(pickedDistance);
-            }
-        }
-    }
-
-    // Add models to vector and check their current IDs. If none are the current ID, select closest. If one is current ID, switch to next object.
-    for (int i = 0; i < intersectedObjects.size(); i++)
-    {
-        if (intersectedObjects[i] == curID)
-        {
-            if (i == intersectedObjects.size() - 1)
-            {
-                selectedID = intersectedObjects[0];
-            }
-            else
-            {
-                selectedID = intersectedObjects[i + 1];
-            }
-           
-            break;
-        }
-        else if (intersectedDistances[i] < closestDistance)
-        {
-           selectedID = intersectedObjects[i];
-           closestDistance = intersectedDistances[i];
-        }
-    }
+    // Closest object whose triangles the ray actually hits
+    float pickedDistance;
+    selectedID = m_objectPicker.Pick(nearPoint, pickingVector, pickedDistance);
 
     // If valid object found, set the object manipulator's object
     if (selectedID >= 0)
@@ -782,24 +1232,28 @@ void Game::ClearRedo()
 
 void Game::Undo()
 {
-    if (!m_undoStack.empty()) // only works when there are actions to undo
+    // Entries whose object has since been unloaded with its chunk can't be undone, drop them and try the next
+    while (!m_undoStack.empty()) // only works when there are actions to undo
     {
         // Get action and object
         Action action = m_undoStack.top();
         SceneObject oldObject = m_undoObjectStack.top();
-        SceneObject* currentObject;
-        int index;
+        int index = -1;
+        SceneObject* currentObject = GetObjectByID(oldObject.ID, index);
         
-        // Add to redo stack, pop undo stakcs
-        m_redoStack.push(action);
+        // Pop undo stacks, add to redo stack if it can be undone
         m_undoStack.pop();
         m_undoObjectStack.pop();
+        if (action != Action::REMOVE && currentObject == nullptr)
+        {
+            continue;
+        }
+        m_redoStack.push(action);
 
         switch (action)
         {
         case Action::ADD:
             // Delete the object, push the old one to the redo stack
-            currentObject = GetObjectByID(oldObject.ID, index);
             m_redoObjectStack.push(oldObject);
             DeleteSceneObject(index);
             m_topID--;
@@ -807,68 +1261,95 @@ void Game::Undo()
             break;
         case Action::MODIFY:
             // Apply changes from old object to the current object after pushing the current object to the stack
-            currentObject = GetObjectByID(oldObject.ID, index);
             m_redoObjectStack.push(*currentObject);
             ApplyChanges(currentObject, oldObject);
             //MessageBox(NULL, L"Modify object undone.", L"Notification", MB_OK);
             break;
         case Action::REMOVE:
             // Add the object back to the scene graph, push to redo stack
-            m_sceneGraph->push_back(oldObject);
+            InsertObject(oldObject);
+            m_changeTracker.MarkModified(oldObject.ID);
             currentObject = &m_sceneGraph->back();
             m_redoObjectStack.push(*currentObject);
             //MessageBox(NULL, L"Remove object undone.", L"Notification", MB_OK);
             break;
         }
-
-        BuildDisplayList(m_sceneGraph); // rebuild display list
+        return;
     }
 }
 
 void Game::Redo()
 {
-    if (!m_redoStack.empty()) // only works when there are actions to redo
+    // As with undo, entries whose object has been unloaded are dropped
+    while (!m_redoStack.empty()) // only works when there are actions to redo
     {
         // Get action and object
         Action action = m_redoStack.top();
         SceneObject oldObject = m_redoObjectStack.top();
-        SceneObject* currentObject;
-        int index;
+        int index = -1;
+        SceneObject* currentObject = GetObjectByID(oldObject.ID, index);
 
-        // add back to undo stack, pop redo stacks
-        m_undoStack.push(action);
+        // Pop redo stacks, add back to undo stack if it can be redone
         m_redoStack.pop();
         m_redoObjectStack.pop();
+        if (action != Action::ADD && currentObject == nullptr)
+        {
+            continue;
+        }
+        m_undoStack.push(action);
 
         switch (action)
         {
         case Action::ADD:
             // Add object back to scene graph and undo stack
-            m_sceneGraph->push_back(oldObject);
+            InsertObject(oldObject);
+            m_changeTracker.MarkModified(oldObject.ID);
             m_undoObjectStack.push(m_sceneGraph->back());
             //MessageBox(NULL, L"Add object redone.", L"Notification", MB_OK);
             break;
         case Action::MODIFY:
             // Apply changes from old object to the current object after pushing the current object to the stack
-            currentObject = GetObjectByID(oldObject.ID, index);
             m_undoObjectStack.push(*currentObject);
             ApplyChanges(currentObject, oldObject);
             //MessageBox(NULL, L"Modify object redone.", L"Notification", MB_OK);
             break;
         case Action::REMOVE:
             // Delete object from the scene graph
-            currentObject = GetObjectByID(oldObject.ID, index);
             m_undoObjectStack.push(*currentObject);
             DeleteSceneObject(index);
             //MessageBox(NULL, L"Remove object redone.", L"Notification", MB_OK);
             break;
         }
-        BuildDisplayList(m_sceneGraph); // rebuild display list
+        return;
+    }
+}
+
+void Game::GetUndoObjectIDs(std::unordered_set<int>& IDs)
+{
+    // Stacks can't be walked, so walk copies. Only called when a chunk is unloaded.
+    std::stack<SceneObject> undo = m_undoObjectStack;
+    for (; !undo.empty(); undo.pop())
+    {
+        IDs.insert(undo.top().ID);
+    }
+
+    std::stack<SceneObject> redo = m_redoObjectStack;
+    for (; !redo.empty(); redo.pop())
+    {
+        IDs.insert(redo.top().ID);
     }
 }
 
 SceneObject* Game::GetObjectByID(int ID, int& returnIndex)
 {
+    // Store indices match the scene graph
+    int index = m_sceneStore.FindIndex(ID);
+    if (index >= 0 && index < (int)m_sceneGraph->size() && m_sceneGraph->at(index).ID == ID)
+    {
+        returnIndex = index;
+        return &m_sceneGraph->at(index);
+    }
+
     // check each objects ID, return the object and position in the scene graph if there is a match
     for (int i = 0; i < m_sceneGraph->size(); i++) 
     {
@@ -893,16 +1374,13 @@ void Game::PositionClashCheck(SceneObject* newSceneObject)
     {
         clashFound = false;
 
-        for (SceneObject object : *m_sceneGraph)
+        if (m_sceneStore.FindAtPosition(newSceneObject->posX, newSceneObject->posY, newSceneObject->posZ) != -1) // if position matches, move to the right
         {
-            if (newSceneObject->posX == object.posX && newSceneObject->posY == object.posY && newSceneObject->posZ == object.posZ) // if position matches, move to the right
-            {
-                position += m_camera.GetRight();
-                newSceneObject->posX = position.x;
-                newSceneObject->posY = position.y;
-                newSceneObject->posZ = position.z;
-                clashFound = true;
-            }
+            position += m_camera.GetRight();
+            newSceneObject->posX = position.x;
+            newSceneObject->posY = position.y;
+            newSceneObject->posZ = position.z;
+            clashFound = true;
         }
 
         if (!clashFound)
@@ -915,28 +1393,19 @@ void Game::PositionClashCheck(SceneObject* newSceneObject)
 void Game::ApplyChanges(SceneObject* newObject, SceneObject oldObject)
 {
     // Assign relevant values
-    newObject->posX = oldObject.posX;
-    newObject->posY = oldObject.posY;
-    newObject->posZ = oldObject.posZ;
-    newObject->rotX = oldObject.rotX;
-    newObject->rotY = oldObject.rotY;
-    newObject->rotZ = oldObject.rotZ;
-    newObject->scaX = oldObject.scaX;
-    newObject->scaY = oldObject.scaY;
-    newObject->scaZ = oldObject.scaZ;
-    newObject->editor_render = oldObject.editor_render;
-    newObject->snapToGround = oldObject.snapToGround;
-    newObject->model_path = oldObject.model_path;
-    newObject->tex_diffuse_path = oldObject.tex_diffuse_path;
+    CopyFields(*newObject, oldObject, SceneObjectFields(), FIELD_TRANSFORM | FIELD_UNDO);
+
+    // Row needs writing on next save
+    m_changeTracker.MarkModified(newObject->ID);
+    UpdateObject(newObject->ID);
 }
 
 void Game::DeleteSceneObject(int index)
 {
-    // Remove object from scene graph
-    m_sceneGraph->erase(m_sceneGraph->begin() + index);
-    *m_currentSelection = -1;
-    BuildDisplayList(m_sceneGraph);
-    GetManipulator()->SetObject(NULL);
+    // Remove object from scene graph, row needs removing on next save
+    int ID = m_sceneGraph->at(index).ID;
+    m_changeTracker.MarkDeleted(ID);
+    RemoveObject(ID);
 }
 
 void Game::AddSceneObject()
@@ -964,28 +1433,18 @@ void Game::AddSceneObject()
     PositionClashCheck(&newSceneObject);
     
     //send completed object to scenegraph
-    m_sceneGraph->push_back(newSceneObject);
+    int index = InsertObject(newSceneObject);
+    m_changeTracker.MarkModified(newSceneObject.ID);
 
-    BuildDisplayList(m_sceneGraph);
-    *m_currentSelection = GetDisplayList()->size() - 1;
-    GetManipulator()->SetObject(&GetDisplayList()->back());
+    *m_currentSelection = index;
+    GetManipulator()->SetObject(&m_displayList[index]);
    
 }
 
-int Game::FindHighestID(std::vector<SceneObject>* sceneGraph)
+int Game::FindHighestID()
 {
     // Returns highest ID in scene graph
-    int highestID = -1;
-    
-    for (SceneObject object : *sceneGraph)
-    {
-        if (object.ID > highestID)
-        {
-            highestID = object.ID;
-        }
-    }
-
-    return highestID;
+    return m_sceneStore.FindHighestID();
 }
 
 #ifdef DXTK_AUDIO
@@ -1085,6 +1544,9 @@ void Game::CreateWindowSizeDependentResources()
 
 void Game::OnDeviceLost()
 {
+    m_assetCache.Clear();
+    m_selectionHighlight.Clear();
+    m_waitingForAssets.clear();
     m_states.reset();
     m_fxFactory.reset();
     m_sprites.reset();
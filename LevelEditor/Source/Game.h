@@ -16,7 +16,21 @@
 #include "ObjectManipulator.h"
 #include "DirectXMath.h"
 #include "TerrainSculpter.h"
+#include "SceneChangeTracker.h"
+#include "SceneStore.h"
+#include "ChunkManager.h"
+#include "AssetCache.h"
+#include "CollisionCache.h"
+#include "ObjectPicker.h"
+#include "FrustumCuller.h"
+#include "TransformKernel.h"
+#include "RenderQueue.h"
+#include "SelectionHighlight.h"
 #include <stack>
+#include <deque>
+#include <map>
+#include <unordered_set>
+#include <functional>
 
 // A basic game implementation that creates a D3D11 device and
 // provides a game loop.
@@ -60,10 +74,29 @@ public:
 
 	//tool specific
 	void BuildDisplayList(std::vector<SceneObject> * SceneGraph); //note vector passed by reference 
+	void AppendDisplayList(std::vector<SceneObject> * SceneGraph, int firstIndex); //only builds objects from firstIndex on, for objects streamed in
+
+	// Single object changes, keeping the scene graph, scene store and display list in step without a rebuild.
+	// Removing moves the last object into the gap. Display objects are in a deque, so pointers to them stay valid.
+	int InsertObject(const SceneObject& object);	//returns the new index
+	void RemoveObject(int ID);
+	void UpdateObject(int ID);						//after the scene graph object has been changed
 	void BuildDisplayChunk(ChunkObject *SceneChunk);
 	void SaveDisplayChunk(ChunkObject *SceneChunk);	//saves geometry et al
+
+	// Chunks around the one being edited, these are only displayed
+	void AddNeighbourChunk(ChunkObject *SceneChunk, float originX, float originZ, const std::vector<BYTE>& heightMap);
+	void RemoveNeighbourChunk(int chunkID);
+	void ClearNeighbourChunks();
+	void StitchChunks();	//match up the edges of neighbouring chunks so there are no seams
+	void ApplyHeightMap(const std::vector<BYTE>& heightMap);	//replace the edited chunk's heightmap, e.g. with recovered edits
+
+	// Take the objects of an unloaded chunk out of the scene graph and display list, apart from those in keep.
+	// IDs of the removed objects are added to removed.
+	void RemoveChunkObjects(int chunkID, const std::unordered_set<int>& keep, std::vector<int>& removed);
+	void RemoveObjects(const std::function<bool(const SceneObject&)>& unload, const std::unordered_set<int>& keep, std::vector<int>& removed);	//the same for any objects unload picks
 	void ClearDisplayList();
-	std::vector<DisplayObject>* GetDisplayList() { return &m_displayList; };
+	std::deque<DisplayObject>* GetDisplayList() { return &m_displayList; };
 	float GetDeltaTime() { return m_timer.GetElapsedSeconds(); };
 
 	// Object manipulation functions
@@ -110,9 +143,10 @@ public:
 	void AddToObjectStack(SceneObject object);
 	void ClearUndoRedo();
 	void ClearRedo();
+	void GetUndoObjectIDs(std::unordered_set<int>& IDs);	//objects the undo and redo stacks refer to, added to IDs
 
 	// Object functions
-	int FindHighestID(std::vector<SceneObject>* sceneGraph);
+	int FindHighestID();
 	SceneObject* GetObjectByID(int ID, int& returnIndex);
 	void PositionClashCheck(SceneObject* object);
 
@@ -120,9 +154,31 @@ public:
 	void ApplyChanges(SceneObject* newObject, SceneObject oldObject);
 	void DeleteSceneObject(int index);
 	void AddSceneObject();
+
+	// Objects changed since the last save
+	SceneChangeTracker* GetChangeTracker() { return &m_changeTracker; };
+
+	// Structure of arrays copy of the scene graph for queries over every object
+	const SceneStore* GetSceneStore() { return &m_sceneStore; };
+
+	// Models and textures shared by the display list
+	const AssetCacheStats& GetAssetCacheStats() { return m_assetCache.GetStats(); };
+	double TimeAssetLoad(int workerCount);	//seconds to load every model and texture in the scene graph from disk
+	int GetPendingAssetCount() { return m_assetCache.GetPendingCount(); };	//model and texture pairs still streaming in
+	double TimePicking(int objectCount, int rayCount);	//average seconds a pick takes with the display list repeated to objectCount
+	double TimeRender(int frameCount, int selection);	//average CPU seconds to render a frame of the current view with selection highlighted, not counting Present
+
+	// What the last frame's culling found and how many objects it drew
+	const CullStats& GetCullStats() { return m_frustumCuller.GetStats(); };
+	int GetDrawnObjectCount() { return m_drawnObjects; };
+	int GetDrawCallCount() { return m_drawCalls; };		//one per mesh part per object, batching doesn't change it
+	const RenderQueueStats& GetRenderQueueStats() { return m_renderQueue.GetStats(); };
 	
 	// Highest ID, used for making new objects
 	int m_topID;
+
+	// Highest ID in the database, when only part of the level is loaded new IDs must still be above it
+	void SetStoredTopID(int ID) { m_storedTopID = ID; };
 #ifdef DXTK_AUDIO
 	void NewAudioDevice();
 #endif
@@ -133,6 +189,11 @@ private:
 	void Update(DX::StepTimer const& timer);
 
 	void CreateDeviceDependentResources();
+
+	void MakeDisplayObject(const SceneObject& object, DisplayObject& displayObject);
+	void SetLocalBounds(DisplayObject& displayObject, const std::shared_ptr<const CollisionMesh>& mesh);	//collision mesh bounds, or the model's if there's no mesh
+	std::shared_ptr<const CollisionMesh> FindCollisionMesh(const std::string& modelPath);	//cooked mesh, null until the asset loader has read the model
+	void UpdateAssetStreaming(DX::StepTimer const& timer);
 	void CreateWindowSizeDependentResources();
 
 	void XM_CALLCONV DrawGrid(DirectX::FXMVECTOR xAxis, DirectX::FXMVECTOR yAxis, DirectX::FXMVECTOR origin, size_t xdivs, size_t ydivs, DirectX::GXMVECTOR color);
@@ -146,11 +207,13 @@ private:
 
 	// Scene graph pointer
 	std::vector<SceneObject>* m_sceneGraph;
+	int m_storedTopID;
 	int* m_currentSelection;
 
 	//tool specific
-	std::vector<DisplayObject>			m_displayList;
+	std::deque<DisplayObject>			m_displayList;
 	DisplayChunk						m_displayChunk;
+	std::map<int, std::unique_ptr<DisplayChunk>>	m_neighbourChunks;	//by chunk ID
 	InputCommands						m_InputCommands;
 
 	// Camera, object manipulation, and terrain editing classes
@@ -158,6 +221,40 @@ private:
 	ObjectManipulator					m_objectManipulator;
 	TerrainSculpter						m_terrainSculpter;
 
+	// Tracks edited objects so saves only write what has changed
+	SceneChangeTracker					m_changeTracker;
+
+	// Dense ID and transform arrays for the scene graph, rebuilt with the display list. The selection's transform is copied in every frame.
+	SceneStore							m_sceneStore;
+
+	// Cooked triangles for every model, filled in by the asset cache's loader threads, so it's declared first to outlive them
+	CollisionCache						m_collisionCache;
+
+	// Models and textures by path, shared between display objects
+	AssetCache							m_assetCache;
+
+	// The boxes and meshes picking traces against, index-parallel to the display list
+	ObjectPicker						m_objectPicker;
+
+	// IDs of objects showing the placeholder, by the model and texture pair they are waiting for
+	std::map<std::pair<std::string, std::string>, std::vector<int>> m_waitingForAssets;
+	float m_assetPriorityTimer;
+
+	// Display list indices inside the view this frame, how many of them were drawn and with how many draw calls
+	FrustumCuller						m_frustumCuller;
+	std::vector<int>					m_visibleObjects;
+	int									m_drawnObjects;
+	int									m_drawCalls;
+
+	// Visible objects sorted into batches that share state, rebuilt every frame
+	RenderQueue							m_renderQueue;
+
+	// Highlighted copy of the selected object's model
+	SelectionHighlight					m_selectionHighlight;
+
+	// CPU time the last frame took to render, not counting Present
+	double								m_renderSeconds;
+
 	// Toggles
 	bool m_sculptModeActive;
 	bool m_wireframeObjects;
@@ -0,0 +1,195 @@
+#include "HeadlessChecks.h"
+#include "CmoReader.h"
+#include "RenderQueue.h"
+#include <cstdio>
+#include <vector>
+
+// The models in database/data and their triangles, a model added there should be added here
+struct ExpectedModel
+{
+	const char* path;
+	size_t triangles;
+};
+
+static const ExpectedModel s_expectedModels[] = {
+	{ "database/data/bedroll.cmo", 166 },
+	{ "database/data/campfire.cmo", 401 },
+	{ "database/data/corgi.cmo", 1578 },
+	{ "database/data/crate.cmo", 12 },
+	{ "database/data/doghouse.cmo", 100 },
+	{ "database/data/placeholder.cmo", 192 },
+	{ "database/data/pug.cmo", 1325 },
+	{ "database/data/thrall.cmo", 7138 },
+};
+
+bool HeadlessChecks::CheckModels(const char* scratchPath, std::string& error)
+{
+	for (const ExpectedModel& expected : s_expectedModels)
+	{
+		CmoReader reader;
+		if (!reader.Open(expected.path))
+		{
+			error = std::string("Can't open ") + expected.path + ": " + reader.GetError();
+			return false;
+		}
+
+		if (reader.GetTriangleCount() != expected.triangles)
+		{
+			error = std::string(expected.path) + " has " + std::to_string(reader.GetTriangleCount()) + " triangles instead of " + std::to_string(expected.triangles);
+			return false;
+		}
+
+		// Walking the triangles touches every index, so a bad one would show up under a memory checker
+		size_t walked = 0;
+		reader.ForEachTriangle([&walked](const float*, const float*, const float*) { walked++; });
+		if (walked != expected.triangles)
+		{
+			error = std::string(expected.path) + " walked " + std::to_string(walked) + " triangles instead of " + std::to_string(expected.triangles);
+			return false;
+		}
+
+		// Every length short of the whole file, parsed in place
+		std::vector<unsigned char> data(reader.GetData(), reader.GetData() + reader.GetSize());
+		for (size_t length = 0; length < data.size(); length++)
+		{
+			CmoReader truncated;
+			if (truncated.Parse(data.data(), length))
+			{
+				error = std::string(expected.path) + " parsed when cut to " + std::to_string(length) + " bytes";
+				return false;
+			}
+		}
+
+		// And a few written out, so Open's mapping of a short file is covered too
+		size_t lengths[] = { 0, 1, 4, data.size() / 4, data.size() / 2, data.size() - 1 };
+		for (size_t length : lengths)
+		{
+			FILE* file = fopen(scratchPath, "wb");
+			if (file == NULL)
+			{
+				error = std::string("Can't write ") + scratchPath;
+				return false;
+			}
+			size_t written = fwrite(data.data(), 1, length, file);
+			fclose(file);
+
+			CmoReader truncated;
+			bool opened = written == length && truncated.Open(scratchPath);
+			truncated.Close();
+			remove(scratchPath);
+			if (written != length)
+			{
+				error = std::string("Can't write ") + scratchPath;
+				return false;
+			}
+			if (opened)
+			{
+				error = std::string(expected.path) + " opened when cut to " + std::to_string(length) + " bytes";
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool HeadlessChecks::CheckRenderQueue(std::string& error)
+{
+	RenderQueue queue;
+
+	// Keys are handed out in the order resources are first seen, null is always 0
+	int modelA, modelB, textureX, textureY;
+	uint32_t a = queue.GetResourceKey(&modelA);
+	uint32_t b = queue.GetResourceKey(&modelB);
+	uint32_t x = queue.GetResourceKey(&textureX);
+	uint32_t y = queue.GetResourceKey(&textureY);
+	if (a != 1 || b != 2 || x != 3 || y != 4 || queue.GetResourceKey(&modelA) != 1 || queue.GetResourceKey(NULL) != 0)
+	{
+		error = "Resource keys aren't dense and stable";
+		return false;
+	}
+
+	// Display list index, model, texture, wireframe, selected. Added last index first so the sort has to restore the order.
+	struct Queued { int index; uint32_t model; uint32_t texture; bool wireframe; bool selected; };
+	Queued queued[] = {
+		{ 6, a, x, false, false },
+		{ 5, a, x, false, true },
+		{ 4, a, x, true, false },
+		{ 3, b, x, false, false },
+		{ 2, a, y, false, false },
+		{ 1, a, x, false, false },
+		{ 0, b, x, false, false },
+	};
+
+	// Filled twice, the second time after a Clear, which must leave nothing of the first behind
+	for (int pass = 0; pass < 2; pass++)
+	{
+		queue.Clear();
+		for (const Queued& item : queued)
+		{
+			queue.Add(item.index, item.model, item.texture, item.wireframe, item.selected);
+		}
+		queue.Sort();
+	}
+
+	// Filled, then highlighted, then wireframe; by model then texture within each
+	struct ExpectedBatch { int first; int count; uint32_t model; uint32_t texture; bool wireframe; bool selected; };
+	ExpectedBatch expectedBatches[] = {
+		{ 0, 2, a, x, false, false },
+		{ 2, 1, a, y, false, false },
+		{ 3, 2, b, x, false, false },
+		{ 5, 1, a, x, false, true },
+		{ 6, 1, a, x, true, false },
+	};
+	int expectedOrder[] = { 1, 6, 2, 0, 3, 5, 4 };
+
+	const std::vector<RenderBatch>& batches = queue.GetBatches();
+	const int expectedCount = (int)(sizeof(expectedBatches) / sizeof(expectedBatches[0]));
+	if ((int)batches.size() != expectedCount)
+	{
+		error = std::to_string(batches.size()) + " batches instead of " + std::to_string(expectedCount);
+		return false;
+	}
+
+	for (int i = 0; i < expectedCount; i++)
+	{
+		const RenderBatch& batch = batches[i];
+		const ExpectedBatch& expected = expectedBatches[i];
+		if (batch.first != expected.first || batch.count != expected.count || batch.model != expected.model || batch.texture != expected.texture
+			|| batch.wireframe != expected.wireframe || batch.selected != expected.selected)
+		{
+			error = "Batch " + std::to_string(i) + " starts at " + std::to_string(batch.first) + " with " + std::to_string(batch.count)
+				+ " objects, expected " + std::to_string(expected.first) + " with " + std::to_string(expected.count) + " or its state is wrong";
+			return false;
+		}
+	}
+
+	const std::vector<RenderItem>& items = queue.GetItems();
+	for (int i = 0; i < (int)items.size(); i++)
+	{
+		if (items[i].index != expectedOrder[i])
+		{
+			error = "Item " + std::to_string(i) + " is object " + std::to_string(items[i].index) + " instead of " + std::to_string(expectedOrder[i]);
+			return false;
+		}
+	}
+
+	// Model changes between the a-y and b-x batches, then back to a for the highlight
+	const RenderQueueStats& stats = queue.GetStats();
+	if (stats.objects != 7 || stats.batches != expectedCount || stats.modelChanges != 2)
+	{
+		error = std::to_string(stats.objects) + " objects, " + std::to_string(stats.batches) + " batches and " + std::to_string(stats.modelChanges)
+			+ " model changes, expected 7, " + std::to_string(expectedCount) + " and 2";
+		return false;
+	}
+
+	// Keys keep each field to its own bits, so a texture key can't spill into the model's
+	if (RenderQueue::MakeKey(1, 0x7fffffff, false, false) >= RenderQueue::MakeKey(2, 0, false, false)
+		|| RenderQueue::MakeKey(0x7fffffff, 0x7fffffff, false, true) >= RenderQueue::MakeKey(0, 0, true, false))
+	{
+		error = "Sort key fields overlap";
+		return false;
+	}
+
+	return true;
+}
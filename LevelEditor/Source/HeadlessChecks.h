@@ -0,0 +1,16 @@
+#pragma once
+#include <string>
+
+// Correctness checks for the parts that don't need a window or a device, run with -check from the command line.
+// Each returns false with error set to the first thing that was wrong.
+class HeadlessChecks
+{
+public:
+	// Every model shipped in database/data opens with the triangle count it was exported with, and copies cut short
+	// anywhere fail to open instead of reading off the end. The cut copies are written to scratchPath, then deleted.
+	static bool CheckModels(const char* scratchPath, std::string& error);
+
+	// A known mix of models, textures, wireframe and selection splits into the right batches, in key order, with each
+	// batch's objects in display list order and the model changes between batches counted
+	static bool CheckRenderQueue(std::string& error);
+};
@@ -0,0 +1,305 @@
+#include "HeadlessRunner.h"
+#include "LevelGenerator.h"
+#include "SceneBenchmark.h"
+#include "CollisionCache.h"
+#include "HeadlessChecks.h"
+#include "RenderQueue.h"
+#include "CmoReader.h"
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+// Generated benchmark levels cover this many chunks a side
+#define BENCHMARK_CHUNKS_PER_SIDE 4
+
+bool HeadlessRunner::Run(const std::vector<std::string>& args, const char* templatePath, int& exitCode)
+{
+	if (args.size() < 2)
+	{
+		return false;
+	}
+
+	if (args[1] == "-generate")
+	{
+		exitCode = Generate(args, templatePath);
+		return true;
+	}
+
+	if (args[1] == "-benchmark")
+	{
+		exitCode = RunBenchmark(args, templatePath);
+		return true;
+	}
+
+	if (args[1] == "-cook")
+	{
+		exitCode = Cook(args, templatePath);
+		return true;
+	}
+
+	if (args[1] == "-validate")
+	{
+		exitCode = Validate();
+		return true;
+	}
+
+	if (args[1] == "-check")
+	{
+		exitCode = Check();
+		return true;
+	}
+
+	if (args[1] == "-drawcalls")
+	{
+		exitCode = DrawCalls(args, templatePath);
+		return true;
+	}
+
+	return false;
+}
+
+int HeadlessRunner::Generate(const std::vector<std::string>& args, const char* templatePath)
+{
+	if (args.size() < 4)
+	{
+		printf("Usage: -generate <output.db> <objects> [uniform|clustered|grid] [chunks per side] [seed]\n");
+		return 1;
+	}
+
+	LevelSettings settings;
+	settings.objectCount = atoi(args[3].c_str());
+	if (args.size() > 4 && !LevelGenerator::ParseDistribution(args[4], settings.distribution))
+	{
+		printf("Unknown distribution %s\n", args[4].c_str());
+		return 1;
+	}
+	if (args.size() > 5)
+	{
+		settings.chunksPerSide = atoi(args[5].c_str());
+	}
+	if (args.size() > 6)
+	{
+		settings.seed = (unsigned int)strtoul(args[6].c_str(), NULL, 10);
+	}
+
+	SceneDatabase templateDatabase;
+	if (!templateDatabase.Open(templatePath))
+	{
+		printf("Can't open template %s: %s\n", templatePath, templateDatabase.GetLastError().c_str());
+		return 1;
+	}
+
+	std::string error;
+	BenchmarkTimer timer;
+	if (!LevelGenerator::Generate(args[2].c_str(), &templateDatabase, settings, error))
+	{
+		printf("Generate failed: %s\n", error.c_str());
+		return 1;
+	}
+
+	printf("Wrote %d %s objects to %s in %.2fs\n", settings.objectCount, LevelGenerator::GetDistributionName(settings.distribution), args[2].c_str(), timer.GetElapsedSeconds());
+	return 0;
+}
+
+int HeadlessRunner::RunBenchmark(const std::vector<std::string>& args, const char* templatePath)
+{
+	std::string resultsPath = args.size() > 2 ? args[2] : "benchmark_results.csv";
+
+	LevelSettings settings;
+	settings.chunksPerSide = BENCHMARK_CHUNKS_PER_SIDE;
+	if (args.size() > 3 && !LevelGenerator::ParseDistribution(args[3], settings.distribution))
+	{
+		printf("Unknown distribution %s\n", args[3].c_str());
+		return 1;
+	}
+
+	SceneDatabase templateDatabase;
+	if (!templateDatabase.Open(templatePath))
+	{
+		printf("Can't open template %s: %s\n", templatePath, templateDatabase.GetLastError().c_str());
+		return 1;
+	}
+
+	Benchmark benchmark;
+	std::string error;
+	std::vector<int> sizes = { 1000, 10000, 100000, 1000000 };
+	bool success = SceneBenchmark::RunGenerated(&templateDatabase, "database/benchmark.db", sizes, settings, benchmark, error);
+
+	// Whatever finished is still worth keeping
+	for (const BenchmarkResult& result : benchmark.GetResults())
+	{
+		printf("%s,%s,%d,%.6f,%.1f\n", result.suite.c_str(), result.name.c_str(), result.objectCount, result.seconds, result.itemsPerSecond);
+	}
+
+	if (!benchmark.WriteCSV(resultsPath.c_str()))
+	{
+		printf("Can't write %s\n", resultsPath.c_str());
+		return 1;
+	}
+
+	if (!success)
+	{
+		printf("Benchmark failed: %s\n", error.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
+int HeadlessRunner::Cook(const std::vector<std::string>& args, const char* templatePath)
+{
+	std::string levelPath = args.size() > 2 ? args[2] : templatePath;
+
+	SceneDatabase database;
+	std::vector<SceneObject> objects;
+	if (!database.Open(levelPath.c_str()) || !database.LoadObjects(objects))
+	{
+		printf("Can't load %s: %s\n", levelPath.c_str(), database.GetLastError().c_str());
+		return 1;
+	}
+
+	std::set<std::string> models;
+	for (const SceneObject& object : objects)
+	{
+		models.insert(object.model_path);
+	}
+
+	// Models already cooked and unchanged are only stat'ed
+	CollisionCache cache;
+	cache.Load(COLLISION_CACHE_PATH);
+
+	BenchmarkTimer timer;
+	int failed = 0;
+	for (const std::string& model : models)
+	{
+		if (!cache.Get(model))
+		{
+			printf("Can't cook %s\n", cache.GetLastError().c_str());
+			failed++;
+		}
+	}
+
+	if (!cache.Save(COLLISION_CACHE_PATH))
+	{
+		printf("%s\n", cache.GetLastError().c_str());
+		return 1;
+	}
+
+	printf("%d models, %d cooked, %d already cached, %d failed in %.2fs\n", (int)models.size(), cache.GetCooked(), cache.GetHits(), failed, timer.GetElapsedSeconds());
+	return failed == 0 ? 0 : 1;
+}
+
+int HeadlessRunner::Validate()
+{
+	CollisionCache cache;
+	if (!cache.Load(COLLISION_CACHE_PATH))
+	{
+		printf("Can't load %s: %s\n", COLLISION_CACHE_PATH, cache.GetLastError().c_str());
+		return 1;
+	}
+
+	int failed = 0;
+	for (const auto& mesh : cache.GetMeshes())
+	{
+		std::string error;
+		bool valid = mesh.second->Validate(error);
+		printf("%016llx %6d vertices %6d triangles %6d nodes %8d bytes %s\n", (unsigned long long)mesh.first, (int)mesh.second->GetVertexCount(),
+			(int)mesh.second->GetTriangleCount(), (int)mesh.second->GetNodes().size(), (int)mesh.second->GetBytes(), valid ? "ok" : error.c_str());
+		failed += valid ? 0 : 1;
+	}
+
+	printf("%d meshes, %d failed\n", (int)cache.GetMeshes().size(), failed);
+	return failed == 0 ? 0 : 1;
+}
+
+int HeadlessRunner::Check()
+{
+	struct NamedCheck
+	{
+		const char* name;
+		bool (*run)(std::string& error);
+	};
+
+	NamedCheck checks[] = {
+		{ "models", [](std::string& error) { return HeadlessChecks::CheckModels("database/check.cmo", error); } },
+		{ "render_queue", HeadlessChecks::CheckRenderQueue },
+	};
+
+	int failed = 0;
+	for (const NamedCheck& check : checks)
+	{
+		std::string error;
+		bool passed = check.run(error);
+		printf("%-12s %s\n", check.name, passed ? "ok" : error.c_str());
+		failed += passed ? 0 : 1;
+	}
+
+	printf("%d checks, %d failed\n", (int)(sizeof(checks) / sizeof(checks[0])), failed);
+	return failed == 0 ? 0 : 1;
+}
+
+int HeadlessRunner::DrawCalls(const std::vector<std::string>& args, const char* templatePath)
+{
+	std::string levelPath = args.size() > 2 ? args[2] : templatePath;
+
+	SceneDatabase database;
+	std::vector<SceneObject> objects;
+	if (!database.Open(levelPath.c_str()) || !database.LoadObjects(objects))
+	{
+		printf("Can't load %s: %s\n", levelPath.c_str(), database.GetLastError().c_str());
+		return 1;
+	}
+
+	// Every object in view and nothing selected, keyed the way the editor's shared models and textures are
+	RenderQueue queue;
+	BenchmarkTimer timer;
+	for (int i = 0; i < (int)objects.size(); i++)
+	{
+		queue.Add(i, queue.GetResourceKey(&objects[i].model_path.str()), queue.GetResourceKey(&objects[i].tex_diffuse_path.str()), false, false);
+	}
+	queue.Sort();
+	double seconds = timer.GetElapsedSeconds();
+
+	// Largest batches first
+	std::vector<RenderBatch> batches = queue.GetBatches();
+	std::sort(batches.begin(), batches.end(), [](const RenderBatch& a, const RenderBatch& b) { return a.count > b.count; });
+	for (int i = 0; i < (int)batches.size() && i < 10; i++)
+	{
+		const SceneObject& object = objects[queue.GetItems()[batches[i].first].index];
+		printf("%8d objects %s %s\n", batches[i].count, object.model_path.c_str(), object.tex_diffuse_path.c_str());
+	}
+
+	// Model::Draw sets up each mesh's states for the opaque pass and again for the alpha pass, then draws each part in
+	// its pass. The editor does the same once per batch instead of once per object, but still draws every part.
+	std::map<std::string, CmoReader> models;
+	long long drawCalls = 0;
+	long long setupsPerObject = 0;
+	long long setupsPerBatch = 0;
+	for (const RenderBatch& batch : queue.GetBatches())
+	{
+		const std::string& path = objects[queue.GetItems()[batch.first].index].model_path.str();
+		auto model = models.find(path);
+		if (model == models.end())
+		{
+			model = models.emplace(std::piecewise_construct, std::forward_as_tuple(path), std::forward_as_tuple()).first;
+			if (!model->second.Open(path.c_str()))
+			{
+				printf("Can't read %s, counted as no meshes: %s\n", path.c_str(), model->second.GetError().c_str());
+			}
+		}
+
+		for (const CmoMesh& mesh : model->second.GetMeshes())
+		{
+			drawCalls += (long long)mesh.submeshes.size() * batch.count;
+			setupsPerObject += 2LL * batch.count;
+			setupsPerBatch += 2;
+		}
+	}
+
+	const RenderQueueStats& stats = queue.GetStats();
+	printf("%d objects in %d batches, %d model changes, sorted in %.2fms\n", stats.objects, stats.batches, stats.modelChanges, seconds * 1000.0);
+	printf("%lld draw calls either way, %lld state setups batched against %lld per object\n", drawCalls, setupsPerBatch, setupsPerObject);
+	return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Command line modes that run without opening the editor window:
+//   -generate <output.db> <objects> [uniform|clustered|grid] [chunks per side] [seed]
+//       write a synthetic level using the template's schema and chunk settings
+//   -benchmark [results.csv] [uniform|clustered|grid]
+//       generate levels of 1k, 10k, 100k and 1M objects and time loading, saving, scene graph operations,
+//       picking, frustum culling, batch transforms and render queue sorting on each, results are appended to the csv.
+//       Fails if culling or the SIMD transforms don't match their brute force or scalar versions.
+//   -drawcalls [level.db]
+//       report the draw calls and state setups drawing every object in the level takes, with the render queue's
+//       batches and without them. Nothing is instanced, so batching only cuts the state setups.
+//   -cook [level.db]
+//       cook collision meshes for every model the level uses into the collision cache
+//   -validate
+//       check every mesh in the collision cache, reading only the cache
+//   -check
+//       run the correctness checks in HeadlessChecks, exits with 1 if any fail
+class HeadlessRunner
+{
+public:
+	// Returns false if the arguments aren't a headless command, so the editor should start as normal
+	static bool Run(const std::vector<std::string>& args, const char* templatePath, int& exitCode);
+
+private:
+	static int Generate(const std::vector<std::string>& args, const char* templatePath);
+	static int RunBenchmark(const std::vector<std::string>& args, const char* templatePath);
+	static int Cook(const std::vector<std::string>& args, const char* templatePath);
+	static int Validate();
+	static int Check();
+	static int DrawCalls(const std::vector<std::string>& args, const char* templatePath);
+};
@@ -0,0 +1,76 @@
+#include "InternedString.h"
+#include <unordered_set>
+#include <mutex>
+
+// Set nodes don't move when the set grows, so handles stay valid without holding the lock
+static std::unordered_set<std::string>& GetTable()
+{
+	static std::unordered_set<std::string> table;
+	return table;
+}
+
+static std::mutex& GetTableMutex()
+{
+	static std::mutex mutex;
+	return mutex;
+}
+
+static const std::string* GetEmptyString()
+{
+	static const std::string* empty = []
+	{
+		std::lock_guard<std::mutex> lock(GetTableMutex());
+		return &*GetTable().insert(std::string()).first;
+	}();
+	return empty;
+}
+
+InternedString::InternedString()
+{
+	m_string = GetEmptyString();
+}
+
+InternedString::InternedString(const std::string& text)
+{
+	m_string = Intern(text);
+}
+
+InternedString::InternedString(const char* text)
+{
+	m_string = Intern(text == NULL ? std::string() : std::string(text));
+}
+
+InternedString& InternedString::operator=(const std::string& text)
+{
+	m_string = Intern(text);
+	return *this;
+}
+
+InternedString& InternedString::operator=(const char* text)
+{
+	m_string = Intern(text == NULL ? std::string() : std::string(text));
+	return *this;
+}
+
+size_t InternedString::GetTableSize()
+{
+	std::lock_guard<std::mutex> lock(GetTableMutex());
+	return GetTable().size();
+}
+
+const std::string* InternedString::Intern(const std::string& text)
+{
+	// Most objects leave some paths blank, skip the lock for them
+	if (text.empty())
+	{
+		return GetEmptyString();
+	}
+
+	std::lock_guard<std::mutex> lock(GetTableMutex());
+	return &*GetTable().insert(text).first;
+}
+
+std::ostream& operator<<(std::ostream& stream, const InternedString& text)
+{
+	return stream << text.str();
+}
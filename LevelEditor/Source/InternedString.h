@@ -0,0 +1,40 @@
+#pragma once
+#include <string>
+#include <ostream>
+
+// Handle to a string held once in a global table. Asset paths repeat across thousands of objects, so
+// SceneObject keeps handles instead of its own copies: copying is a pointer copy and equality a pointer compare.
+// Interning is thread safe, so the save and load workers can build objects. Entries are never freed.
+class InternedString
+{
+public:
+	InternedString();
+	InternedString(const std::string& text);
+	InternedString(const char* text);
+
+	InternedString& operator=(const std::string& text);
+	InternedString& operator=(const char* text);
+
+	// Same handle means same text
+	bool operator==(const InternedString& other) const { return m_string == other.m_string; };
+	bool operator!=(const InternedString& other) const { return m_string != other.m_string; };
+
+	// Read access, the text stays valid for the life of the program
+	const std::string& str() const { return *m_string; };
+	operator const std::string&() const { return *m_string; };
+	const char* c_str() const { return m_string->c_str(); };
+	bool empty() const { return m_string->empty(); };
+	size_t size() const { return m_string->size(); };
+	std::string::const_iterator begin() const { return m_string->begin(); };
+	std::string::const_iterator end() const { return m_string->end(); };
+
+	// Number of distinct strings in the table
+	static size_t GetTableSize();
+
+private:
+	static const std::string* Intern(const std::string& text);
+
+	const std::string* m_string;
+};
+
+std::ostream& operator<<(std::ostream& stream, const InternedString& text);
@@ -0,0 +1,198 @@
+#include "LevelGenerator.h"
+#include "ChunkManager.h"
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+// Model and texture pairs from database/data
+static const char* s_models[][2] =
+{
+	{ "database/data/bedroll.cmo",		"database/data/bedroll.dds" },
+	{ "database/data/campfire.cmo",		"database/data/campfire.dds" },
+	{ "database/data/crate.cmo",		"database/data/crate.dds" },
+	{ "database/data/doghouse.cmo",		"database/data/doghouse.dds" },
+	{ "database/data/pug.cmo",			"database/data/pug.dds" },
+	{ "database/data/thrall.cmo",		"database/data/thrall.dds" },
+	{ "database/data/placeholder.cmo",	"database/data/placeholder.dds" },
+};
+static const int s_modelCount = sizeof(s_models) / sizeof(s_models[0]);
+
+LevelSettings::LevelSettings()
+{
+	objectCount = 1000;
+	chunksPerSide = 1;
+	distribution = LevelDistribution::UNIFORM;
+	clusterCount = 16;
+	clusterRadius = 30.0f;
+	seed = 1;
+}
+
+void LevelGenerator::GenerateObjects(const LevelSettings& settings, std::vector<SceneObject>& objects)
+{
+	std::mt19937 random(settings.seed);
+
+	// Chunks are centred on their origin, chunk 0 on the world origin
+	float halfChunk = CHUNK_SIZE_METRES * 0.5f;
+	float minCorner = -halfChunk;
+	float maxCorner = settings.chunksPerSide * CHUNK_SIZE_METRES - halfChunk;
+	std::uniform_real_distribution<float> anywhere(minCorner, maxCorner);
+	std::uniform_real_distribution<float> angle(0.0f, 360.0f);
+	std::uniform_int_distribution<int> model(0, s_modelCount - 1);
+
+	std::vector<std::pair<float, float>> clusters;
+	for (int i = 0; i < settings.clusterCount; i++)
+	{
+		clusters.push_back(std::make_pair(anywhere(random), anywhere(random)));
+	}
+	std::uniform_int_distribution<int> cluster(0, std::max(settings.clusterCount, 1) - 1);
+	std::normal_distribution<float> offset(0.0f, settings.clusterRadius);
+
+	// Enough rows and columns for every object
+	int gridWidth = (int)std::ceil(std::sqrt((double)settings.objectCount));
+	float gridSpacing = (maxCorner - minCorner) / std::max(gridWidth, 1);
+
+	// Copies share the prototype's cold columns rather than each having their own
+	SceneObject prototype;
+	prototype.EditCold().name = "generated";
+
+	objects.reserve(objects.size() + settings.objectCount);
+	for (int i = 0; i < settings.objectCount; i++)
+	{
+		float x, z;
+		switch (settings.distribution)
+		{
+		default:
+		case LevelDistribution::UNIFORM:
+			x = anywhere(random);
+			z = anywhere(random);
+			break;
+		case LevelDistribution::CLUSTERED:
+			if (clusters.empty())
+			{
+				x = anywhere(random);
+				z = anywhere(random);
+			}
+			else
+			{
+				const std::pair<float, float>& centre = clusters[cluster(random)];
+				x = std::min(std::max(centre.first + offset(random), minCorner), maxCorner);
+				z = std::min(std::max(centre.second + offset(random), minCorner), maxCorner);
+			}
+			break;
+		case LevelDistribution::GRID:
+			x = minCorner + (i % gridWidth + 0.5f) * gridSpacing;
+			z = minCorner + (i / gridWidth + 0.5f) * gridSpacing;
+			break;
+		}
+
+		ChunkCoord coord = ChunkManager::GetCoordAt(x, z);
+		int asset = model(random);
+
+		// Rest of the fields are the constructor's defaults
+		SceneObject object = prototype;
+		object.ID = i;
+		object.chunk_ID = std::min(coord.z, settings.chunksPerSide - 1) * CHUNK_GRID_WIDTH + std::min(coord.x, settings.chunksPerSide - 1);
+		object.model_path = s_models[asset][0];
+		object.tex_diffuse_path = s_models[asset][1];
+		object.posX = x;
+		object.posY = 0.0f;
+		object.posZ = z;
+		object.rotY = angle(random);
+		object.scaX = 1.0f;
+		object.scaY = 1.0f;
+		object.scaZ = 1.0f;
+		object.snapToGround = true;
+		objects.push_back(object);
+	}
+}
+
+bool LevelGenerator::Generate(const char* path, SceneDatabase* templateDatabase, const LevelSettings& settings, std::string& error)
+{
+	std::vector<ChunkObject> templateChunks;
+	if (!templateDatabase->LoadChunks(templateChunks) || templateChunks.empty())
+	{
+		error = "Template has no chunks";
+		return false;
+	}
+
+	if (settings.chunksPerSide < 1 || settings.chunksPerSide > CHUNK_GRID_WIDTH)
+	{
+		error = "Chunks per side must be between 1 and " + std::to_string(CHUNK_GRID_WIDTH);
+		return false;
+	}
+
+	remove(path);
+	SceneDatabase database;
+	if (!database.Open(path, true) || !database.CopySchema(templateDatabase))
+	{
+		error = database.GetLastError();
+		return false;
+	}
+
+	// Every chunk uses the template's first chunk settings and heightmap
+	std::vector<ChunkObject> chunks;
+	for (int z = 0; z < settings.chunksPerSide; z++)
+	{
+		for (int x = 0; x < settings.chunksPerSide; x++)
+		{
+			ChunkObject chunk = templateChunks[0];
+			chunk.ID = z * CHUNK_GRID_WIDTH + x;
+			chunk.name = "Generated " + std::to_string(x) + "," + std::to_string(z);
+			chunks.push_back(chunk);
+		}
+	}
+
+	if (!database.SaveChunks(chunks))
+	{
+		error = database.GetLastError();
+		return false;
+	}
+
+	std::vector<SceneObject> objects;
+	GenerateObjects(settings, objects);
+
+	if (!database.SaveObjects(objects).success)
+	{
+		error = database.GetLastError();
+		return false;
+	}
+
+	return true;
+}
+
+const char* LevelGenerator::GetDistributionName(LevelDistribution distribution)
+{
+	switch (distribution)
+	{
+	case LevelDistribution::CLUSTERED:
+		return "clustered";
+	case LevelDistribution::GRID:
+		return "grid";
+	default:
+	case LevelDistribution::UNIFORM:
+		return "uniform";
+	}
+}
+
+bool LevelGenerator::ParseDistribution(const std::string& name, LevelDistribution& distribution)
+{
+	if (name == "uniform")
+	{
+		distribution = LevelDistribution::UNIFORM;
+	}
+	else if (name == "clustered")
+	{
+		distribution = LevelDistribution::CLUSTERED;
+	}
+	else if (name == "grid")
+	{
+		distribution = LevelDistribution::GRID;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "SceneObject.h"
+#include "SceneDatabase.h"
+#include <string>
+#include <vector>
+
+// How generated objects are spread over the level
+enum class LevelDistribution
+{
+	UNIFORM,	// evenly at random over the whole level
+	CLUSTERED,	// normally distributed around a number of random centres, like villages or forests
+	GRID,		// regular rows, every object a fixed distance from its neighbours
+};
+
+struct LevelSettings
+{
+	int objectCount;
+	int chunksPerSide;			// level is chunksPerSide x chunksPerSide chunks, laid out as ChunkManager expects
+	LevelDistribution distribution;
+	int clusterCount;
+	float clusterRadius;		// standard deviation of a cluster in metres
+	unsigned int seed;			// same seed, same level
+
+	LevelSettings();
+};
+
+// Makes large test levels with the real Objects and Chunks schema, copied from an existing level, so load, save
+// and editor performance can be measured on sizes far beyond database/test.db. Objects use the models and
+// textures in database/data. Doesn't need a window or a device.
+class LevelGenerator
+{
+public:
+	// Objects only, IDs from 0
+	static void GenerateObjects(const LevelSettings& settings, std::vector<SceneObject>& objects);
+
+	// Write a new database at path. The template provides the schema and the chunk settings.
+	// The spatial index is created if the template has one.
+	static bool Generate(const char* path, SceneDatabase* templateDatabase, const LevelSettings& settings, std::string& error);
+
+	static const char* GetDistributionName(LevelDistribution distribution);
+	static bool ParseDistribution(const std::string& name, LevelDistribution& distribution);
+};
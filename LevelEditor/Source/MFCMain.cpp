@@ -33,6 +33,27 @@ END_MESSAGE_MAP()
 
 BOOL MFCMain::InitInstance()
 {
+	// Command line tools like -generate and -benchmark run without opening the editor
+	std::vector<std::string> args;
+	for (int i = 0; i < __argc; i++)
+	{
+		args.push_back(std::string(CW2A(__wargv[i])));
+	}
+
+	// The editor has no console of its own, so report to the one it was started from
+	if (args.size() > 1 && AttachConsole(ATTACH_PARENT_PROCESS))
+	{
+		FILE* pConsole;
+		freopen_s(&pConsole, "CONOUT$", "w", stdout);
+	}
+
+	int exitCode = 0;
+	if (HeadlessRunner::Run(args, DATABASE_PATH, exitCode))
+	{
+		m_headlessExitCode = exitCode;
+		return FALSE;
+	}
+
 	//instanciate the mfc frame
 	m_frame = new CMyFrame();
 	m_pMainWnd = m_frame;
@@ -79,6 +100,19 @@ BOOL MFCMain::InitInstance()
 	return TRUE;
 }
 
+int MFCMain::ExitInstance()
+{
+	int exitCode = CWinApp::ExitInstance();
+
+	// Headless runs report their own result
+	if (m_headlessExitCode != -1)
+	{
+		return m_headlessExitCode;
+	}
+
+	return exitCode;
+}
+
 int MFCMain::Run()
 {
 	MSG msg;
@@ -179,6 +213,13 @@ int MFCMain::Run()
 			m_ToolSystem.Tick(&msg);
 			m_ToolObjectDialog.Update();
 
+			// Show loading and saving messages alongside the mode
+			std::wstring statusMessage = m_ToolSystem.GetStatusMessage();
+			if (!statusMessage.empty())
+			{
+				statusString += L"    |    " + statusMessage;
+			}
+
 			// Update status bar string
 			m_frame->m_wndStatusBar.SetPaneText(1, statusString.c_str(), 1);	
 			
@@ -351,7 +392,7 @@ void MFCMain::ToolBarRedo()
 
 MFCMain::MFCMain()
 {
-	
+	m_headlessExitCode = -1;
 }
 
 
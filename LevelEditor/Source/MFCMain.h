@@ -11,6 +11,7 @@
 #include "SelectDialogue.h"
 #include "ObjectDialog.h"
 #include "SettingsDialog.h"
+#include "HeadlessRunner.h"
 
 
 class MFCMain : public CWinApp 
@@ -19,6 +20,7 @@ public:
 	MFCMain();
 	~MFCMain();
 	BOOL InitInstance();
+	int  ExitInstance();
 	int  Run();
 
 private:
@@ -34,6 +36,8 @@ private:
 	int m_width;		
 	int m_height;
 
+	int m_headlessExitCode;	//set when run from the command line without a window, -1 otherwise
+
 	//Interface funtions for menu and toolbar
 	afx_msg void MenuFileQuit();
 	afx_msg void MenuFileSaveTerrain();
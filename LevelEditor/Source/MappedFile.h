@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+
+// Read only memory mapping of a whole file. The contents are paged in by the OS as they are touched,
+// so nothing is copied until it is used.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const { return m_data != NULL; };
+
+	// Getters
+	const unsigned char* GetData() const { return m_data; };
+	size_t GetSize() const { return m_size; };
+
+private:
+	// Not copyable, the mapping belongs to one object
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	// OS handles, void* so the header doesn't need windows.h
+	void* m_file;
+	void* m_mapping;
+
+	const unsigned char* m_data;
+	size_t m_size;
+};
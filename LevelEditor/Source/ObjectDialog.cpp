@@ -198,11 +198,12 @@ void ObjectDialog::CheckboxVisibility()
 		{
 			m_sceneGraph->at(*m_currentSelection).editor_render = false;
 		}
+		m_gameRef->GetChangeTracker()->MarkModified(m_sceneGraph->at(*m_currentSelection).ID);
 
-		// Rebuild display list to reflect change in visibility
+		// Update the object's display object to reflect change in visibility
 		if (m_gameRef)
 		{
-			m_gameRef->BuildDisplayList(m_sceneGraph);
+			m_gameRef->UpdateObject(m_sceneGraph->at(*m_currentSelection).ID);
 		}
 	}
 }
@@ -227,12 +228,12 @@ void ObjectDialog::CheckboxSnapToGround()
 		{
 			m_sceneGraph->at(*m_currentSelection).snapToGround = false;
 		}
+		m_gameRef->GetChangeTracker()->MarkModified(m_sceneGraph->at(*m_currentSelection).ID);
 
-		// Rebuild display list to reflect change
+		// Update the object's display object to reflect change
 		if (m_gameRef)
 		{
-			m_gameRef->BuildDisplayList(m_sceneGraph);
-			
+			m_gameRef->UpdateObject(m_sceneGraph->at(*m_currentSelection).ID);
 		}
 	}
 }
@@ -320,8 +321,9 @@ void ObjectDialog::UpdateFromEditBoxes()
 		m_gameRef->AddAction(Action::MODIFY);
 		m_gameRef->AddToObjectStack(m_sceneGraph->at(*m_currentSelection));
 
-		// Get object to edit.
+		// Get object to edit, and flag it for saving.
 		SceneObject* Object = &m_sceneGraph->at(*m_currentSelection);
+		m_gameRef->GetChangeTracker()->MarkModified(Object->ID);
 
 		// Temp string for holding values.
 		CString temp; 
@@ -378,7 +380,7 @@ void ObjectDialog::UpdateFromEditBoxes()
 
 		if (rebuildDisplayList)
 		{
-			m_gameRef->BuildDisplayList(m_sceneGraph);
+			m_gameRef->UpdateObject(Object->ID);
 		}
 
 		// Update window from object to re-format floats in edit box
@@ -7,6 +7,7 @@ ObjectManipulator::ObjectManipulator()
 {
 	// Initial values
 	m_object = NULL;
+	m_changeTracker = NULL;
 	m_manipulationMode = ManipulationMode::TRANSLATE;
 	m_movementRate = 1.0f;
 	m_rotationRate = 5.0f;
@@ -117,6 +118,13 @@ void ObjectManipulator::Update(DX::StepTimer const& timer, InputCommands* input,
 			m_sceneGraph->at(*m_currentSelection).scaZ = m_object->m_scale.z;
 			break;
 		}
+		m_object->MarkTransformDirty();
+
+		// Object needs saving
+		if (m_changeTracker)
+		{
+			m_changeTracker->MarkModified(m_sceneGraph->at(*m_currentSelection).ID);
+		}
 
 		// Reset cursor position
 		SetCursorPos(m_clickX, m_clickY);
@@ -131,6 +139,7 @@ void ObjectManipulator::SetObjectPosition(float x, float y, float z)
 	if (m_object)
 	{
 		m_object->m_position = pos;
+		m_object->MarkTransformDirty();
 	}
 }
 
@@ -142,6 +151,7 @@ void ObjectManipulator::SetObjectRotation(float x, float y, float z)
 	if (m_object)
 	{
 		m_object->m_orientation = rot;
+		m_object->MarkTransformDirty();
 	}
 }
 
@@ -153,6 +163,7 @@ void ObjectManipulator::SetObjectScale(float x, float y, float z)
 	if (m_object)
 	{
 		m_object->m_scale = scale;
+		m_object->MarkTransformDirty();
 	}
 }
 
@@ -206,8 +217,21 @@ void ObjectManipulator::SnapToGround(DisplayChunk* terrain)
 
 				if (RayIntersectsTriangle(rayOrigin, rayVector, &triangle, intersectionPoint))
 				{
-					m_object->m_position.y = intersectionPoint.y;
-					m_sceneGraph->at(*m_currentSelection).posY = m_object->m_position.y;
+					if (m_object->m_position.y != intersectionPoint.y)
+					{
+						m_object->m_position.y = intersectionPoint.y;
+						m_object->MarkTransformDirty();
+					}
+
+					// Only counts as a change if the height actually moved
+					if (m_sceneGraph->at(*m_currentSelection).posY != m_object->m_position.y)
+					{
+						m_sceneGraph->at(*m_currentSelection).posY = m_object->m_position.y;
+						if (m_changeTracker)
+						{
+							m_changeTracker->MarkModified(m_sceneGraph->at(*m_currentSelection).ID);
+						}
+					}
 					break;
 				}
 			}
@@ -7,6 +7,7 @@
 #include "InputCommands.h"
 #include "StepTimer.h"
 #include "Camera.h"
+#include "SceneChangeTracker.h"
 
 // Manipulation mode enum
 enum class ManipulationMode {
@@ -34,6 +35,7 @@ public:
 
 	// Set pointers to scene graph and current selection
 	void SetSceneGraph(std::vector<SceneObject>* sceneGraph, int* sel) { m_sceneGraph = sceneGraph; m_currentSelection = sel; };
+	void SetChangeTracker(SceneChangeTracker* tracker) { m_changeTracker = tracker; };
 	
 	// Functions relating to ground snapping
 	void SnapToGround(DisplayChunk* terrain);
@@ -81,6 +83,9 @@ private:
 	std::vector<SceneObject>* m_sceneGraph;
 	int* m_currentSelection;
 
+	// Records which objects have been edited
+	SceneChangeTracker* m_changeTracker;
+
 	// Click properties
 	int m_clickX;
 	int m_clickY;
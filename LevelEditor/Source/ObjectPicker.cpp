@@ -0,0 +1,207 @@
+#include "ObjectPicker.h"
+#include "ObjectManipulator.h"
+#include <cfloat>
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+// Deep enough for any BVH CollisionMesh builds, its median splits keep depth near log2 of the triangle count
+#define PICK_STACK_SIZE 64
+
+ObjectPicker::ObjectPicker()
+{
+}
+
+ObjectPicker::~ObjectPicker()
+{
+}
+
+void ObjectPicker::Clear()
+{
+	m_objects.clear();
+	m_tree.Clear();
+	m_leaves.clear();
+}
+
+int ObjectPicker::Append(const DisplayObject& object, std::shared_ptr<const CollisionMesh> mesh)
+{
+	int index = Size();
+	m_objects.push_back(PickObject());
+	m_leaves.push_back(-1);
+
+	Set(index, object, mesh);
+	return index;
+}
+
+void ObjectPicker::Set(int index, const DisplayObject& object, std::shared_ptr<const CollisionMesh> mesh)
+{
+	PickObject& pickObject = m_objects[index];
+	pickObject.mesh = mesh;
+
+	Update(index, object);
+}
+
+void ObjectPicker::SetTransform(int index, const DisplayObject& object)
+{
+	Update(index, object);
+}
+
+void ObjectPicker::Remove(int index)
+{
+	int last = Size() - 1;
+	if (index != last)
+	{
+		Move(last, index);
+	}
+	Resize(last);
+}
+
+void ObjectPicker::Move(int from, int to)
+{
+	if (from == to)
+	{
+		return;
+	}
+
+	// The object being overwritten leaves the tree, the moved one keeps its leaf under its new index
+	if (m_leaves[to] != -1)
+	{
+		m_tree.Remove(m_leaves[to]);
+	}
+	m_objects[to] = std::move(m_objects[from]);
+	m_leaves[to] = m_leaves[from];
+	m_leaves[from] = -1;
+	if (m_leaves[to] != -1)
+	{
+		m_tree.SetItem(m_leaves[to], to);
+	}
+}
+
+void ObjectPicker::Resize(int size)
+{
+	for (int i = size; i < Size(); i++)
+	{
+		if (m_leaves[i] != -1)
+		{
+			m_tree.Remove(m_leaves[i]);
+		}
+	}
+	m_objects.resize(size);
+	m_leaves.resize(size);
+}
+
+void ObjectPicker::Rebuild()
+{
+	const std::vector<AabbTreeNode>& nodes = m_tree.GetNodes();
+	std::vector<float> boxes;
+	boxes.reserve(m_leaves.size() * 6);
+	for (int leaf : m_leaves)
+	{
+		boxes.insert(boxes.end(), nodes[leaf].min, nodes[leaf].min + 3);
+		boxes.insert(boxes.end(), nodes[leaf].max, nodes[leaf].max + 3);
+	}
+	m_tree.Build(boxes, m_leaves);
+}
+
+int ObjectPicker::Pick(const Vector3& origin, const Vector3& direction, float& distance) const
+{
+	float rayOrigin[3] = { origin.x, origin.y, origin.z };
+	float rayDirection[3] = { direction.x, direction.y, direction.z };
+
+	// Boxes come nearest first, once a hit is closer than the next box is entered nothing further on can beat it
+	int picked = -1;
+	distance = FLT_MAX;
+	m_tree.Raycast(rayOrigin, rayDirection, FLT_MAX, [&](int index, float entry, float& maxDistance)
+	{
+		const PickObject& object = m_objects[index];
+		if (!object.mesh || object.mesh->GetTriangleCount() == 0)
+		{
+			maxDistance = entry;
+			distance = entry;
+			picked = index;
+			return;
+		}
+
+		// Traced in model space so the mesh never has to be transformed. The direction keeps the world scale,
+		// so distances along it are still world distances.
+		Vector3 modelOrigin = Vector3::Transform(origin, object.worldToModel);
+		Vector3 modelDirection = Vector3::TransformNormal(direction, object.worldToModel);
+		if (RaycastMesh(*object.mesh, modelOrigin, modelDirection, maxDistance))
+		{
+			distance = maxDistance;
+			picked = index;
+		}
+	});
+
+	return picked;
+}
+
+void ObjectPicker::Update(int index, const DisplayObject& object)
+{
+	// The object caches both, they're only rebuilt if it has moved
+	m_objects[index].worldToModel = object.GetWorldInverse();
+	Vector3 min = object.GetWorldMin();
+	Vector3 max = object.GetWorldMax();
+
+	// A moved object's leaf is refitted in place, its ancestors grow or shrink to match
+	if (m_leaves[index] == -1)
+	{
+		m_leaves[index] = m_tree.Insert(index, &min.x, &max.x);
+	}
+	else
+	{
+		m_tree.Update(m_leaves[index], &min.x, &max.x);
+	}
+}
+
+bool ObjectPicker::RaycastMesh(const CollisionMesh& mesh, const Vector3& origin, const Vector3& direction, float& distance) const
+{
+	const std::vector<CollisionNode>& nodes = mesh.GetNodes();
+	float rayOrigin[3] = { origin.x, origin.y, origin.z };
+	float inverseDirection[3] = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+	float lengthSquared = direction.LengthSquared();
+
+	uint32_t stack[PICK_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	bool hit = false;
+	while (stackSize > 0)
+	{
+		const CollisionNode& node = nodes[stack[--stackSize]];
+		float entry;
+		if (!AabbTree::RayIntersectsBox(rayOrigin, inverseDirection, node.min, node.max, distance, entry))
+		{
+			continue;
+		}
+
+		if (!node.IsLeaf())
+		{
+			if (stackSize + 2 <= PICK_STACK_SIZE)
+			{
+				stack[stackSize++] = node.first;
+				stack[stackSize++] = (uint32_t)(&node - nodes.data()) + 1;
+			}
+			continue;
+		}
+
+		for (uint32_t i = node.first; i < node.first + node.count; i++)
+		{
+			Triangle triangle;
+			mesh.GetTriangle(i, &triangle.vertex0.x, &triangle.vertex1.x, &triangle.vertex2.x);
+
+			Vector3 intersectionPoint;
+			if (ObjectManipulator::RayIntersectsTriangle(origin, direction, &triangle, intersectionPoint))
+			{
+				float along = (intersectionPoint - origin).Dot(direction) / lengthSquared;
+				if (along < distance)
+				{
+					distance = along;
+					hit = true;
+				}
+			}
+		}
+	}
+
+	return hit;
+}
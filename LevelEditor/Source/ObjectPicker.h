@@ -0,0 +1,60 @@
+#pragma once
+#include "../pch.h"
+#include "DisplayObject.h"
+#include "CollisionMesh.h"
+#include "AabbTree.h"
+#include <memory>
+#include <vector>
+
+// Finds the object under a ray. Every object's world space box is kept in an AabbTree, refitted as objects move, so a
+// click only opens the branches the ray passes through. The objects whose boxes are hit, nearest first, have the ray
+// traced through their cooked collision mesh in model space. Only a triangle hit counts, so overlapping boxes don't
+// steal the click from the object actually under the mouse. Objects without a collision mesh fall back to their box.
+// Boxes are the objects' cached world boxes, so their local bounds should be the collision mesh's where there is one.
+// Entries are index-parallel to the display list and follow it through appends, edits and swap-removes.
+class ObjectPicker
+{
+public:
+	ObjectPicker();
+	~ObjectPicker();
+
+	void Clear();
+	int Append(const DisplayObject& object, std::shared_ptr<const CollisionMesh> mesh);
+	void Set(int index, const DisplayObject& object, std::shared_ptr<const CollisionMesh> mesh);
+	void SetTransform(int index, const DisplayObject& object);	//keeps the mesh, for objects that moved
+	void Remove(int index);		//the last object takes its index
+
+	// Rebuild the tree from scratch, balanced, after a bulk append. Appends one at a time are slower to search.
+	void Rebuild();
+
+	// For compacting alongside the display list. Resize only shrinks, appended entries need Append.
+	void Move(int from, int to);
+	void Resize(int size);
+
+	int Size() const { return (int)m_objects.size(); };
+
+	// World space box of every object, item i is display list index i. Also what rendering culls against.
+	const AabbTree& GetTree() const { return m_tree; };
+
+	// Closest object the ray hits, -1 if none. Direction must be normalised, distance is set to how far along it the hit is.
+	int Pick(const DirectX::SimpleMath::Vector3& origin, const DirectX::SimpleMath::Vector3& direction, float& distance) const;
+
+private:
+	struct PickObject
+	{
+		std::shared_ptr<const CollisionMesh> mesh;
+		DirectX::SimpleMath::Matrix worldToModel;
+	};
+
+	// Box and inverse transform from the object's cached ones
+	void Update(int index, const DisplayObject& object);
+
+	// Nearest triangle hit in model space, false if none is closer than distance
+	bool RaycastMesh(const CollisionMesh& mesh, const DirectX::SimpleMath::Vector3& origin, const DirectX::SimpleMath::Vector3& direction, float& distance) const;
+
+	std::vector<PickObject> m_objects;
+
+	// World space boxes, each object's leaf is m_leaves[index] and its item is the index
+	AabbTree m_tree;
+	std::vector<int> m_leaves;
+};
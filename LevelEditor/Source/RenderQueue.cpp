@@ -0,0 +1,101 @@
+#include "RenderQueue.h"
+#include <algorithm>
+
+// Key layout, high bits first: wireframe, selected, 31 bits of model, 31 bits of texture
+#define RENDER_KEY_RESOURCE_BITS 31
+#define RENDER_KEY_RESOURCE_MASK ((1u << RENDER_KEY_RESOURCE_BITS) - 1)
+
+RenderQueue::RenderQueue()
+{
+	m_stats.objects = 0;
+	m_stats.batches = 0;
+	m_stats.modelChanges = 0;
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_batches.clear();
+}
+
+uint32_t RenderQueue::GetResourceKey(const void* resource)
+{
+	if (resource == nullptr)
+	{
+		return 0;
+	}
+
+	auto found = m_resourceKeys.find(resource);
+	if (found != m_resourceKeys.end())
+	{
+		return found->second;
+	}
+
+	uint32_t key = (uint32_t)m_resourceKeys.size() + 1;
+	m_resourceKeys[resource] = key;
+	return key;
+}
+
+void RenderQueue::ForgetResources()
+{
+	m_resourceKeys.clear();
+}
+
+void RenderQueue::Add(int index, uint32_t model, uint32_t texture, bool wireframe, bool selected)
+{
+	RenderItem item;
+	item.key = MakeKey(model, texture, wireframe, selected);
+	item.index = index;
+	m_items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+	// Within a batch objects keep display list order, so a frame draws the same way every time
+	std::sort(m_items.begin(), m_items.end(), [](const RenderItem& a, const RenderItem& b)
+	{
+		return a.key < b.key || (a.key == b.key && a.index < b.index);
+	});
+
+	m_batches.clear();
+	m_stats.modelChanges = 0;
+	int count = (int)m_items.size();
+	for (int i = 0; i < count; i++)
+	{
+		uint64_t key = m_items[i].key;
+		if (!m_batches.empty() && m_items[m_batches.back().first].key == key)
+		{
+			m_batches.back().count++;
+			continue;
+		}
+
+		RenderBatch batch;
+		batch.first = i;
+		batch.count = 1;
+		batch.wireframe = (key >> 63) != 0;
+		batch.selected = ((key >> 62) & 1) != 0;
+		batch.model = (uint32_t)(key >> RENDER_KEY_RESOURCE_BITS) & RENDER_KEY_RESOURCE_MASK;
+		batch.texture = (uint32_t)key & RENDER_KEY_RESOURCE_MASK;
+
+		if (!m_batches.empty() && m_batches.back().model != batch.model)
+		{
+			m_stats.modelChanges++;
+		}
+		m_batches.push_back(batch);
+	}
+
+	m_stats.objects = count;
+	m_stats.batches = (int)m_batches.size();
+}
+
+uint64_t RenderQueue::MakeKey(uint32_t model, uint32_t texture, bool wireframe, bool selected)
+{
+	return ((uint64_t)(wireframe ? 1 : 0) << 63)
+		| ((uint64_t)(selected ? 1 : 0) << 62)
+		| ((uint64_t)(model & RENDER_KEY_RESOURCE_MASK) << RENDER_KEY_RESOURCE_BITS)
+		| (uint64_t)(texture & RENDER_KEY_RESOURCE_MASK);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One object waiting to be drawn, with the state it needs packed into a sort key
+struct RenderItem
+{
+	uint64_t key;
+	int index;		// display list index
+};
+
+// Run of queued objects that share every piece of state, so it's set up once and the objects drawn back to back
+struct RenderBatch
+{
+	int first;		// into the sorted items
+	int count;
+	uint32_t model;
+	uint32_t texture;
+	bool wireframe;
+	bool selected;
+};
+
+// Counts from the last Sort
+struct RenderQueueStats
+{
+	int objects;		// queued, each is still drawn on its own, once per mesh part
+	int batches;		// blend, depth and rasterizer state is set up once per mesh for each of these rather than per object
+	int modelChanges;	// times the model changes between batches
+};
+
+// Orders a frame's visible objects so everything sharing a model, texture, fill mode and highlight is drawn together,
+// each group after a single state setup. Models and textures are given to it as opaque pointers turned into small
+// keys, so building and sorting the queue needs no D3D and can run headless on the scene graph's paths.
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// Empty the queue for a new frame, resource keys are kept
+	void Clear();
+
+	// Small key for a model, texture or anything else batches are split by. The same pointer always gets the same key
+	// until ForgetResources, null is 0.
+	uint32_t GetResourceKey(const void* resource);
+	void ForgetResources();
+
+	void Add(int index, uint32_t model, uint32_t texture, bool wireframe, bool selected);
+
+	// Sort by state and split into batches
+	void Sort();
+
+	const std::vector<RenderItem>& GetItems() const { return m_items; };
+	const std::vector<RenderBatch>& GetBatches() const { return m_batches; };
+	const RenderQueueStats& GetStats() const { return m_stats; };
+
+	// Fill mode changes the rasterizer state so it's on top, then the highlight, which changes effect state, then the model and texture
+	static uint64_t MakeKey(uint32_t model, uint32_t texture, bool wireframe, bool selected);
+
+private:
+	std::vector<RenderItem> m_items;
+	std::vector<RenderBatch> m_batches;
+	std::unordered_map<const void*, uint32_t> m_resourceKeys;
+	RenderQueueStats m_stats;
+};
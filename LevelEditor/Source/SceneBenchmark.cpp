@@ -0,0 +1,632 @@
+#include "SceneBenchmark.h"
+#include "SceneCache.h"
+#include "SceneStore.h"
+#include "AabbTree.h"
+#include "FrustumCuller.h"
+#include "TransformKernel.h"
+#include "RenderQueue.h"
+#include <cstdio>
+#include <cfloat>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+#include <thread>
+#include <random>
+
+// Radius of the region load, the same as the editor streams around the camera
+#define BENCHMARK_REGION_RADIUS 200.0f
+
+// Rays cast and objects moved by the picking benchmark
+#define BENCHMARK_PICK_RAYS 1000
+#define BENCHMARK_PICK_MOVES 1000
+
+// Frames culled by the culling benchmark, and the camera's far plane
+#define BENCHMARK_CULL_FRAMES 100
+#define BENCHMARK_CULL_NEAR 0.01f
+#define BENCHMARK_CULL_FAR 1000.0f
+
+// Points per frame the culling check tests the planes with, and how close to a plane is too close to call. Side planes
+// are relative to w. The far plane comes from the difference of two nearly equal matrix columns, so it is only good to
+// a fraction of the far distance.
+#define BENCHMARK_CULL_POINTS 1000
+#define BENCHMARK_CULL_MARGIN 1e-4f
+#define BENCHMARK_CULL_DEPTH_MARGIN 1e-2f
+
+// Frames queued by the render queue benchmark
+#define BENCHMARK_QUEUE_FRAMES 10
+
+// Largest relative difference allowed between TransformKernel's SIMD and scalar results
+#define BENCHMARK_TRANSFORM_TOLERANCE 1e-4f
+
+// Box as big as the object's scale around each object, roughly what the editor's models take up
+static void MakeObjectBoxes(const std::vector<SceneObject>& objects, std::vector<float>& boxes)
+{
+	boxes.reserve(objects.size() * 6);
+	for (const SceneObject& object : objects)
+	{
+		float position[3] = { object.posX, object.posY, object.posZ };
+		float extents[3] = { fabsf(object.scaX), fabsf(object.scaY), fabsf(object.scaZ) };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boxes.push_back(position[axis] - extents[axis]);
+		}
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boxes.push_back(position[axis] + extents[axis]);
+		}
+	}
+}
+
+// Row major view * projection for a camera at eye looking at target, built the way the editor's right handed
+// Matrix::CreateLookAt and CreatePerspectiveFieldOfView do
+static void MakeViewProjection(const float eye[3], const float target[3], float fieldOfView, float aspect, float nearPlane, float farPlane, float viewProjection[16])
+{
+	float zAxis[3] = { eye[0] - target[0], eye[1] - target[1], eye[2] - target[2] };
+	float length = sqrtf(zAxis[0] * zAxis[0] + zAxis[1] * zAxis[1] + zAxis[2] * zAxis[2]);
+	for (float& value : zAxis)
+	{
+		value /= length;
+	}
+
+	// x is up cross z, with up along y
+	float xAxis[3] = { zAxis[2], 0.0f, -zAxis[0] };
+	length = sqrtf(xAxis[0] * xAxis[0] + xAxis[2] * xAxis[2]);
+	for (float& value : xAxis)
+	{
+		value /= length;
+	}
+	float yAxis[3] = { zAxis[1] * xAxis[2] - zAxis[2] * xAxis[1], zAxis[2] * xAxis[0] - zAxis[0] * xAxis[2], zAxis[0] * xAxis[1] - zAxis[1] * xAxis[0] };
+
+	float view[16] = {
+		xAxis[0], yAxis[0], zAxis[0], 0.0f,
+		xAxis[1], yAxis[1], zAxis[1], 0.0f,
+		xAxis[2], yAxis[2], zAxis[2], 0.0f,
+		-(xAxis[0] * eye[0] + xAxis[1] * eye[1] + xAxis[2] * eye[2]),
+		-(yAxis[0] * eye[0] + yAxis[1] * eye[1] + yAxis[2] * eye[2]),
+		-(zAxis[0] * eye[0] + zAxis[1] * eye[1] + zAxis[2] * eye[2]), 1.0f };
+
+	float height = 1.0f / tanf(fieldOfView * 0.5f);
+	float depth = farPlane / (nearPlane - farPlane);
+	float projection[16] = {
+		height / aspect, 0.0f, 0.0f, 0.0f,
+		0.0f, height, 0.0f, 0.0f,
+		0.0f, 0.0f, depth, -1.0f,
+		0.0f, 0.0f, nearPlane * depth, 0.0f };
+
+	for (int row = 0; row < 4; row++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < 4; i++)
+			{
+				sum += view[row * 4 + i] * projection[i * 4 + column];
+			}
+			viewProjection[row * 4 + column] = sum;
+		}
+	}
+}
+
+bool SceneBenchmark::RunDatabase(SceneDatabase* schemaSource, const char* scratchPath, const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error)
+{
+	// Scratch database with the same tables as the level, so the real level is never touched
+	SceneDatabase scratch;
+	remove(scratchPath);
+	if (!scratch.Open(scratchPath, true) || !scratch.CopySchema(schemaSource))
+	{
+		error = "Could not create benchmark database: " + scratch.GetLastError();
+		return false;
+	}
+
+	int size = (int)objects.size();
+
+	// One sync per row makes the old path very slow, so only run it on the smaller sizes
+	if (size <= 1000)
+	{
+		SaveStats legacy = scratch.SaveObjectsLegacy(objects);
+		benchmark.Add("save", "legacy", legacy.rows, legacy.seconds);
+	}
+
+	SaveStats bulk = scratch.SaveObjects(objects);
+	benchmark.Add("save", "bulk", bulk.rows, bulk.seconds);
+
+	// Editing a handful of objects should cost the same whatever the size of the level
+	if (size >= 10)
+	{
+		std::vector<SceneObject> edited = objects;
+		SceneChangeTracker changes;
+		for (int i = 0; i < 10; i++)
+		{
+			edited[i * (size / 10)].posX += 1.0f;
+			changes.MarkModified(edited[i * (size / 10)].ID);
+		}
+		SaveStats incremental = scratch.SaveChanges(edited, &changes);
+		benchmark.Add("save", "incremental_10_edits_of_" + std::to_string(size), incremental.rows, incremental.seconds);
+	}
+
+	// Reading the whole level against reading the area around the camera through the spatial index
+	BenchmarkTimer loadTimer;
+	std::vector<SceneObject> loaded;
+	scratch.LoadObjects(loaded);
+	benchmark.Add("load", "all", (int)loaded.size(), loadTimer.GetElapsedSeconds());
+
+	// Only the columns the editor needs up front, on one thread and then split across every core
+	std::vector<SceneObject> hot;
+	loadTimer.Start();
+	scratch.LoadHotObjects(hot, 1);
+	benchmark.Add("load", "hot_columns", (int)hot.size(), loadTimer.GetElapsedSeconds());
+
+	hot.clear();
+	int threads = std::max(1, (int)std::thread::hardware_concurrency());
+	loadTimer.Start();
+	scratch.LoadHotObjects(hot, threads);
+	benchmark.Add("load", "hot_columns_" + std::to_string(threads) + "_threads", (int)hot.size(), loadTimer.GetElapsedSeconds());
+	hot.clear();
+	hot.shrink_to_fit();
+
+	// Same objects from the binary cache, what startup does when the database hasn't changed
+	SceneCache cache;
+	if (cache.Write(scratchPath, loaded))
+	{
+		loaded.clear();
+		loadTimer.Start();
+		cache.Load(scratchPath, loaded);
+		benchmark.Add("load", "cache", (int)loaded.size(), loadTimer.GetElapsedSeconds());
+	}
+	remove(SceneCache::GetCachePath(scratchPath).c_str());
+
+	if (scratch.HasSpatialIndex())
+	{
+		loaded.clear();
+		loadTimer.Start();
+		int count = scratch.LoadObjectsInRegion(SpatialRegion::Around(0, 0, 0, BENCHMARK_REGION_RADIUS), -1, std::unordered_set<int>(), loaded);
+		benchmark.Add("load", "region", count, loadTimer.GetElapsedSeconds());
+	}
+
+	// Everything in one chunk, what the chunk manager's workers do
+	loaded.clear();
+	loadTimer.Start();
+	scratch.LoadObjectsInChunk(objects.front().chunk_ID, loaded);
+	benchmark.Add("load", "chunk", (int)loaded.size(), loadTimer.GetElapsedSeconds());
+
+	scratch.Close();
+	remove(scratchPath);
+	return true;
+}
+
+void SceneBenchmark::RunLayouts(const std::vector<SceneObject>& objects, Benchmark& benchmark)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+
+	// Results go to volatiles before the timer is read so the loops can't be moved or removed
+	volatile int result = 0;
+	volatile float bounds = 0.0f;
+	int size = (int)objects.size();
+
+	// Whole scene graph copy, as taken for undo and background saves. Strings are interned so this is a plain copy.
+	BenchmarkTimer timer;
+	std::vector<SceneObject> copied = objects;
+	benchmark.Add("memory", "copy_scene_graph", size, timer.GetElapsedSeconds());
+	copied.clear();
+	copied.shrink_to_fit();
+
+	SceneStore store;
+	timer.Start();
+	store.Build(objects);
+	benchmark.Add("layout", "soa_build", size, timer.GetElapsedSeconds());
+
+	// Linear ID search for the last object, what GetObjectByID did for every lookup
+	int target = objects.back().ID;
+	timer.Start();
+	int found = -1;
+	for (int i = 0; i < size && found == -1; i++)
+	{
+		if (objects[i].ID == target)
+		{
+			found = i;
+		}
+	}
+	result = found;
+	benchmark.Add("layout", "aos_find_id", size, timer.GetElapsedSeconds());
+
+	const int* IDs = store.GetIDs();
+	timer.Start();
+	found = -1;
+	for (int i = 0; i < size && found == -1; i++)
+	{
+		if (IDs[i] == target)
+		{
+			found = i;
+		}
+	}
+	result = found;
+	benchmark.Add("layout", "soa_find_id", size, timer.GetElapsedSeconds());
+
+	timer.Start();
+	result = store.FindIndex(target);
+	benchmark.Add("layout", "soa_find_id_hashed", size, timer.GetElapsedSeconds());
+
+	// Highest ID, done on every display list rebuild
+	timer.Start();
+	int highestID = -1;
+	for (const SceneObject& object : objects)
+	{
+		highestID = std::max(highestID, object.ID);
+	}
+	result = highestID;
+	benchmark.Add("layout", "aos_highest_id", size, timer.GetElapsedSeconds());
+
+	timer.Start();
+	result = store.FindHighestID();
+	benchmark.Add("layout", "soa_highest_id", size, timer.GetElapsedSeconds());
+
+	// Position clash check for a free position, so every object is visited
+	timer.Start();
+	int clash = -1;
+	for (int i = 0; i < size && clash == -1; i++)
+	{
+		if (objects[i].posX == -1.0f && objects[i].posY == -1.0f && objects[i].posZ == -1.0f)
+		{
+			clash = i;
+		}
+	}
+	result = clash;
+	benchmark.Add("layout", "aos_position_check", size, timer.GetElapsedSeconds());
+
+	timer.Start();
+	result = store.FindAtPosition(-1.0f, -1.0f, -1.0f);
+	benchmark.Add("layout", "soa_position_check", size, timer.GetElapsedSeconds());
+
+	// Extent of every position, a stand in for per frame transform work
+	timer.Start();
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	for (const SceneObject& object : objects)
+	{
+		minX = std::min(minX, object.posX);
+		maxX = std::max(maxX, object.posX);
+	}
+	bounds = maxX - minX;
+	benchmark.Add("layout", "aos_position_bounds", size, timer.GetElapsedSeconds());
+
+	const float* posX = store.GetPositionX();
+	timer.Start();
+	minX = FLT_MAX;
+	maxX = -FLT_MAX;
+	for (int i = 0; i < size; i++)
+	{
+		minX = std::min(minX, posX[i]);
+		maxX = std::max(maxX, posX[i]);
+	}
+	bounds = maxX - minX;
+	benchmark.Add("layout", "soa_position_bounds", size, timer.GetElapsedSeconds());
+}
+
+void SceneBenchmark::RunPicking(const std::vector<SceneObject>& objects, Benchmark& benchmark)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+
+	int size = (int)objects.size();
+	std::vector<float> boxes;
+	MakeObjectBoxes(objects, boxes);
+
+	BenchmarkTimer timer;
+	AabbTree tree;
+	std::vector<int> leaves;
+	tree.Build(boxes, leaves);
+	benchmark.Add("picking", "tree_build", size, timer.GetElapsedSeconds());
+
+	// Looking down at a random object from a few metres away, as a click on it would
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int> pickTarget(0, size - 1);
+	std::vector<float> rays;
+	for (int i = 0; i < BENCHMARK_PICK_RAYS; i++)
+	{
+		const SceneObject& target = objects[pickTarget(random)];
+		float origin[3] = { target.posX, target.posY + 20.0f, target.posZ - 20.0f };
+		float direction[3] = { 0.0f, -0.70710678f, 0.70710678f };
+		rays.insert(rays.end(), origin, origin + 3);
+		rays.insert(rays.end(), direction, direction + 3);
+	}
+
+	// Nearest box along each ray, every box tested as picking used to
+	volatile int result = 0;
+	timer.Start();
+	for (int ray = 0; ray < BENCHMARK_PICK_RAYS; ray++)
+	{
+		const float* origin = &rays[ray * 6];
+		float inverseDirection[3] = { 1.0f / rays[ray * 6 + 3], 1.0f / rays[ray * 6 + 4], 1.0f / rays[ray * 6 + 5] };
+		float nearest = FLT_MAX;
+		int picked = -1;
+		for (int i = 0; i < size; i++)
+		{
+			float entry;
+			if (AabbTree::RayIntersectsBox(origin, inverseDirection, &boxes[i * 6], &boxes[i * 6 + 3], nearest, entry))
+			{
+				nearest = entry;
+				picked = i;
+			}
+		}
+		result = picked;
+	}
+	benchmark.Add("picking", "linear_rays_" + std::to_string(BENCHMARK_PICK_RAYS), size, timer.GetElapsedSeconds());
+
+	timer.Start();
+	for (int ray = 0; ray < BENCHMARK_PICK_RAYS; ray++)
+	{
+		int picked = -1;
+		tree.Raycast(&rays[ray * 6], &rays[ray * 6 + 3], FLT_MAX, [&picked](int item, float entry, float& maxDistance)
+		{
+			maxDistance = entry;
+			picked = item;
+		});
+		result = picked;
+	}
+	benchmark.Add("picking", "tree_rays_" + std::to_string(BENCHMARK_PICK_RAYS), size, timer.GetElapsedSeconds());
+
+	// Objects dragged a few metres, each leaf refitted where it is
+	timer.Start();
+	for (int i = 0; i < BENCHMARK_PICK_MOVES; i++)
+	{
+		int moved = pickTarget(random);
+		float min[3] = { boxes[moved * 6] + 5.0f, boxes[moved * 6 + 1], boxes[moved * 6 + 2] };
+		float max[3] = { boxes[moved * 6 + 3] + 5.0f, boxes[moved * 6 + 4], boxes[moved * 6 + 5] };
+		tree.Update(leaves[moved], min, max);
+	}
+	benchmark.Add("picking", "tree_refit_" + std::to_string(BENCHMARK_PICK_MOVES), size, timer.GetElapsedSeconds());
+}
+
+bool SceneBenchmark::RunCulling(const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error)
+{
+	if (objects.empty())
+	{
+		return true;
+	}
+
+	int size = (int)objects.size();
+	std::vector<float> boxes;
+	MakeObjectBoxes(objects, boxes);
+
+	AabbTree tree;
+	std::vector<int> leaves;
+	tree.Build(boxes, leaves);
+
+	// Cameras a little above random objects looking across the level, so each view holds part of it
+	std::mt19937 random(1);
+	std::uniform_int_distribution<int> cameraTarget(0, size - 1);
+	std::vector<Frustum> frustums;
+	std::vector<float> viewProjections;
+	std::vector<float> views;	// eye then direction, for the culling check
+	for (int i = 0; i < BENCHMARK_CULL_FRAMES; i++)
+	{
+		const SceneObject& from = objects[cameraTarget(random)];
+		const SceneObject& to = objects[cameraTarget(random)];
+		float eye[3] = { from.posX, from.posY + 10.0f, from.posZ };
+		float target[3] = { to.posX, to.posY, to.posZ + 1.0f };
+		float viewProjection[16];
+		MakeViewProjection(eye, target, 0.7854f, 16.0f / 9.0f, BENCHMARK_CULL_NEAR, BENCHMARK_CULL_FAR, viewProjection);
+		frustums.push_back(Frustum::FromMatrix(viewProjection));
+		viewProjections.insert(viewProjections.end(), viewProjection, viewProjection + 16);
+		float direction[3] = { target[0] - eye[0], target[1] - eye[1], target[2] - eye[2] };
+		float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+		views.insert(views.end(), eye, eye + 3);
+		for (int c = 0; c < 3; c++)
+		{
+			views.push_back(length > 0.0f ? direction[c] / length : 0.0f);
+		}
+	}
+
+	volatile int result = 0;
+	BenchmarkTimer timer;
+	for (const Frustum& frustum : frustums)
+	{
+		int visible = 0;
+		for (int i = 0; i < size; i++)
+		{
+			if (frustum.ClassifyBox(&boxes[i * 6], &boxes[i * 6 + 3]) != Frustum::OUTSIDE)
+			{
+				visible++;
+			}
+		}
+		result = visible;
+	}
+	benchmark.Add("culling", "linear_frames_" + std::to_string(BENCHMARK_CULL_FRAMES), size, timer.GetElapsedSeconds());
+
+	FrustumCuller culler;
+	std::vector<int> visible;
+	timer.Start();
+	for (const Frustum& frustum : frustums)
+	{
+		culler.Cull(tree, frustum, visible);
+		result = (int)visible.size();
+	}
+	benchmark.Add("culling", "tree_frames_" + std::to_string(BENCHMARK_CULL_FRAMES), size, timer.GetElapsedSeconds());
+
+	// Boxes fully inside a node that is fully inside are taken untested, so the tree must find exactly what testing every box does
+	std::uniform_real_distribution<float> along(-0.1f, 1.1f);
+	std::uniform_real_distribution<float> across(-0.6f, 0.6f);
+	for (int frame = 0; frame < BENCHMARK_CULL_FRAMES; frame++)
+	{
+		const Frustum& frustum = frustums[frame];
+		std::vector<int> expected;
+		for (int i = 0; i < size; i++)
+		{
+			if (frustum.ClassifyBox(&boxes[i * 6], &boxes[i * 6 + 3]) != Frustum::OUTSIDE)
+			{
+				expected.push_back(i);
+			}
+		}
+
+		culler.Cull(tree, frustum, visible);
+		std::sort(visible.begin(), visible.end());
+		if (visible != expected)
+		{
+			error = "Culling through the tree found " + std::to_string(visible.size()) + " objects instead of " + std::to_string(expected.size())
+				+ " in frame " + std::to_string(frame) + " at " + std::to_string(size) + " objects";
+			return false;
+		}
+
+		// Points scattered through and around the view volume taken into clip space, inside if -w <= x, y <= w and w is
+		// between the near and far planes. w is the view depth, which z / w squeezes too close to 1 to test against.
+		const float* m = &viewProjections[frame * 16];
+		const float* eye = &views[frame * 6];
+		const float* direction = &views[frame * 6 + 3];
+		for (int i = 0; i < BENCHMARK_CULL_POINTS; i++)
+		{
+			float distance = along(random) * BENCHMARK_CULL_FAR;
+			float point[3];
+			for (int c = 0; c < 3; c++)
+			{
+				point[c] = eye[c] + direction[c] * distance + across(random) * fabsf(distance);
+			}
+			float clip[4];
+			for (int c = 0; c < 4; c++)
+			{
+				clip[c] = point[0] * m[c] + point[1] * m[4 + c] + point[2] * m[8 + c] + m[12 + c];
+			}
+
+			float w = clip[3];
+			float sides = std::min(w - fabsf(clip[0]), w - fabsf(clip[1]));
+			float depth = std::min(w - BENCHMARK_CULL_NEAR, BENCHMARK_CULL_FAR - w);
+			if (fabsf(sides) <= BENCHMARK_CULL_MARGIN * fabsf(w) || fabsf(depth) <= BENCHMARK_CULL_DEPTH_MARGIN * BENCHMARK_CULL_FAR)
+			{
+				continue;
+			}
+
+			bool inside = sides > 0.0f && depth > 0.0f;
+			if ((frustum.ClassifyBox(point, point) != Frustum::OUTSIDE) != inside)
+			{
+				error = "Frustum planes put a point " + std::string(inside ? "outside" : "inside") + " the view in frame " + std::to_string(frame);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void SceneBenchmark::RunRenderQueue(const std::vector<SceneObject>& objects, Benchmark& benchmark)
+{
+	if (objects.empty())
+	{
+		return;
+	}
+
+	// Interned paths are one pointer per distinct string, the same way the editor's asset cache shares models
+	RenderQueue queue;
+	volatile int result = 0;
+	BenchmarkTimer timer;
+	for (int frame = 0; frame < BENCHMARK_QUEUE_FRAMES; frame++)
+	{
+		queue.Clear();
+		for (int i = 0; i < (int)objects.size(); i++)
+		{
+			queue.Add(i, queue.GetResourceKey(&objects[i].model_path.str()), queue.GetResourceKey(&objects[i].tex_diffuse_path.str()), false, false);
+		}
+		queue.Sort();
+		result = queue.GetStats().batches;
+	}
+	benchmark.Add("render_queue", "build_sort_frames_" + std::to_string(BENCHMARK_QUEUE_FRAMES), (int)objects.size(), timer.GetElapsedSeconds());
+}
+
+bool SceneBenchmark::RunTransforms(const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error)
+{
+	if (objects.empty())
+	{
+		return true;
+	}
+
+	int size = (int)objects.size();
+	SceneStore store;
+	store.Build(objects);
+
+	// A two metre box around each object's origin
+	std::vector<float> localMin(size, -1.0f);
+	std::vector<float> localMax(size, 1.0f);
+	TransformInput input = {
+		store.GetPositionX(), store.GetPositionY(), store.GetPositionZ(),
+		store.GetRotationX(), store.GetRotationY(), store.GetRotationZ(),
+		store.GetScaleX(), store.GetScaleY(), store.GetScaleZ(),
+		localMin.data(), localMin.data(), localMin.data(),
+		localMax.data(), localMax.data(), localMax.data() };
+
+	float difference = TransformKernel::Compare(input, size);
+	if (!(difference <= BENCHMARK_TRANSFORM_TOLERANCE))
+	{
+		error = "SIMD transforms differ from scalar ones by " + std::to_string(difference) + " at " + std::to_string(size) + " objects";
+		return false;
+	}
+
+	std::vector<float> worlds((size_t)size * 16);
+	std::vector<float> inverses((size_t)size * 16);
+	std::vector<float> boxes((size_t)size * 6);
+	TransformOutput output = { worlds.data(), inverses.data(), boxes.data() };
+
+	BenchmarkTimer timer;
+	TransformKernel::BuildScalar(input, 0, size, output);
+	benchmark.Add("transforms", "scalar", size, timer.GetElapsedSeconds());
+
+	timer.Start();
+	TransformKernel::BuildSimd(input, 0, size, output);
+	benchmark.Add("transforms", TransformKernel::HasSimd() ? "simd" : "simd_unavailable", size, timer.GetElapsedSeconds());
+
+	int threads = std::max(1, (int)std::thread::hardware_concurrency());
+	timer.Start();
+	TransformKernel::Build(input, size, output, threads);
+	benchmark.Add("transforms", "simd_" + std::to_string(threads) + "_threads", size, timer.GetElapsedSeconds());
+	return true;
+}
+
+bool SceneBenchmark::RunGenerated(SceneDatabase* templateDatabase, const char* scratchPath, const std::vector<int>& sizes, LevelSettings settings, Benchmark& benchmark, std::string& error)
+{
+	std::string suffix = std::string("_") + LevelGenerator::GetDistributionName(settings.distribution);
+
+	for (int size : sizes)
+	{
+		settings.objectCount = size;
+
+		BenchmarkTimer timer;
+		std::vector<SceneObject> objects;
+		LevelGenerator::GenerateObjects(settings, objects);
+		benchmark.Add("generate", "objects" + suffix, size, timer.GetElapsedSeconds());
+
+		if (!RunDatabase(templateDatabase, scratchPath, objects, benchmark, error))
+		{
+			return false;
+		}
+
+		RunLayouts(objects, benchmark);
+		RunPicking(objects, benchmark);
+		RunRenderQueue(objects, benchmark);
+
+		if (!RunCulling(objects, benchmark, error) || !RunTransforms(objects, benchmark, error))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SceneBenchmark::ReplicateObjects(const std::vector<SceneObject>& source, int count, std::vector<SceneObject>& objects)
+{
+	if (source.empty())
+	{
+		return;
+	}
+
+	objects.reserve(objects.size() + count);
+	for (int i = 0; i < count; i++)
+	{
+		objects.push_back(source[i % source.size()]);
+		objects.back().ID = i;
+
+		// Spread out on a 10m grid so spatial queries have something to filter
+		objects.back().posX += (i % 100) * 10.0f;
+		objects.back().posZ += (i / 100) * 10.0f;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Benchmark.h"
+#include "SceneDatabase.h"
+#include "LevelGenerator.h"
+#include <string>
+#include <vector>
+
+// Timings for loading, saving and walking the scene graph that don't need a window or a device, so they can be
+// run from the benchmark action in the editor or headless from the command line.
+class SceneBenchmark
+{
+public:
+	// Save the objects to a scratch database with the same schema as schemaSource and load them back in
+	// the different ways the editor does. The scratch database is deleted afterwards.
+	static bool RunDatabase(SceneDatabase* schemaSource, const char* scratchPath, const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error);
+
+	// The same loops over std::vector<SceneObject> and over a SceneStore built from it
+	static void RunLayouts(const std::vector<SceneObject>& objects, Benchmark& benchmark);
+
+	// Ray casts against a box around every object, one by one and through an AabbTree, and refitting moved objects
+	static void RunPicking(const std::vector<SceneObject>& objects, Benchmark& benchmark);
+
+	// Frustum culling a camera's view of the same boxes, each one tested against testing through an AabbTree.
+	// Fails if the tree finds different objects to testing every box, or the planes disagree with clip space on points.
+	static bool RunCulling(const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error);
+
+	// World matrices, inverses and boxes for every object through TransformKernel's scalar, SIMD and threaded paths.
+	// Fails if the SIMD results stray from the scalar ones.
+	static bool RunTransforms(const std::vector<SceneObject>& objects, Benchmark& benchmark, std::string& error);
+
+	// Filling and sorting a RenderQueue with every object each frame, keyed by model and texture path
+	static void RunRenderQueue(const std::vector<SceneObject>& objects, Benchmark& benchmark);
+
+	// Generate a level of each size and run everything above on it
+	static bool RunGenerated(SceneDatabase* templateDatabase, const char* scratchPath, const std::vector<int>& sizes, LevelSettings settings, Benchmark& benchmark, std::string& error);
+
+	// Repeat the source objects with new IDs until there are count of them, spread out on a 10m grid
+	static void ReplicateObjects(const std::vector<SceneObject>& source, int count, std::vector<SceneObject>& objects);
+};
@@ -0,0 +1,433 @@
+#include "SceneCache.h"
+#include "MappedFile.h"
+#include "SceneFields.h"
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// Text is stored once in the string block, records refer to it by offset and length
+struct CachedString
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+// Each object is a fixed size record of its fields in SceneObjectFields order, packed with no padding:
+// ints and floats take 4 bytes, bools 1 and strings a CachedString.
+template<typename T> struct RecordBytes;
+template<> struct RecordBytes<int> { static const size_t value = sizeof(int32_t); };
+template<> struct RecordBytes<float> { static const size_t value = sizeof(float); };
+template<> struct RecordBytes<bool> { static const size_t value = sizeof(uint8_t); };
+template<> struct RecordBytes<InternedString> { static const size_t value = sizeof(CachedString); };
+
+typedef decltype(SceneObjectFields()) SceneObjectFieldTable;
+
+template<size_t... Index>
+constexpr size_t GetRecordSize(std::index_sequence<Index...>)
+{
+	const size_t sizes[] = { 0, RecordBytes<typename std::tuple_element<Index, SceneObjectFieldTable>::type::Type>::value... };
+	size_t total = 0;
+	for (size_t size : sizes)
+	{
+		total += size;
+	}
+	return total;
+}
+
+static const size_t s_recordSize = GetRecordSize(std::make_index_sequence<std::tuple_size<SceneObjectFieldTable>::value>());
+
+struct SceneCacheHeader
+{
+	char magic[4];			// "LSCN"
+	uint32_t version;		// SCENE_CACHE_VERSION
+	uint32_t recordSize;	// s_recordSize, catches the field table changing without the version being bumped
+	uint32_t objectCount;
+	uint64_t stringsSize;
+	DatabaseStamp stamp;	// database the cache was made from
+	uint32_t checksum;		// of the records and strings
+	uint32_t padding;
+};
+
+static const char s_cacheMagic[4] = { 'L', 'S', 'C', 'N' };
+
+// FNV-1a, only needs to catch a damaged or half written file
+static uint32_t Checksum(const unsigned char* data, size_t size, uint32_t hash = 2166136261u)
+{
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Interned strings are written once, later objects using the same one share its offset
+typedef std::unordered_map<const std::string*, CachedString> WrittenStrings;
+
+static CachedString AddString(std::string& strings, WrittenStrings& written, const InternedString& text)
+{
+	auto found = written.find(&text.str());
+	if (found != written.end())
+	{
+		return found->second;
+	}
+
+	CachedString cached;
+	cached.offset = (uint32_t)strings.size();
+	cached.length = (uint32_t)text.size();
+	strings += text.str();
+	written[&text.str()] = cached;
+	return cached;
+}
+
+// Shared offsets are looked up rather than interned again, keyed by offset and length
+typedef std::unordered_map<uint64_t, InternedString> ReadStrings;
+
+static bool ReadString(const char* strings, uint64_t stringsSize, ReadStrings& read, CachedString cached, InternedString& text)
+{
+	if ((uint64_t)cached.offset + cached.length > stringsSize)
+	{
+		return false;
+	}
+
+	uint64_t key = ((uint64_t)cached.offset << 32) | cached.length;
+	auto found = read.find(key);
+	if (found != read.end())
+	{
+		text = found->second;
+		return true;
+	}
+
+	text = std::string(strings + cached.offset, cached.length);
+	read[key] = text;
+	return true;
+}
+
+// Reads one record field by field, any string outside the string block clears valid
+struct RecordReader
+{
+	const unsigned char* in;
+	const char* strings;
+	uint64_t stringsSize;
+	ReadStrings& readStrings;
+	bool valid;
+
+	void Read(int& value) { int32_t stored; memcpy(&stored, in, sizeof(stored)); in += sizeof(stored); value = stored; }
+	void Read(float& value) { memcpy(&value, in, sizeof(value)); in += sizeof(value); }
+	void Read(bool& value) { value = *in != 0; in += sizeof(uint8_t); }
+	void Read(InternedString& value)
+	{
+		CachedString cached;
+		memcpy(&cached, in, sizeof(cached));
+		in += sizeof(cached);
+		valid = ReadString(strings, stringsSize, readStrings, cached, value) && valid;
+	}
+};
+
+// Writes one record field by field, strings are added to the string block
+struct RecordWriter
+{
+	unsigned char* out;
+	std::string& strings;
+	WrittenStrings& writtenStrings;
+
+	void Write(int value) { int32_t stored = value; memcpy(out, &stored, sizeof(stored)); out += sizeof(stored); }
+	void Write(float value) { memcpy(out, &value, sizeof(value)); out += sizeof(value); }
+	void Write(bool value) { *out = value ? 1 : 0; out += sizeof(uint8_t); }
+	void Write(const InternedString& value)
+	{
+		CachedString cached = AddString(strings, writtenStrings, value);
+		memcpy(out, &cached, sizeof(cached));
+		out += sizeof(cached);
+	}
+};
+
+// Fills the object from a record, false if one of its strings is outside the string block.
+// Only the fields with any of the include flags are in the record, or every field if include is 0.
+static bool ReadRecord(const unsigned char* record, const char* strings, uint64_t stringsSize, ReadStrings& readStrings, SceneObject& object, unsigned include = 0)
+{
+	RecordReader reader = { record, strings, stringsSize, readStrings, true };
+	ForEachField(SceneObjectFields(), [&](const auto& field)
+	{
+		if (include == 0 || field.Has(include))
+		{
+			typename std::decay<decltype(field)>::type::Type value;
+			reader.Read(value);
+			field.Set(object, value);
+		}
+	});
+	return reader.valid;
+}
+
+// Fills the record from the object, its strings are added to the string block
+static void WriteRecord(const SceneObject& object, std::string& strings, WrittenStrings& writtenStrings, unsigned char* record, unsigned include = 0)
+{
+	RecordWriter writer = { record, strings, writtenStrings };
+	ForEachField(SceneObjectFields(), [&](const auto& field)
+	{
+		if (include == 0 || field.Has(include))
+		{
+			writer.Write(field.Get(object));
+		}
+	});
+}
+
+// Bytes taken by the fields with any of the include flags
+static size_t GetRecordSize(unsigned include)
+{
+	size_t size = 0;
+	ForEachField(SceneObjectFields(), [&](const auto& field)
+	{
+		if (include == 0 || field.Has(include))
+		{
+			size += RecordBytes<typename std::decay<decltype(field)>::type::Type>::value;
+		}
+	});
+	return size;
+}
+
+bool DatabaseStamp::operator==(const DatabaseStamp& other) const
+{
+	return size == other.size && modified == other.modified && changeCounter == other.changeCounter;
+}
+
+SceneCache::SceneCache()
+{
+}
+
+SceneCache::~SceneCache()
+{
+}
+
+void SceneCache::PackObject(const SceneObject& object, std::string& bytes)
+{
+	PackFields(object, 0, bytes);
+}
+
+bool SceneCache::UnpackObject(const unsigned char* bytes, size_t size, SceneObject& object)
+{
+	return UnpackFields(bytes, size, 0, object);
+}
+
+void SceneCache::PackFields(const SceneObject& object, unsigned include, std::string& bytes)
+{
+	std::vector<unsigned char> record(include == 0 ? s_recordSize : GetRecordSize(include));
+	std::string strings;
+	WrittenStrings writtenStrings;
+	WriteRecord(object, strings, writtenStrings, record.data(), include);
+
+	bytes.assign(reinterpret_cast<const char*>(record.data()), record.size());
+	bytes += strings;
+}
+
+bool SceneCache::UnpackFields(const unsigned char* bytes, size_t size, unsigned include, SceneObject& object)
+{
+	size_t recordSize = include == 0 ? s_recordSize : GetRecordSize(include);
+	if (size < recordSize)
+	{
+		return false;
+	}
+
+	ReadStrings readStrings;
+	return ReadRecord(bytes, reinterpret_cast<const char*>(bytes + recordSize), size - recordSize, readStrings, object, include);
+}
+
+std::string SceneCache::GetCachePath(const char* databasePath)
+{
+	return std::string(databasePath) + ".cache";
+}
+
+bool SceneCache::ReadStamp(const char* databasePath, DatabaseStamp& stamp)
+{
+	memset(&stamp, 0, sizeof(stamp));
+
+#ifdef _WIN32
+	struct _stat64 info;
+	if (_stat64(databasePath, &info) != 0)
+#else
+	struct stat info;
+	if (stat(databasePath, &info) != 0)
+#endif
+	{
+		return false;
+	}
+	stamp.size = (uint64_t)info.st_size;
+	stamp.modified = (int64_t)info.st_mtime;
+
+	// File change counter is the big endian 4 byte integer at offset 24 of the sqlite header
+	FILE* pFile = fopen(databasePath, "rb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	unsigned char header[28];
+	size_t read = fread(header, 1, sizeof(header), pFile);
+	fclose(pFile);
+	if (read != sizeof(header))
+	{
+		return false;
+	}
+
+	stamp.changeCounter = ((uint32_t)header[24] << 24) | ((uint32_t)header[25] << 16) | ((uint32_t)header[26] << 8) | (uint32_t)header[27];
+	return true;
+}
+
+bool SceneCache::IsCurrent(const char* databasePath)
+{
+	DatabaseStamp current;
+	if (!ReadStamp(databasePath, current))
+	{
+		return false;
+	}
+
+	FILE* pFile = fopen(GetCachePath(databasePath).c_str(), "rb");
+	if (pFile == NULL)
+	{
+		return false;
+	}
+
+	SceneCacheHeader header;
+	size_t read = fread(&header, 1, sizeof(header), pFile);
+	fclose(pFile);
+
+	return read == sizeof(header) && memcmp(header.magic, s_cacheMagic, sizeof(s_cacheMagic)) == 0
+		&& header.version == SCENE_CACHE_VERSION && header.stamp == current;
+}
+
+bool SceneCache::Load(const char* databasePath, std::vector<SceneObject>& sceneGraph)
+{
+	DatabaseStamp current;
+	if (!ReadStamp(databasePath, current))
+	{
+		m_lastError = "Can't read the database file";
+		return false;
+	}
+
+	MappedFile file;
+	if (!file.Open(GetCachePath(databasePath).c_str()))
+	{
+		m_lastError = "No cache";
+		return false;
+	}
+
+	// Check the header before trusting anything else in the file
+	if (file.GetSize() < sizeof(SceneCacheHeader))
+	{
+		m_lastError = "Cache is truncated";
+		return false;
+	}
+
+	SceneCacheHeader header;
+	memcpy(&header, file.GetData(), sizeof(header));
+
+	if (memcmp(header.magic, s_cacheMagic, sizeof(s_cacheMagic)) != 0 || header.version != SCENE_CACHE_VERSION || header.recordSize != s_recordSize)
+	{
+		m_lastError = "Cache is from a different version";
+		return false;
+	}
+
+	if (!(header.stamp == current))
+	{
+		m_lastError = "Database has changed since the cache was written";
+		return false;
+	}
+
+	uint64_t recordsSize = (uint64_t)header.objectCount * s_recordSize;
+	if (sizeof(SceneCacheHeader) + recordsSize + header.stringsSize != file.GetSize())
+	{
+		m_lastError = "Cache is the wrong size";
+		return false;
+	}
+
+	const unsigned char* payload = file.GetData() + sizeof(SceneCacheHeader);
+	if (Checksum(payload, (size_t)(recordsSize + header.stringsSize)) != header.checksum)
+	{
+		m_lastError = "Cache checksum doesn't match";
+		return false;
+	}
+
+	const unsigned char* records = payload;
+	const char* strings = reinterpret_cast<const char*>(payload + recordsSize);
+
+	size_t firstObject = sceneGraph.size();
+	sceneGraph.resize(firstObject + header.objectCount);
+	ReadStrings readStrings;
+
+	for (uint32_t i = 0; i < header.objectCount; i++)
+	{
+		if (!ReadRecord(records + i * s_recordSize, strings, header.stringsSize, readStrings, sceneGraph[firstObject + i]))
+		{
+			sceneGraph.resize(firstObject);
+			m_lastError = "Cache has a string out of range";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool SceneCache::Write(const char* databasePath, const std::vector<SceneObject>& sceneGraph)
+{
+	SceneCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, s_cacheMagic, sizeof(s_cacheMagic));
+	header.version = SCENE_CACHE_VERSION;
+	header.recordSize = (uint32_t)s_recordSize;
+	header.objectCount = (uint32_t)sceneGraph.size();
+
+	if (!ReadStamp(databasePath, header.stamp))
+	{
+		m_lastError = "Can't read the database file";
+		return false;
+	}
+
+	std::vector<unsigned char> records(sceneGraph.size() * s_recordSize);
+	std::string strings;
+	WrittenStrings writtenStrings;
+
+	for (size_t i = 0; i < sceneGraph.size(); i++)
+	{
+		WriteRecord(sceneGraph[i], strings, writtenStrings, records.data() + i * s_recordSize);
+	}
+
+	size_t recordsSize = records.size();
+	header.stringsSize = strings.size();
+	header.checksum = Checksum(reinterpret_cast<const unsigned char*>(records.data()), recordsSize);
+	header.checksum = Checksum(reinterpret_cast<const unsigned char*>(strings.data()), strings.size(), header.checksum);
+
+	// Write to a temporary file and swap it in, so a crash part way through never leaves a half written cache
+	std::string cachePath = GetCachePath(databasePath);
+	std::string tempPath = cachePath + ".tmp";
+
+	FILE* pFile = fopen(tempPath.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		m_lastError = "Can't create " + tempPath;
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, pFile) == 1
+		&& (recordsSize == 0 || fwrite(records.data(), recordsSize, 1, pFile) == 1)
+		&& (strings.empty() || fwrite(strings.data(), strings.size(), 1, pFile) == 1);
+	written = (fclose(pFile) == 0) && written;
+
+	if (!written)
+	{
+		remove(tempPath.c_str());
+		m_lastError = "Can't write " + tempPath;
+		return false;
+	}
+
+	remove(cachePath.c_str());
+	if (rename(tempPath.c_str(), cachePath.c_str()) != 0)
+	{
+		remove(tempPath.c_str());
+		m_lastError = "Can't replace " + cachePath;
+		return false;
+	}
+
+	return true;
+}
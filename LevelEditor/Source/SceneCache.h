@@ -0,0 +1,55 @@
+#pragma once
+#include "SceneObject.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Bump whenever the field table in SceneFields.h or the file layout changes, old caches are then ignored
+#define SCENE_CACHE_VERSION 3
+
+// Identifies the state of the database file a cache was made from. Sqlite increments the change counter
+// in the file header on every commit, size and modified time catch the file being replaced.
+struct DatabaseStamp
+{
+	uint64_t size;
+	int64_t modified;
+	uint32_t changeCounter;
+
+	bool operator==(const DatabaseStamp& other) const;
+};
+
+// Binary image of the scene graph stored next to the database, e.g. "database/test.db.cache".
+// Layout: header, one fixed size record per object, then the text of every string.
+// Loading memory maps the file and checks the stamp and checksum, so a stale or damaged cache is never used.
+class SceneCache
+{
+public:
+	SceneCache();
+	~SceneCache();
+
+	// Build the scene graph from the cache. Returns false if the cache is missing, stale, damaged or from another version.
+	bool Load(const char* databasePath, std::vector<SceneObject>& sceneGraph);
+
+	// Write the scene graph, stamped with the database's current state. Only call when the two match.
+	bool Write(const char* databasePath, const std::vector<SceneObject>& sceneGraph);
+
+	// True if there is a cache matching the current state of the database
+	bool IsCurrent(const char* databasePath);
+
+	// A single object in the cache's record format followed by its strings, for other files that store objects
+	static void PackObject(const SceneObject& object, std::string& bytes);
+	static bool UnpackObject(const unsigned char* bytes, size_t size, SceneObject& object);
+
+	// The same for only the fields with any of the include flags from SceneFields.h, e.g. FIELD_TRANSFORM
+	static void PackFields(const SceneObject& object, unsigned include, std::string& bytes);
+	static bool UnpackFields(const unsigned char* bytes, size_t size, unsigned include, SceneObject& object);
+
+	static std::string GetCachePath(const char* databasePath);
+	static bool ReadStamp(const char* databasePath, DatabaseStamp& stamp);
+
+	// Reason the last load or write failed
+	const std::string& GetLastError() { return m_lastError; };
+
+private:
+	std::string m_lastError;
+};
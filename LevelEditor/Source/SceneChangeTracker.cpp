@@ -0,0 +1,37 @@
+#include "SceneChangeTracker.h"
+
+SceneChangeTracker::SceneChangeTracker()
+{
+}
+
+SceneChangeTracker::~SceneChangeTracker()
+{
+}
+
+void SceneChangeTracker::MarkModified(int ID)
+{
+	// Row will be rewritten, so any pending delete is no longer needed
+	m_deleted.erase(ID);
+	m_modified.insert(ID);
+	m_unjournaled.insert(ID);
+}
+
+void SceneChangeTracker::MarkDeleted(int ID)
+{
+	m_modified.erase(ID);
+	m_deleted.insert(ID);
+	m_unjournaled.insert(ID);
+}
+
+void SceneChangeTracker::Clear()
+{
+	m_modified.clear();
+	m_deleted.clear();
+	m_unjournaled.clear();
+}
+
+void SceneChangeTracker::TakeUnjournaled(std::unordered_set<int>& IDs)
+{
+	IDs.clear();
+	IDs.swap(m_unjournaled);
+}
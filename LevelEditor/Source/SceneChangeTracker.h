@@ -0,0 +1,35 @@
+#pragma once
+#include <unordered_set>
+
+// Keeps track of which objects have changed since the last save, by ID, so only those rows need to be written.
+class SceneChangeTracker
+{
+public:
+	SceneChangeTracker();
+	~SceneChangeTracker();
+
+	// Object has been added or had a property changed
+	void MarkModified(int ID);
+
+	// Object has been removed from the scene graph
+	void MarkDeleted(int ID);
+
+	// Forget all changes, used after saving or loading
+	void Clear();
+
+	// Hands over the IDs changed or deleted since the last call, for the edit journal
+	void TakeUnjournaled(std::unordered_set<int>& IDs);
+
+	// Getters
+	bool HasChanges() const { return !m_modified.empty() || !m_deleted.empty(); };
+	const std::unordered_set<int>& GetModified() const { return m_modified; };
+	const std::unordered_set<int>& GetDeleted() const { return m_deleted; };
+
+private:
+	// An ID is only ever in one of these sets, whichever happened last wins
+	std::unordered_set<int> m_modified;
+	std::unordered_set<int> m_deleted;
+
+	// Changed or deleted since the edit journal last looked
+	std::unordered_set<int> m_unjournaled;
+};
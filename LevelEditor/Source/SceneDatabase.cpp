@@ -0,0 +1,959 @@
+#include "SceneDatabase.h"
+#include "Benchmark.h"
+#include "SceneFields.h"
+#include <sstream>
+#include <thread>
+
+// Column values by type. Bools and ints are stored as integers, floats as doubles so no precision is lost.
+// Strings are bound static as the object outlives the step.
+static void BindValue(sqlite3_stmt* statement, int index, int value) { sqlite3_bind_int(statement, index, value); }
+static void BindValue(sqlite3_stmt* statement, int index, bool value) { sqlite3_bind_int(statement, index, value); }
+static void BindValue(sqlite3_stmt* statement, int index, float value) { sqlite3_bind_double(statement, index, value); }
+static void BindValue(sqlite3_stmt* statement, int index, const InternedString& value) { sqlite3_bind_text(statement, index, value.c_str(), (int)value.size(), SQLITE_STATIC); }
+static void BindValue(sqlite3_stmt* statement, int index, const std::string& value) { sqlite3_bind_text(statement, index, value.c_str(), (int)value.size(), SQLITE_STATIC); }
+
+// Text columns can be NULL, which can't be assigned to a string
+static const char* ReadText(sqlite3_stmt* statement, int column)
+{
+	const unsigned char* text = sqlite3_column_text(statement, column);
+	return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+static void ReadValue(sqlite3_stmt* statement, int column, int& value) { value = sqlite3_column_int(statement, column); }
+static void ReadValue(sqlite3_stmt* statement, int column, bool& value) { value = sqlite3_column_int(statement, column) != 0; }
+static void ReadValue(sqlite3_stmt* statement, int column, float& value) { value = (float)sqlite3_column_double(statement, column); }
+static void ReadValue(sqlite3_stmt* statement, int column, InternedString& value) { value = ReadText(statement, column); }
+static void ReadValue(sqlite3_stmt* statement, int column, std::string& value) { value = ReadText(statement, column); }
+
+// Comma separated names of the columns with any of the flags, in table order
+template<typename Fields>
+static std::string ColumnList(const Fields& fields, unsigned flags)
+{
+	std::string columns;
+	ForEachField(fields, [&](const auto& field)
+	{
+		if (field.column && field.Has(flags))
+		{
+			columns += columns.empty() ? "" : ", ";
+			columns += field.column;
+		}
+	});
+	return columns;
+}
+
+// "INSERT INTO table VALUES(?,?,...)" with a parameter for every column
+template<typename Fields>
+static std::string InsertCommand(const char* table, const Fields& fields)
+{
+	std::string sqlCommand = std::string("INSERT INTO ") + table + " VALUES(";
+	int columns = 0;
+	ForEachField(fields, [&](const auto& field)
+	{
+		if (field.column)
+		{
+			sqlCommand += (columns++ == 0) ? "?" : ",?";
+		}
+	});
+	sqlCommand += ")";
+	return sqlCommand;
+}
+
+// Binds every column, parameters are 1 based
+template<typename Owner, typename Fields>
+static void BindFields(sqlite3_stmt* statement, const Owner& owner, const Fields& fields)
+{
+	int index = 1;
+	ForEachField(fields, [&](const auto& field)
+	{
+		if (field.column)
+		{
+			BindValue(statement, index++, field.Get(owner));
+		}
+	});
+}
+
+// Reads the columns with any of the include flags, or every column if include is 0, from a row of
+// "SELECT <those columns>"
+template<typename Owner, typename Fields>
+static void ReadFields(sqlite3_stmt* statement, Owner& owner, const Fields& fields, unsigned include = 0)
+{
+	int column = 0;
+	ForEachField(fields, [&](const auto& field)
+	{
+		if (field.column && (include == 0 || field.Has(include)))
+		{
+			typename std::decay<decltype(field)>::type::Type value;
+			ReadValue(statement, column++, value);
+			field.Set(owner, value);
+		}
+	});
+}
+
+// Columns every object needs for display, picking and manipulation
+static const std::string& GetHotColumns()
+{
+	static const std::string columns = ColumnList(SceneObjectFields(), FIELD_HOT);
+	return columns;
+}
+
+// The rest, only needed once an object is selected or saved
+static const std::string& GetColdColumns()
+{
+	static const std::string columns = ColumnList(SceneObjectFields(), FIELD_COLD);
+	return columns;
+}
+
+SpatialRegion SpatialRegion::Around(float x, float y, float z, float radius)
+{
+	SpatialRegion region;
+	region.minX = x - radius;
+	region.minY = y - radius;
+	region.minZ = z - radius;
+	region.maxX = x + radius;
+	region.maxY = y + radius;
+	region.maxZ = z + radius;
+	return region;
+}
+
+bool SpatialRegion::Contains(float x, float y, float z) const
+{
+	return x >= minX && x <= maxX && y >= minY && y <= maxY && z >= minZ && z <= maxZ;
+}
+
+SceneDatabase::SceneDatabase()
+{
+	m_connection = NULL;
+	m_hasSpatialIndex = false;
+}
+
+SceneDatabase::~SceneDatabase()
+{
+	Close();
+}
+
+bool SceneDatabase::Open(const char* path, bool create)
+{
+	Close();
+
+	int flags = SQLITE_OPEN_READWRITE;
+	if (create)
+	{
+		flags |= SQLITE_OPEN_CREATE;
+	}
+
+	m_path = path;
+	int rc = sqlite3_open_v2(path, &m_connection, flags, NULL);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		sqlite3_close(m_connection);
+		m_connection = NULL;
+		return false;
+	}
+
+	// Saves run on a second connection, so wait for its lock rather than failing straight away
+	sqlite3_busy_timeout(m_connection, 5000);
+
+	// Only use the spatial index if it exists and this build of sqlite has the R*Tree module to read it
+	sqlite3_stmt* pCheck;
+	m_hasSpatialIndex = (sqlite3_prepare_v2(m_connection, "SELECT ID FROM Objects_Spatial LIMIT 1", -1, &pCheck, 0) == SQLITE_OK);
+	sqlite3_finalize(pCheck);
+
+	return true;
+}
+
+void SceneDatabase::Close()
+{
+	if (m_connection)
+	{
+		sqlite3_close(m_connection);
+		m_connection = NULL;
+	}
+	m_hasSpatialIndex = false;
+}
+
+bool SceneDatabase::CopySchema(SceneDatabase* source)
+{
+	sqlite3_stmt* pResults;
+	// The spatial index and its shadow tables are rebuilt below rather than copied
+	int rc = sqlite3_prepare_v2(source->GetConnection(), "SELECT sql FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'Objects_Spatial%'", -1, &pResults, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(source->GetConnection());
+		return false;
+	}
+
+	// Run each table's create statement against this database
+	bool success = true;
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		const char* sql = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 0));
+		if (sql && !Execute(sql))
+		{
+			success = false;
+			break;
+		}
+	}
+
+	sqlite3_finalize(pResults);
+
+	if (success && source->HasSpatialIndex())
+	{
+		success = CreateSpatialIndex();
+	}
+
+	return success;
+}
+
+bool SceneDatabase::LoadObjects(std::vector<SceneObject>& sceneGraph)
+{
+	sqlite3_stmt* pResults;
+	int rc = sqlite3_prepare_v2(m_connection, "SELECT * FROM Objects", -1, &pResults, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	//for every row in the results we create an object
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		SceneObject newSceneObject;
+		ReadObject(pResults, newSceneObject);
+		sceneGraph.push_back(newSceneObject);
+	}
+
+	sqlite3_finalize(pResults);
+	return true;
+}
+
+bool SceneDatabase::LoadHotObjects(std::vector<SceneObject>& sceneGraph, int threads)
+{
+	// Split the table into even ranges of rowid, which sqlite can seek to directly
+	sqlite3_stmt* pRange;
+	if (sqlite3_prepare_v2(m_connection, "SELECT MIN(rowid), MAX(rowid), COUNT(*) FROM Objects", -1, &pRange, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	sqlite3_int64 firstRow = 0, lastRow = -1, rows = 0;
+	if (sqlite3_step(pRange) == SQLITE_ROW)
+	{
+		firstRow = sqlite3_column_int64(pRange, 0);
+		lastRow = sqlite3_column_int64(pRange, 1);
+		rows = sqlite3_column_int64(pRange, 2);
+	}
+	sqlite3_finalize(pRange);
+
+	if (rows == 0)
+	{
+		return true;
+	}
+
+	if (threads <= 1 || rows < PARALLEL_LOAD_MIN_ROWS)
+	{
+		return LoadHotRange(firstRow, lastRow, sceneGraph);
+	}
+
+	// Connections can't be shared between threads that step at the same time, so each worker opens its own
+	std::vector<std::vector<SceneObject>> ranges(threads);
+	std::vector<std::string> errors(threads);
+	std::vector<std::thread> workers;
+	sqlite3_int64 rangeSize = (lastRow - firstRow) / threads + 1;
+	for (int i = 0; i < threads; i++)
+	{
+		sqlite3_int64 rangeFirst = firstRow + rangeSize * i;
+		sqlite3_int64 rangeLast = (i == threads - 1) ? lastRow : rangeFirst + rangeSize - 1;
+		workers.push_back(std::thread([this, i, rangeFirst, rangeLast, &ranges, &errors]()
+		{
+			SceneDatabase worker;
+			if (!worker.Open(m_path.c_str()) || !worker.LoadHotRange(rangeFirst, rangeLast, ranges[i]))
+			{
+				errors[i] = worker.GetLastError().empty() ? "Can't read objects" : worker.GetLastError();
+			}
+		}));
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (const std::string& error : errors)
+	{
+		if (!error.empty())
+		{
+			m_lastError = error;
+			return false;
+		}
+	}
+
+	// Ranges are in rowid order, so joining them keeps the order of a single "SELECT *"
+	sceneGraph.reserve(sceneGraph.size() + rows);
+	for (std::vector<SceneObject>& range : ranges)
+	{
+		sceneGraph.insert(sceneGraph.end(), range.begin(), range.end());
+	}
+	return true;
+}
+
+bool SceneDatabase::LoadHotRange(sqlite3_int64 firstRow, sqlite3_int64 lastRow, std::vector<SceneObject>& sceneGraph)
+{
+	std::string sql = "SELECT " + GetHotColumns() + " FROM Objects WHERE rowid BETWEEN ? AND ? ORDER BY rowid";
+	sqlite3_stmt* pResults;
+	if (sqlite3_prepare_v2(m_connection, sql.c_str(), -1, &pResults, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	sqlite3_bind_int64(pResults, 1, firstRow);
+	sqlite3_bind_int64(pResults, 2, lastRow);
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		sceneGraph.push_back(SceneObject());
+		ReadHotColumns(pResults, sceneGraph.back());
+	}
+
+	sqlite3_finalize(pResults);
+	return true;
+}
+
+bool SceneDatabase::LoadColdColumns(SceneObject& object)
+{
+	if (object.coldLoaded)
+	{
+		return true;
+	}
+
+	std::string sql = "SELECT " + GetColdColumns() + " FROM Objects WHERE ID = ?";
+	sqlite3_stmt* pSelect;
+	if (sqlite3_prepare_v2(m_connection, sql.c_str(), -1, &pSelect, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	bool success = ReadColdRow(pSelect, object);
+	sqlite3_finalize(pSelect);
+	return success;
+}
+
+bool SceneDatabase::ReadColdRow(sqlite3_stmt* pSelect, SceneObject& object)
+{
+	sqlite3_bind_int(pSelect, 1, object.ID);
+	int rc = sqlite3_step(pSelect);
+	if (rc == SQLITE_ROW)
+	{
+		ReadColdColumns(pSelect, object);
+	}
+	sqlite3_reset(pSelect);
+
+	if (rc != SQLITE_ROW && rc != SQLITE_DONE)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	// Nothing stored yet, the defaults are all there is
+	object.coldLoaded = true;
+	return true;
+}
+
+bool SceneDatabase::LoadObjectsInChunk(int chunkID, std::vector<SceneObject>& sceneGraph)
+{
+	sqlite3_stmt* pResults;
+	int rc = sqlite3_prepare_v2(m_connection, "SELECT * FROM Objects WHERE chunk_ID = ?", -1, &pResults, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	sqlite3_bind_int(pResults, 1, chunkID);
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		SceneObject newSceneObject;
+		ReadObject(pResults, newSceneObject);
+		sceneGraph.push_back(newSceneObject);
+	}
+
+	sqlite3_finalize(pResults);
+	return true;
+}
+
+bool SceneDatabase::LoadChunks(std::vector<ChunkObject>& chunks)
+{
+	sqlite3_stmt* pResults;
+	int rc = sqlite3_prepare_v2(m_connection, "SELECT * FROM Chunks ORDER BY ID", -1, &pResults, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return false;
+	}
+
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		ChunkObject chunk;
+		ReadChunk(pResults, chunk);
+		chunks.push_back(chunk);
+	}
+
+	sqlite3_finalize(pResults);
+	return true;
+}
+
+bool SceneDatabase::SaveChunks(const std::vector<ChunkObject>& chunks)
+{
+	if (!Execute("BEGIN TRANSACTION"))
+	{
+		return false;
+	}
+
+	sqlite3_stmt* pInsert;
+	int rc = sqlite3_prepare_v2(m_connection, InsertCommand("Chunks", ChunkObjectFields()).c_str(), -1, &pInsert, 0);
+	if (rc != SQLITE_OK || !Execute("DELETE FROM Chunks"))
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		sqlite3_finalize(pInsert);
+		Execute("ROLLBACK");
+		return false;
+	}
+
+	for (const ChunkObject& chunk : chunks)
+	{
+		BindFields(pInsert, chunk, ChunkObjectFields());
+
+		bool success = (sqlite3_step(pInsert) == SQLITE_DONE);
+		sqlite3_reset(pInsert);
+
+		if (!success)
+		{
+			m_lastError = sqlite3_errmsg(m_connection);
+			sqlite3_finalize(pInsert);
+			Execute("ROLLBACK");
+			return false;
+		}
+	}
+
+	sqlite3_finalize(pInsert);
+	return Execute("COMMIT");
+}
+
+int SceneDatabase::LoadObjectsInRegion(const SpatialRegion& region, int chunkID, const std::unordered_set<int>& skip, std::vector<SceneObject>& sceneGraph)
+{
+	if (!m_hasSpatialIndex)
+	{
+		m_lastError = "No spatial index";
+		return -1;
+	}
+
+	// The R*Tree finds the IDs in the box, then each row is looked up through the ID index
+	sqlite3_stmt* pResults;
+	int rc = sqlite3_prepare_v2(m_connection,
+		"SELECT Objects.* FROM Objects_Spatial JOIN Objects ON Objects.ID = Objects_Spatial.ID "
+		"WHERE Objects_Spatial.maxX >= ?1 AND Objects_Spatial.minX <= ?2 "
+		"AND Objects_Spatial.maxY >= ?3 AND Objects_Spatial.minY <= ?4 "
+		"AND Objects_Spatial.maxZ >= ?5 AND Objects_Spatial.minZ <= ?6 "
+		"AND (?7 < 0 OR Objects.chunk_ID = ?7)", -1, &pResults, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return -1;
+	}
+
+	sqlite3_bind_double(pResults, 1, region.minX);
+	sqlite3_bind_double(pResults, 2, region.maxX);
+	sqlite3_bind_double(pResults, 3, region.minY);
+	sqlite3_bind_double(pResults, 4, region.maxY);
+	sqlite3_bind_double(pResults, 5, region.minZ);
+	sqlite3_bind_double(pResults, 6, region.maxZ);
+	sqlite3_bind_int(pResults, 7, chunkID);
+
+	int added = 0;
+	while (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		// Check the ID before decoding the rest of the row
+		if (skip.find(sqlite3_column_int(pResults, 0)) != skip.end())
+		{
+			continue;
+		}
+
+		SceneObject newSceneObject;
+		ReadObject(pResults, newSceneObject);
+		sceneGraph.push_back(newSceneObject);
+		added++;
+	}
+
+	sqlite3_finalize(pResults);
+	return added;
+}
+
+int SceneDatabase::CountObjects()
+{
+	return QueryInt("SELECT COUNT(*) FROM Objects", 0);
+}
+
+int SceneDatabase::GetHighestID()
+{
+	return QueryInt("SELECT IFNULL(MAX(ID), -1) FROM Objects", -1);
+}
+
+bool SceneDatabase::CreateSpatialIndex()
+{
+	if (m_hasSpatialIndex)
+	{
+		return true;
+	}
+
+	if (!Execute("BEGIN TRANSACTION"))
+	{
+		return false;
+	}
+
+	// Objects are indexed by position only, so each entry is a point box.
+	// Fails here if sqlite was built without the R*Tree module, and loading carries on reading everything.
+	bool success = Execute("CREATE VIRTUAL TABLE Objects_Spatial USING rtree(ID, minX, maxX, minY, maxY, minZ, maxZ)")
+		&& Execute("INSERT INTO Objects_Spatial SELECT ID, position_x, position_x, position_y, position_y, position_z, position_z FROM Objects")
+		&& Execute("CREATE INDEX IF NOT EXISTS Objects_ID ON Objects (ID)");
+
+	if (!success || !Execute("COMMIT"))
+	{
+		Execute("ROLLBACK");
+		return false;
+	}
+
+	m_hasSpatialIndex = true;
+	return true;
+}
+
+// Stats returned when a save is abandoned part way through
+static SaveStats FailedSave(int rows, const BenchmarkTimer& timer)
+{
+	SaveStats stats;
+	stats.success = false;
+	stats.rows = rows;
+	stats.seconds = timer.GetElapsedSeconds();
+	return stats;
+}
+
+SaveStats SceneDatabase::SaveObjects(const std::vector<SceneObject>& sceneGraph)
+{
+	BenchmarkTimer timer;
+
+	// Everything happens in one transaction so there is only one journal sync for the whole save
+	if (!Execute("BEGIN TRANSACTION"))
+	{
+		return FailedSave(0, timer);
+	}
+
+	if (!Execute("DELETE FROM Objects") || (m_hasSpatialIndex && !Execute("DELETE FROM Objects_Spatial")))
+	{
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	// Prepare once, then reset and rebind for every object
+	sqlite3_stmt* pInsert;
+	int rc = sqlite3_prepare_v2(m_connection, InsertCommand("Objects", SceneObjectFields()).c_str(), -1, &pInsert, 0);
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	sqlite3_stmt* pSpatialDelete = NULL;
+	sqlite3_stmt* pSpatialInsert = NULL;
+	if (!PrepareSpatialStatements(&pSpatialDelete, &pSpatialInsert))
+	{
+		sqlite3_finalize(pInsert);
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	int rows = 0;
+	for (const SceneObject& object : sceneGraph)
+	{
+		BindObject(pInsert, object);
+
+		bool success = (sqlite3_step(pInsert) == SQLITE_DONE);
+		sqlite3_reset(pInsert);
+
+		if (success)
+		{
+			success = WriteSpatialRow(pSpatialDelete, pSpatialInsert, object.ID, &object);
+		}
+
+		if (!success)
+		{
+			m_lastError = sqlite3_errmsg(m_connection);
+			sqlite3_finalize(pInsert);
+			sqlite3_finalize(pSpatialDelete);
+			sqlite3_finalize(pSpatialInsert);
+			Execute("ROLLBACK");
+			return FailedSave(rows, timer);
+		}
+
+		rows++;
+	}
+
+	sqlite3_finalize(pInsert);
+	sqlite3_finalize(pSpatialDelete);
+	sqlite3_finalize(pSpatialInsert);
+
+	if (!Execute("COMMIT"))
+	{
+		Execute("ROLLBACK");
+		return FailedSave(rows, timer);
+	}
+
+	SaveStats stats;
+	stats.success = true;
+	stats.rows = rows;
+	stats.seconds = timer.GetElapsedSeconds();
+	return stats;
+}
+
+SaveStats SceneDatabase::SaveChanges(const std::vector<SceneObject>& sceneGraph, SceneChangeTracker* changes)
+{
+	BenchmarkTimer timer;
+
+	if (!Execute("BEGIN TRANSACTION"))
+	{
+		return FailedSave(0, timer);
+	}
+
+	// Rows are found by ID, so make sure that doesn't need a full table scan
+	if (!Execute("CREATE INDEX IF NOT EXISTS Objects_ID ON Objects (ID)"))
+	{
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	sqlite3_stmt* pDelete;
+	sqlite3_stmt* pInsert;
+	if (sqlite3_prepare_v2(m_connection, "DELETE FROM Objects WHERE ID = ?", -1, &pDelete, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+	if (sqlite3_prepare_v2(m_connection, InsertCommand("Objects", SceneObjectFields()).c_str(), -1, &pInsert, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		sqlite3_finalize(pDelete);
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	sqlite3_stmt* pSpatialDelete = NULL;
+	sqlite3_stmt* pSpatialInsert = NULL;
+	if (!PrepareSpatialStatements(&pSpatialDelete, &pSpatialInsert))
+	{
+		sqlite3_finalize(pDelete);
+		sqlite3_finalize(pInsert);
+		Execute("ROLLBACK");
+		return FailedSave(0, timer);
+	}
+
+	int rows = 0;
+	bool success = true;
+
+	// Remove deleted objects
+	for (int ID : changes->GetDeleted())
+	{
+		sqlite3_bind_int(pDelete, 1, ID);
+		success = (sqlite3_step(pDelete) == SQLITE_DONE);
+		sqlite3_reset(pDelete);
+
+		if (success)
+		{
+			success = WriteSpatialRow(pSpatialDelete, pSpatialInsert, ID, NULL);
+		}
+
+		if (!success)
+		{
+			break;
+		}
+		rows++;
+	}
+
+	// Replace the rows of modified objects. Delete first as the table has no key to replace on.
+	// Objects that only have their hot columns take the rest from the row being replaced.
+	const std::unordered_set<int>& modified = changes->GetModified();
+	sqlite3_stmt* pCold = NULL;
+	if (success && !modified.empty())
+	{
+		for (const SceneObject& modifiedObject : sceneGraph)
+		{
+			if (modified.find(modifiedObject.ID) == modified.end())
+			{
+				continue;
+			}
+
+			SceneObject object = modifiedObject;
+			if (!object.coldLoaded)
+			{
+				std::string sql = "SELECT " + GetColdColumns() + " FROM Objects WHERE ID = ?";
+				success = (pCold != NULL || sqlite3_prepare_v2(m_connection, sql.c_str(), -1, &pCold, 0) == SQLITE_OK) && ReadColdRow(pCold, object);
+				if (!success)
+				{
+					break;
+				}
+			}
+
+			sqlite3_bind_int(pDelete, 1, object.ID);
+			success = (sqlite3_step(pDelete) == SQLITE_DONE);
+			sqlite3_reset(pDelete);
+
+			if (success)
+			{
+				BindObject(pInsert, object);
+				success = (sqlite3_step(pInsert) == SQLITE_DONE);
+				sqlite3_reset(pInsert);
+			}
+
+			if (success)
+			{
+				success = WriteSpatialRow(pSpatialDelete, pSpatialInsert, object.ID, &object);
+			}
+
+			if (!success)
+			{
+				break;
+			}
+			rows++;
+		}
+	}
+
+	if (!success)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+	}
+
+	sqlite3_finalize(pDelete);
+	sqlite3_finalize(pInsert);
+	sqlite3_finalize(pCold);
+	sqlite3_finalize(pSpatialDelete);
+	sqlite3_finalize(pSpatialInsert);
+
+	if (!success || !Execute("COMMIT"))
+	{
+		Execute("ROLLBACK");
+		return FailedSave(rows, timer);
+	}
+
+	SaveStats stats;
+	stats.success = true;
+	stats.rows = rows;
+	stats.seconds = timer.GetElapsedSeconds();
+	return stats;
+}
+
+SaveStats SceneDatabase::SaveObjectsLegacy(const std::vector<SceneObject>& sceneGraph)
+{
+	BenchmarkTimer timer;
+	sqlite3_stmt* pResults;
+
+	//OBJECTS IN THE WORLD Delete them all
+	if (!Execute("DELETE FROM Objects"))
+	{
+		return FailedSave(0, timer);
+	}
+
+	//Populate with our new objects, one statement each
+	int rows = 0;
+	for (const SceneObject& object : sceneGraph)
+	{
+		const SceneObjectCold& cold = object.GetCold();
+		std::stringstream command;
+		command << "INSERT INTO Objects "
+			<< "VALUES(" << object.ID << ","
+			<< object.chunk_ID << ","
+			<< "'" << object.model_path << "'" << ","
+			<< "'" << object.tex_diffuse_path << "'" << ","
+			<< object.posX << ","
+			<< object.posY << ","
+			<< object.posZ << ","
+			<< object.rotX << ","
+			<< object.rotY << ","
+			<< object.rotZ << ","
+			<< object.scaX << ","
+			<< object.scaY << ","
+			<< object.scaZ << ","
+			<< object.render << ","
+			<< object.collision << ","
+			<< "'" << cold.collision_mesh << "'" << ","
+			<< cold.collectable << ","
+			<< cold.destructable << ","
+			<< cold.health_amount << ","
+			<< object.editor_render << ","
+			<< object.editor_texture_vis << ","
+			<< object.editor_normals_vis << ","
+			<< object.editor_collision_vis << ","
+			<< object.editor_pivot_vis << ","
+			<< cold.pivotX << ","
+			<< cold.pivotY << ","
+			<< cold.pivotZ << ","
+			<< object.snapToGround << ","
+			<< cold.AINode << ","
+			<< "'" << cold.audio_path << "'" << ","
+			<< cold.volume << ","
+			<< cold.pitch << ","
+			<< cold.pan << ","
+			<< cold.one_shot << ","
+			<< cold.play_on_init << ","
+			<< cold.play_in_editor << ","
+			<< cold.min_dist << ","
+			<< cold.max_dist << ","
+			<< cold.camera << ","
+			<< cold.path_node << ","
+			<< cold.path_node_start << ","
+			<< cold.path_node_end << ","
+			<< cold.parent_id << ","
+			<< object.editor_wireframe << ","
+			<< "'" << cold.name << "'" << ","
+			<< cold.light_type << ","
+			<< cold.light_diffuse_r << ","
+			<< cold.light_diffuse_g << ","
+			<< cold.light_diffuse_b << ","
+			<< cold.light_specular_r << ","
+			<< cold.light_specular_g << ","
+			<< cold.light_specular_b << ","
+			<< cold.light_spot_cutoff << ","
+			<< cold.light_constant << ","
+			<< cold.light_linear << ","
+			<< cold.light_quadratic
+			<< ")";
+
+		std::string sqlCommand = command.str();
+		int rc = sqlite3_prepare_v2(m_connection, sqlCommand.c_str(), -1, &pResults, 0);
+		if (rc == SQLITE_OK)
+		{
+			sqlite3_step(pResults);
+			sqlite3_finalize(pResults);
+			rows++;
+		}
+	}
+
+	SaveStats stats;
+	stats.success = (rows == (int)sceneGraph.size());
+	stats.rows = rows;
+	stats.seconds = timer.GetElapsedSeconds();
+	return stats;
+}
+
+void SceneDatabase::BindObject(sqlite3_stmt* statement, const SceneObject& object)
+{
+	BindFields(statement, object, SceneObjectFields());
+}
+
+void SceneDatabase::ReadObject(sqlite3_stmt* statement, SceneObject& object)
+{
+	ReadFields(statement, object, SceneObjectFields());
+	object.coldLoaded = true;
+}
+
+void SceneDatabase::ReadHotColumns(sqlite3_stmt* statement, SceneObject& object)
+{
+	ReadFields(statement, object, SceneObjectFields(), FIELD_HOT);
+	object.coldLoaded = false;
+}
+
+void SceneDatabase::ReadColdColumns(sqlite3_stmt* statement, SceneObject& object)
+{
+	ReadFields(statement, object, SceneObjectFields(), FIELD_COLD);
+	object.coldLoaded = true;
+}
+
+void SceneDatabase::ReadChunk(sqlite3_stmt* statement, ChunkObject& chunk)
+{
+	ReadFields(statement, chunk, ChunkObjectFields());
+}
+
+bool SceneDatabase::PrepareSpatialStatements(sqlite3_stmt** pDelete, sqlite3_stmt** pInsert)
+{
+	*pDelete = NULL;
+	*pInsert = NULL;
+
+	if (!m_hasSpatialIndex)
+	{
+		return true;
+	}
+
+	if (sqlite3_prepare_v2(m_connection, "DELETE FROM Objects_Spatial WHERE ID = ?", -1, pDelete, 0) != SQLITE_OK
+		|| sqlite3_prepare_v2(m_connection, "INSERT INTO Objects_Spatial VALUES(?,?,?,?,?,?,?)", -1, pInsert, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		sqlite3_finalize(*pDelete);
+		*pDelete = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+bool SceneDatabase::WriteSpatialRow(sqlite3_stmt* pDelete, sqlite3_stmt* pInsert, int ID, const SceneObject* object)
+{
+	// No index, nothing to keep in step
+	if (!pDelete)
+	{
+		return true;
+	}
+
+	sqlite3_bind_int(pDelete, 1, ID);
+	bool success = (sqlite3_step(pDelete) == SQLITE_DONE);
+	sqlite3_reset(pDelete);
+
+	// Object is NULL when it has been deleted
+	if (success && object)
+	{
+		sqlite3_bind_int(pInsert, 1, ID);
+		sqlite3_bind_double(pInsert, 2, object->posX);
+		sqlite3_bind_double(pInsert, 3, object->posX);
+		sqlite3_bind_double(pInsert, 4, object->posY);
+		sqlite3_bind_double(pInsert, 5, object->posY);
+		sqlite3_bind_double(pInsert, 6, object->posZ);
+		sqlite3_bind_double(pInsert, 7, object->posZ);
+		success = (sqlite3_step(pInsert) == SQLITE_DONE);
+		sqlite3_reset(pInsert);
+	}
+
+	return success;
+}
+
+int SceneDatabase::QueryInt(const char* sql, int fallback)
+{
+	sqlite3_stmt* pResults;
+	if (sqlite3_prepare_v2(m_connection, sql, -1, &pResults, 0) != SQLITE_OK)
+	{
+		m_lastError = sqlite3_errmsg(m_connection);
+		return fallback;
+	}
+
+	int value = fallback;
+	if (sqlite3_step(pResults) == SQLITE_ROW)
+	{
+		value = sqlite3_column_int(pResults, 0);
+	}
+
+	sqlite3_finalize(pResults);
+	return value;
+}
+
+bool SceneDatabase::Execute(const char* sql)
+{
+	char* errorMessage = 0;
+	int rc = sqlite3_exec(m_connection, sql, NULL, NULL, &errorMessage);
+
+	if (rc != SQLITE_OK)
+	{
+		m_lastError = errorMessage ? errorMessage : sqlite3_errmsg(m_connection);
+		sqlite3_free(errorMessage);
+		return false;
+	}
+
+	return true;
+}
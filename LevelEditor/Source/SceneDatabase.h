@@ -0,0 +1,133 @@
+#pragma once
+#include "../sqlite3.h"
+#include "SceneObject.h"
+#include "ChunkObject.h"
+#include "SceneChangeTracker.h"
+#include <string>
+#include <vector>
+#include <unordered_set>
+
+// Whole level loads with fewer rows than this are read on one thread, as starting workers costs more than it saves
+#define PARALLEL_LOAD_MIN_ROWS 20000
+
+// Results of a save, used for reporting throughput
+struct SaveStats
+{
+	bool success;
+	int rows;			// number of rows written
+	double seconds;		// time taken to write them
+
+	double GetRowsPerSecond() const { return seconds > 0 ? rows / seconds : 0; };
+};
+
+// Axis aligned box for spatial queries
+struct SpatialRegion
+{
+	float minX, minY, minZ;
+	float maxX, maxY, maxZ;
+
+	// Cube around a point, e.g. the camera
+	static SpatialRegion Around(float x, float y, float z, float radius);
+	bool Contains(float x, float y, float z) const;
+};
+
+// Wraps the sqlite connection and handles writing the scene graph to the Objects table
+class SceneDatabase
+{
+public:
+	SceneDatabase();
+	~SceneDatabase();
+
+	// Open or close the database file
+	bool Open(const char* path, bool create = false);
+	void Close();
+	bool IsOpen() { return m_connection != NULL; };
+	sqlite3* GetConnection() { return m_connection; };
+
+	// Copy the table definitions of another database, used for creating scratch databases for benchmarking
+	bool CopySchema(SceneDatabase* source);
+
+	// Read every object in the Objects table
+	bool LoadObjects(std::vector<SceneObject>& sceneGraph);
+
+	// Read only the hot columns of every object: ID, chunk, model and texture paths, transform and render flags.
+	// Ranges of rows are decoded on worker threads, each with its own connection, and joined in table order.
+	// Objects come back with coldLoaded false; audio, light, gameplay and path node columns are left to LoadColdColumns.
+	bool LoadHotObjects(std::vector<SceneObject>& sceneGraph, int threads);
+
+	// Fill in the columns LoadHotObjects skipped from the object's row. An object with no row yet is only marked loaded.
+	bool LoadColdColumns(SceneObject& object);
+
+	// Read the objects belonging to one chunk
+	bool LoadObjectsInChunk(int chunkID, std::vector<SceneObject>& sceneGraph);
+
+	// Read every row of the Chunks table
+	bool LoadChunks(std::vector<ChunkObject>& chunks);
+
+	// Replace the contents of the Chunks table, in one transaction
+	bool SaveChunks(const std::vector<ChunkObject>& chunks);
+
+	// Read only the objects positioned inside the region, using the spatial index. Objects whose ID is in skip
+	// (already loaded) are left out. A chunkID of -1 matches any chunk. Returns the number of objects added, -1 on error.
+	int LoadObjectsInRegion(const SpatialRegion& region, int chunkID, const std::unordered_set<int>& skip, std::vector<SceneObject>& sceneGraph);
+
+	// Row count and highest ID in the Objects table, including objects that haven't been loaded
+	int CountObjects();
+	int GetHighestID();
+
+	// R*Tree over object positions. Optional: needs sqlite built with SQLITE_ENABLE_RTREE, and once it exists
+	// every save keeps it in step with the Objects table.
+	bool HasSpatialIndex() { return m_hasSpatialIndex; };
+	bool CreateSpatialIndex();
+
+	// Replace the contents of the Objects table with the scene graph.
+	// Uses a single transaction and one prepared statement with bound parameters. Objects need their cold columns loaded.
+	SaveStats SaveObjects(const std::vector<SceneObject>& sceneGraph);
+
+	// Only write the rows that have changed since the last save. Deleted objects are removed and
+	// modified or added objects have their row replaced, keeping the stored cold columns of objects that
+	// never loaded them. The tracker is left for the caller to clear.
+	SaveStats SaveChanges(const std::vector<SceneObject>& sceneGraph, SceneChangeTracker* changes);
+
+	// Original save path, one formatted INSERT per object in autocommit mode. Only kept for benchmark comparisons.
+	SaveStats SaveObjectsLegacy(const std::vector<SceneObject>& sceneGraph);
+
+	// Last error message reported by sqlite
+	const std::string& GetLastError() { return m_lastError; };
+
+private:
+	// Binds every column of the object to the insert statement. These and the readers below are generated
+	// from the field tables in SceneFields.h.
+	static void BindObject(sqlite3_stmt* statement, const SceneObject& object);
+
+	// Fills the object from a row of "SELECT * FROM Objects"
+	static void ReadObject(sqlite3_stmt* statement, SceneObject& object);
+
+	// Fill the object from a row of "SELECT <hot columns>" or "SELECT <cold columns>", see LoadHotObjects
+	static void ReadHotColumns(sqlite3_stmt* statement, SceneObject& object);
+	static void ReadColdColumns(sqlite3_stmt* statement, SceneObject& object);
+
+	// Reads the hot columns of rows firstRow to lastRow by rowid, one worker's share of LoadHotObjects
+	bool LoadHotRange(sqlite3_int64 firstRow, sqlite3_int64 lastRow, std::vector<SceneObject>& sceneGraph);
+
+	// Cold columns of the row with the object's ID, using a prepared "SELECT <cold columns> ... WHERE ID = ?"
+	bool ReadColdRow(sqlite3_stmt* pSelect, SceneObject& object);
+
+	// Fills the chunk from a row of "SELECT * FROM Chunks"
+	static void ReadChunk(sqlite3_stmt* statement, ChunkObject& chunk);
+
+	// Spatial index rows, the statements are only prepared if the index exists
+	bool PrepareSpatialStatements(sqlite3_stmt** pDelete, sqlite3_stmt** pInsert);
+	static bool WriteSpatialRow(sqlite3_stmt* pDelete, sqlite3_stmt* pInsert, int ID, const SceneObject* object);
+
+	// Single integer result of a query, or fallback if it fails
+	int QueryInt(const char* sql, int fallback);
+
+	// Runs a statement with no results
+	bool Execute(const char* sql);
+
+	sqlite3* m_connection;
+	std::string m_path;			// for opening worker connections
+	bool m_hasSpatialIndex;
+	std::string m_lastError;
+};
@@ -0,0 +1,185 @@
+#pragma once
+#include "SceneObject.h"
+#include "ChunkObject.h"
+#include <tuple>
+#include <utility>
+
+// Field flags
+#define FIELD_KEY		0x01	// identifies the row, never copied between objects
+#define FIELD_HOT		0x02	// read up front by SceneDatabase::LoadHotObjects
+#define FIELD_COLD		0x04	// read on demand by SceneDatabase::LoadColdColumns
+#define FIELD_TRANSFORM	0x08	// position, rotation or scale
+#define FIELD_NO_COLUMN	0x10	// editor state, kept in binary files but not in the database
+#define FIELD_UNDO		0x20	// set from the object dialog, so restored by undo and redo along with the transform
+
+// One member of a class and the column it is stored in. The member is a template parameter, so the code
+// generated for a table of these reads and writes members directly, the same as if it was written out by hand.
+template<typename Owner, typename T, T Owner::*Member>
+struct Field
+{
+	typedef T Type;
+
+	const char* column;
+	unsigned flags;
+
+	static const T& Get(const Owner& owner) { return owner.*Member; }
+	static void Set(Owner& owner, const T& value) { owner.*Member = value; }
+	bool Has(unsigned flag) const { return (flags & flag) != 0; }
+};
+
+// The same for a member of SceneObjectCold, reached through the SceneObject that holds it. Setting a cold column
+// to the value it already has leaves the record alone, so loading an object whose cold columns are all defaults
+// doesn't give it a record of its own.
+template<typename T, T SceneObjectCold::*Member>
+struct ColdField
+{
+	typedef T Type;
+
+	const char* column;
+	unsigned flags;
+
+	static const T& Get(const SceneObject& owner) { return owner.GetCold().*Member; }
+	static void Set(SceneObject& owner, const T& value)
+	{
+		if (!(owner.GetCold().*Member == value))
+		{
+			owner.EditCold().*Member = value;
+		}
+	}
+	bool Has(unsigned flag) const { return (flags & flag) != 0; }
+};
+
+#define FIELD(Owner, member, column, flags) Field<Owner, decltype(Owner::member), &Owner::member>{ column, flags }
+#define COLD_FIELD(member, column, flags) ColdField<decltype(SceneObjectCold::member), &SceneObjectCold::member>{ column, flags }
+
+// Every field of a SceneObject in Objects table column order, cold columns included. Loading, saving, the scene
+// cache, the edit journal and undo all work from this list. Adding a column still means editing by hand:
+//   SceneDatabase::SaveObjectsLegacy, the old whole-table save kept to benchmark against
+//   Game::MakeDisplayObject, if display objects need the field
+//   ObjectDialog, if it should be editable, and then FIELD_UNDO here
+inline auto SceneObjectFields()
+{
+	return std::make_tuple(
+		FIELD(SceneObject, ID, "ID", FIELD_KEY | FIELD_HOT),
+		FIELD(SceneObject, chunk_ID, "chunk_ID", FIELD_HOT),
+		FIELD(SceneObject, model_path, "mesh", FIELD_HOT | FIELD_UNDO),
+		FIELD(SceneObject, tex_diffuse_path, "tex_diffuse", FIELD_HOT | FIELD_UNDO),
+		FIELD(SceneObject, posX, "position_x", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, posY, "position_y", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, posZ, "position_z", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, rotX, "rotation_x", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, rotY, "rotation_y", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, rotZ, "rotation_z", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, scaX, "scale_x", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, scaY, "scale_y", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, scaZ, "scale_z", FIELD_HOT | FIELD_TRANSFORM),
+		FIELD(SceneObject, render, "render", FIELD_HOT),
+		FIELD(SceneObject, collision, "collision", FIELD_HOT),
+		COLD_FIELD(collision_mesh, "collision_mesh", FIELD_COLD),
+		COLD_FIELD(collectable, "collectable", FIELD_COLD),
+		COLD_FIELD(destructable, "destructable", FIELD_COLD),
+		COLD_FIELD(health_amount, "health_amount", FIELD_COLD),
+		FIELD(SceneObject, editor_render, "editor_render", FIELD_HOT | FIELD_UNDO),
+		FIELD(SceneObject, editor_texture_vis, "editor_texture_vis", FIELD_HOT),
+		FIELD(SceneObject, editor_normals_vis, "editor_normals_vis", FIELD_HOT),
+		FIELD(SceneObject, editor_collision_vis, "editor_collision_vis", FIELD_HOT),
+		FIELD(SceneObject, editor_pivot_vis, "editor_pivot_vis", FIELD_HOT),
+		COLD_FIELD(pivotX, "pivot_x", FIELD_COLD),
+		COLD_FIELD(pivotY, "pivot_y", FIELD_COLD),
+		COLD_FIELD(pivotZ, "pivot_z", FIELD_COLD),
+		FIELD(SceneObject, snapToGround, "snap_to_ground", FIELD_HOT | FIELD_UNDO),
+		COLD_FIELD(AINode, "AI_node", FIELD_COLD),
+		COLD_FIELD(audio_path, "audio_file", FIELD_COLD),
+		COLD_FIELD(volume, "volume", FIELD_COLD),
+		COLD_FIELD(pitch, "pitch", FIELD_COLD),
+		COLD_FIELD(pan, "pan", FIELD_COLD),
+		COLD_FIELD(one_shot, "one_shot", FIELD_COLD),
+		COLD_FIELD(play_on_init, "play_on_init", FIELD_COLD),
+		COLD_FIELD(play_in_editor, "play_in_editor", FIELD_COLD),
+		COLD_FIELD(min_dist, "min_dist", FIELD_COLD),
+		COLD_FIELD(max_dist, "max_dist", FIELD_COLD),
+		COLD_FIELD(camera, "camera", FIELD_COLD),
+		COLD_FIELD(path_node, "path_node", FIELD_COLD),
+		COLD_FIELD(path_node_start, "path_node_start", FIELD_COLD),
+		COLD_FIELD(path_node_end, "path_node_end", FIELD_COLD),
+		COLD_FIELD(parent_id, "parent_ID", FIELD_COLD),
+		FIELD(SceneObject, editor_wireframe, "editor_wireframe", FIELD_HOT),
+		COLD_FIELD(name, "name", FIELD_COLD),
+		COLD_FIELD(light_type, "light_type", FIELD_COLD),
+		COLD_FIELD(light_diffuse_r, "light_diffuse_r", FIELD_COLD),
+		COLD_FIELD(light_diffuse_g, "light_diffuse_g", FIELD_COLD),
+		COLD_FIELD(light_diffuse_b, "light_diffuse_b", FIELD_COLD),
+		COLD_FIELD(light_specular_r, "light_specular_r", FIELD_COLD),
+		COLD_FIELD(light_specular_g, "light_specular_g", FIELD_COLD),
+		COLD_FIELD(light_specular_b, "light_specular_b", FIELD_COLD),
+		COLD_FIELD(light_spot_cutoff, "light_spot_cutoff", FIELD_COLD),
+		COLD_FIELD(light_constant, "light_constant", FIELD_COLD),
+		COLD_FIELD(light_linear, "light_linear", FIELD_COLD),
+		COLD_FIELD(light_quadratic, "light_quadratic", FIELD_COLD),
+		FIELD(SceneObject, coldLoaded, NULL, FIELD_NO_COLUMN));
+}
+
+// Every field of a ChunkObject in Chunks table column order, names spelt as the table has them
+inline auto ChunkObjectFields()
+{
+	return std::make_tuple(
+		FIELD(ChunkObject, ID, "ID", FIELD_KEY),
+		FIELD(ChunkObject, name, "name", 0),
+		FIELD(ChunkObject, chunk_x_size_metres, "chunk_x_size_metres", 0),
+		FIELD(ChunkObject, chunk_y_size_metres, "chunk_z_size_metres", 0),
+		FIELD(ChunkObject, chunk_base_resolution, "chunk_base_resolution", 0),
+		FIELD(ChunkObject, heightmap_path, "heightmap", 0),
+		FIELD(ChunkObject, tex_diffuse_path, "tex_diffuse", 0),
+		FIELD(ChunkObject, tex_splat_alpha_path, "tex_spat_alpha", 0),
+		FIELD(ChunkObject, tex_splat_1_path, "tex_splat_1", 0),
+		FIELD(ChunkObject, tex_splat_2_path, "tex_splat_2", 0),
+		FIELD(ChunkObject, tex_splat_3_path, "tex_splat_3", 0),
+		FIELD(ChunkObject, tex_splat_4_path, "tex_splat_4", 0),
+		FIELD(ChunkObject, render_wireframe, "render_wireframe", 0),
+		FIELD(ChunkObject, render_normals, "render_normals", 0),
+		FIELD(ChunkObject, tex_diffuse_tiling, "diffuse_tiling", 0),
+		FIELD(ChunkObject, tex_splat_1_tiling, "tex_splat_1_tiling", 0),
+		FIELD(ChunkObject, tex_splat_2_tiling, "tex_splat_2_tiling", 0),
+		FIELD(ChunkObject, tex_splat_3_tiling, "tex_splat_3_tiling", 0),
+		FIELD(ChunkObject, tex_splat_4_tiling, "tex_splat_4_tiling", 0));
+}
+
+template<typename Fields, typename Function, size_t... Index>
+void ForEachFieldIn(const Fields& fields, Function& function, std::index_sequence<Index...>)
+{
+	// One call per field in table order, unrolled at compile time
+	int expand[] = { 0, (function(std::get<Index>(fields)), 0)... };
+	(void)expand;
+}
+
+// Calls function(field) for every field in the table
+template<typename Fields, typename Function>
+void ForEachField(const Fields& fields, Function function)
+{
+	ForEachFieldIn(fields, function, std::make_index_sequence<std::tuple_size<Fields>::value>());
+}
+
+// Copies the fields that have any of the include flags and none of the exclude flags
+template<typename Owner, typename Fields>
+void CopyFields(Owner& to, const Owner& from, const Fields& fields, unsigned include, unsigned exclude = 0)
+{
+	ForEachField(fields, [&](const auto& field)
+	{
+		if (field.Has(include) && !field.Has(exclude))
+		{
+			field.Set(to, field.Get(from));
+		}
+	});
+}
+
+// True if every field without any of the ignore flags matches
+template<typename Owner, typename Fields>
+bool FieldsEqual(const Owner& a, const Owner& b, const Fields& fields, unsigned ignore = 0)
+{
+	bool equal = true;
+	ForEachField(fields, [&](const auto& field)
+	{
+		equal = equal && (field.Has(ignore) || field.Get(a) == field.Get(b));
+	});
+	return equal;
+}
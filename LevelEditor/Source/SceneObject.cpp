@@ -2,28 +2,13 @@
 
 
 
-SceneObject::SceneObject()
+SceneObjectCold::SceneObjectCold()
 {
-	ID = 0;
-	chunk_ID =0 ;
-	model_path ="";
-	tex_diffuse_path = "";
-	posX = 0.0f;	posY = 0.0f;	posZ = 0.0f;
-	rotX = 0.0f;	rotY = 0.0f;	rotZ = 0.0f;
-	scaX = 0.0f;	scaY = 0.0f;	scaZ = 0.0f;
-	render = true;
-	collision = false;
 	collision_mesh ="";
 	collectable = false;
 	destructable = false;
 	health_amount = 0;
-	editor_render = true;  
-	editor_texture_vis = true;
-	editor_normals_vis = false;
-	editor_collision_vis = false;
-	editor_pivot_vis = true;
 	pivotX = 0.0f; pivotY = 0.0f; pivotZ = 0.0f;
-	snapToGround = false;
 	AINode = false;
 	audio_path = "";
 	volume =0.0f;
@@ -39,7 +24,6 @@ SceneObject::SceneObject()
 	path_node_start = false;
 	path_node_end = false;
 	parent_id =0;
-	editor_wireframe=false;
 	name ="";
 	light_type = 1;
 	light_diffuse_r = 1;	light_diffuse_g = 1;	light_diffuse_b = 1;
@@ -50,7 +34,48 @@ SceneObject::SceneObject()
 	light_quadratic = 1;
 }
 
+SceneObject::SceneObject()
+{
+	ID = 0;
+	chunk_ID =0 ;
+	model_path ="";
+	tex_diffuse_path = "";
+	posX = 0.0f;	posY = 0.0f;	posZ = 0.0f;
+	rotX = 0.0f;	rotY = 0.0f;	rotZ = 0.0f;
+	scaX = 0.0f;	scaY = 0.0f;	scaZ = 0.0f;
+	render = true;
+	collision = false;
+	editor_render = true;  
+	editor_texture_vis = true;
+	editor_normals_vis = false;
+	editor_collision_vis = false;
+	editor_pivot_vis = true;
+	snapToGround = false;
+	editor_wireframe=false;
+	coldLoaded = true;
+}
+
 
 SceneObject::~SceneObject()
 {
 }
+
+const SceneObjectCold& SceneObject::GetCold() const
+{
+	// Made on first use rather than at startup, the interned strings it holds need their table first
+	static const SceneObjectCold defaults;
+	return m_cold ? *m_cold : defaults;
+}
+
+SceneObjectCold& SceneObject::EditCold()
+{
+	if (!m_cold)
+	{
+		m_cold = std::make_shared<SceneObjectCold>();
+	}
+	else if (m_cold.use_count() > 1)
+	{
+		m_cold = std::make_shared<SceneObjectCold>(*m_cold);
+	}
+	return *m_cold;
+}
@@ -1,34 +1,26 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include "InternedString.h"
 
 
 //This object should accurately and totally reflect the information stored in the object table
+//Text fields are interned, see InternedString. The columns the editor rarely reads are in SceneObjectCold.
 
 
-class SceneObject
+// Columns only the object's own dialog and saving look at: gameplay, audio, path node and light settings.
+// They are kept out of line so the scene graph's loops over every object don't pull them through the cache.
+struct SceneObjectCold
 {
-public:
-	SceneObject();
-	~SceneObject();
+	SceneObjectCold();
 
-	int ID;
-	int chunk_ID;
-	std::string model_path;
-	std::string tex_diffuse_path;
-	float posX, posY, posZ;
-	float rotX, rotY, rotZ;
-	float scaX, scaY, scaZ;
-	bool render, collision;
-	std::string collision_mesh;
+	InternedString collision_mesh;
 	bool collectable, destructable;
 	int health_amount;
-	bool editor_render, editor_texture_vis;
-	bool editor_normals_vis, editor_collision_vis, editor_pivot_vis;
 	float pivotX, pivotY, pivotZ;
-	bool snapToGround;
 	bool AINode;
-	std::string audio_path;
+	InternedString audio_path;
 	float volume;
 	float pitch;
 	float pan;
@@ -42,8 +34,7 @@ public:
 	bool path_node_start;
 	bool path_node_end;
 	int parent_id;
-	bool editor_wireframe;
-	std::string name;
+	InternedString name;
 	int light_type;
 	float light_diffuse_r, light_diffuse_g, light_diffuse_b;
 	float light_specular_r, light_specular_g, light_specular_b;
@@ -51,6 +42,38 @@ public:
 	float light_constant;
 	float light_linear;
 	float light_quadratic;
-
 };
 
+class SceneObject
+{
+public:
+	SceneObject();
+	~SceneObject();
+
+	int ID;
+	int chunk_ID;
+	InternedString model_path;
+	InternedString tex_diffuse_path;
+	float posX, posY, posZ;
+	float rotX, rotY, rotZ;
+	float scaX, scaY, scaZ;
+	bool render, collision;
+	bool editor_render, editor_texture_vis;
+	bool editor_normals_vis, editor_collision_vis, editor_pivot_vis;
+	bool snapToGround;
+	bool editor_wireframe;
+
+	// False when only the hot columns have been read (see SceneDatabase::LoadHotObjects). The cold ones still
+	// hold defaults until SceneDatabase::LoadColdColumns fills them, saves read them from the row first.
+	bool coldLoaded;
+
+	// Cold columns, the defaults if none have been set
+	const SceneObjectCold& GetCold() const;
+
+	// For changing them. Copies of an object share its cold columns until one of them is changed, so snapshots
+	// for saving and undo stay cheap, and the record is copied here first if anything else still holds it.
+	SceneObjectCold& EditCold();
+
+private:
+	std::shared_ptr<SceneObjectCold> m_cold;	// null while every cold column has its default
+};
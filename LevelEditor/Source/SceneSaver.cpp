@@ -0,0 +1,246 @@
+#include "SceneSaver.h"
+#include <cstdio>
+#include <unordered_map>
+#include <algorithm>
+
+SaveJob::SaveJob()
+{
+	saveHeightMap = false;
+	checkpoint = 0;
+}
+
+void SaveJob::Merge(const SaveJob& newer)
+{
+	// Objects deleted since are dropped from this save and deleted instead
+	const std::unordered_set<int>& deleted = newer.changes.GetDeleted();
+	if (!deleted.empty())
+	{
+		for (int ID : deleted)
+		{
+			changes.MarkDeleted(ID);
+		}
+
+		std::vector<SceneObject> kept;
+		kept.reserve(objects.size());
+		for (const SceneObject& object : objects)
+		{
+			if (deleted.find(object.ID) == deleted.end())
+			{
+				kept.push_back(object);
+			}
+		}
+		objects.swap(kept);
+	}
+
+	// Newer copies replace older ones
+	std::unordered_map<int, size_t> indices;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		indices[objects[i].ID] = i;
+	}
+
+	for (const SceneObject& object : newer.objects)
+	{
+		auto existing = indices.find(object.ID);
+		if (existing != indices.end())
+		{
+			objects[existing->second] = object;
+		}
+		else
+		{
+			indices[object.ID] = objects.size();
+			objects.push_back(object);
+		}
+		changes.MarkModified(object.ID);
+	}
+
+	if (newer.saveHeightMap)
+	{
+		saveHeightMap = true;
+		heightMapPath = newer.heightMapPath;
+		heightMap = newer.heightMap;
+	}
+
+	// One result comes back for both, and it covers everything either could compact
+	checkpoint = std::max(checkpoint, newer.checkpoint);
+}
+
+SceneSaver::SceneSaver()
+{
+	m_running = false;
+	m_stop = false;
+	m_writing = false;
+	m_hasPending = false;
+}
+
+SceneSaver::~SceneSaver()
+{
+	Stop();
+}
+
+bool SceneSaver::Start(const char* databasePath)
+{
+	Stop();
+
+	// Separate connection, sqlite connections shouldn't be shared between threads
+	if (!m_database.Open(databasePath))
+	{
+		m_lastError = m_database.GetLastError();
+		return false;
+	}
+
+	m_stop = false;
+	m_running = true;
+	m_thread = std::thread(&SceneSaver::WorkerLoop, this);
+	return true;
+}
+
+void SceneSaver::Stop()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	// Writer finishes anything pending before it sees the stop flag
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+
+	m_running = false;
+	m_database.Close();
+}
+
+void SceneSaver::Queue(const SaveJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		// Coalesce with a save that hasn't started yet
+		if (m_hasPending)
+		{
+			m_pending.Merge(job);
+		}
+		else
+		{
+			m_pending = job;
+			m_hasPending = true;
+		}
+	}
+
+	m_wake.notify_one();
+}
+
+bool SceneSaver::IsBusy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_hasPending || m_writing;
+}
+
+void SceneSaver::WaitUntilIdle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_idle.wait(lock, [this] { return !m_hasPending && !m_writing; });
+}
+
+bool SceneSaver::PollResult(SaveResult& result)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_results.empty())
+	{
+		return false;
+	}
+
+	result = m_results.front();
+	m_results.pop_front();
+	return true;
+}
+
+void SceneSaver::GetSavingIDs(std::unordered_set<int>& IDs)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_hasPending)
+	{
+		IDs.insert(m_pending.changes.GetModified().begin(), m_pending.changes.GetModified().end());
+	}
+	IDs.insert(m_writingIDs.begin(), m_writingIDs.end());
+	for (const SaveResult& result : m_results)
+	{
+		IDs.insert(result.job.changes.GetModified().begin(), result.job.changes.GetModified().end());
+	}
+}
+
+void SceneSaver::WorkerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_wake.wait(lock, [this] { return m_hasPending || m_stop; });
+
+		if (!m_hasPending)
+		{
+			break; // stopping with nothing left to write
+		}
+
+		// Take the pending save, any save queued from now on waits for the next pass
+		SaveResult result;
+		result.job = m_pending;
+		m_pending = SaveJob();
+		m_hasPending = false;
+		m_writing = true;
+		m_writingIDs.assign(result.job.changes.GetModified().begin(), result.job.changes.GetModified().end());
+
+		// Write without holding the lock so the main thread is never blocked by disk I/O
+		lock.unlock();
+
+		result.stats = m_database.SaveChanges(result.job.objects, &result.job.changes);
+		result.success = result.stats.success;
+		if (!result.success)
+		{
+			result.error = m_database.GetLastError();
+		}
+		else if (result.job.saveHeightMap)
+		{
+			result.success = WriteHeightMap(result.job, result.error);
+		}
+
+		lock.lock();
+
+		m_writing = false;
+		m_writingIDs.clear();
+		m_results.push_back(result);
+		if (!m_hasPending)
+		{
+			m_idle.notify_all();
+		}
+	}
+
+	m_idle.notify_all();
+}
+
+bool SceneSaver::WriteHeightMap(const SaveJob& job, std::string& error)
+{
+	FILE* pFile = fopen(job.heightMapPath.c_str(), "wb+");
+	if (pFile == NULL)
+	{
+		error = "Can't open the height map " + job.heightMapPath;
+		return false;
+	}
+
+	size_t written = fwrite(job.heightMap.data(), 1, job.heightMap.size(), pFile);
+	fclose(pFile);
+
+	if (written != job.heightMap.size())
+	{
+		error = "Height map was not fully written";
+		return false;
+	}
+
+	return true;
+}
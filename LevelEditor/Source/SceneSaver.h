@@ -0,0 +1,91 @@
+#pragma once
+#include "SceneDatabase.h"
+#include "SceneChangeTracker.h"
+#include "SceneObject.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Everything needed to write one save. Copied out of the scene so editing can carry on while it is written.
+struct SaveJob
+{
+	SaveJob();
+
+	std::vector<SceneObject> objects;			// copies of the added or modified objects
+	SceneChangeTracker changes;					// IDs to write and IDs to delete
+
+	bool saveHeightMap;							// heightmap was sculpted
+	std::string heightMapPath;
+	std::vector<unsigned char> heightMap;
+
+	uint64_t checkpoint;						// edit journal records up to here can go once written, 0 if they can't
+
+	// Fold a newer save into this one, newer values win
+	void Merge(const SaveJob& newer);
+};
+
+// Outcome of a finished save, handed back to the main thread
+struct SaveResult
+{
+	bool success;
+	SaveStats stats;
+	std::string error;
+	SaveJob job;		// kept so the changes can be flagged again if the save failed, and for its checkpoint
+};
+
+// Writes saves on a background thread with its own database connection
+class SceneSaver
+{
+public:
+	SceneSaver();
+	~SceneSaver();
+
+	// Start and stop the writer thread. Stopping finishes any queued save first.
+	bool Start(const char* databasePath);
+	void Stop();
+
+	// Hand a save to the writer. If a save is already waiting to be written the two are combined into one.
+	void Queue(const SaveJob& job);
+
+	// True while a save is waiting or being written
+	bool IsBusy();
+
+	// Block until everything queued has been written, used before reloading the level
+	void WaitUntilIdle();
+
+	// Get the next finished save, returns false if there isn't one
+	bool PollResult(SaveResult& result);
+
+	// Add the IDs of objects written by saves that are waiting, being written, or finished but not yet collected with
+	// PollResult. Until then the database can't be trusted to have them.
+	void GetSavingIDs(std::unordered_set<int>& IDs);
+
+	const std::string& GetLastError() { return m_lastError; };
+
+private:
+	void WorkerLoop();
+	bool WriteHeightMap(const SaveJob& job, std::string& error);
+
+	// Writer thread and the state it shares with the main thread. Everything below is guarded by the mutex.
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::condition_variable m_idle;
+
+	bool m_running;
+	bool m_stop;
+	bool m_writing;
+	bool m_hasPending;
+	SaveJob m_pending;
+	std::vector<int> m_writingIDs;		// objects in the save being written
+	std::deque<SaveResult> m_results;
+
+	// Only used by the writer thread once started
+	SceneDatabase m_database;
+	std::string m_lastError;
+};
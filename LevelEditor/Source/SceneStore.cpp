@@ -0,0 +1,133 @@
+#include "SceneStore.h"
+
+SceneStore::SceneStore()
+{
+}
+
+SceneStore::~SceneStore()
+{
+}
+
+void SceneStore::Build(const std::vector<SceneObject>& sceneGraph)
+{
+	Clear();
+	Resize(sceneGraph.size());
+	m_indexByID.reserve(sceneGraph.size());
+
+	for (size_t i = 0; i < sceneGraph.size(); i++)
+	{
+		Write((int)i, sceneGraph[i]);
+		m_indexByID[sceneGraph[i].ID] = (int)i;
+	}
+}
+
+void SceneStore::Clear()
+{
+	Resize(0);
+	m_indexByID.clear();
+}
+
+int SceneStore::Append(const SceneObject& object)
+{
+	int index = Size();
+	Resize(index + 1);
+	Write(index, object);
+	m_indexByID[object.ID] = index;
+	return index;
+}
+
+void SceneStore::Set(int index, const SceneObject& object)
+{
+	if (m_IDs[index] != object.ID)
+	{
+		m_indexByID.erase(m_IDs[index]);
+		m_indexByID[object.ID] = index;
+	}
+
+	Write(index, object);
+}
+
+void SceneStore::SetTransform(int index, const SceneObject& object)
+{
+	m_posX[index] = object.posX;	m_posY[index] = object.posY;	m_posZ[index] = object.posZ;
+	m_rotX[index] = object.rotX;	m_rotY[index] = object.rotY;	m_rotZ[index] = object.rotZ;
+	m_scaX[index] = object.scaX;	m_scaY[index] = object.scaY;	m_scaZ[index] = object.scaZ;
+}
+
+void SceneStore::Remove(int index)
+{
+	m_indexByID.erase(m_IDs[index]);
+
+	// The last object moves into the gap, as Game::RemoveObject does with the scene graph, so only one index changes
+	int last = Size() - 1;
+	if (index != last)
+	{
+		m_IDs[index] = m_IDs[last];
+		m_posX[index] = m_posX[last];	m_posY[index] = m_posY[last];	m_posZ[index] = m_posZ[last];
+		m_rotX[index] = m_rotX[last];	m_rotY[index] = m_rotY[last];	m_rotZ[index] = m_rotZ[last];
+		m_scaX[index] = m_scaX[last];	m_scaY[index] = m_scaY[last];	m_scaZ[index] = m_scaZ[last];
+		m_indexByID[m_IDs[index]] = index;
+	}
+
+	Resize(last);
+}
+
+int SceneStore::FindIndex(int ID) const
+{
+	auto found = m_indexByID.find(ID);
+	if (found == m_indexByID.end())
+	{
+		return -1;
+	}
+
+	return found->second;
+}
+
+int SceneStore::FindHighestID() const
+{
+	int highestID = -1;
+	const int* IDs = m_IDs.data();
+	int count = Size();
+
+	for (int i = 0; i < count; i++)
+	{
+		if (IDs[i] > highestID)
+		{
+			highestID = IDs[i];
+		}
+	}
+
+	return highestID;
+}
+
+int SceneStore::FindAtPosition(float x, float y, float z) const
+{
+	const float* posX = m_posX.data();
+	const float* posY = m_posY.data();
+	const float* posZ = m_posZ.data();
+	int count = Size();
+
+	for (int i = 0; i < count; i++)
+	{
+		if (posX[i] == x && posY[i] == y && posZ[i] == z)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+void SceneStore::Write(int index, const SceneObject& object)
+{
+	m_IDs[index] = object.ID;
+	SetTransform(index, object);
+}
+
+void SceneStore::Resize(size_t size)
+{
+	m_IDs.resize(size);
+	m_posX.resize(size);	m_posY.resize(size);	m_posZ.resize(size);
+	m_rotX.resize(size);	m_rotY.resize(size);	m_rotZ.resize(size);
+	m_scaX.resize(size);	m_scaY.resize(size);	m_scaZ.resize(size);
+}
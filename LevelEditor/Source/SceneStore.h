@@ -0,0 +1,51 @@
+#pragma once
+#include "SceneObject.h"
+#include <vector>
+#include <unordered_map>
+
+// Structure of arrays copy of the scene graph's IDs and transforms, one dense array per field, so loops over every
+// object (ID lookups, position checks, transform updates) only touch the data they need. Everything else is only
+// in the scene graph, whose objects keep their cold columns out of line in SceneObjectCold. Indices match the scene
+// graph it was built from.
+class SceneStore
+{
+public:
+	SceneStore();
+	~SceneStore();
+
+	void Build(const std::vector<SceneObject>& sceneGraph);
+	void Clear();
+	int Append(const SceneObject& object);
+	void Set(int index, const SceneObject& object);
+	void SetTransform(int index, const SceneObject& object);
+	void Remove(int index);		//the last object takes its index
+
+	int Size() const { return (int)m_IDs.size(); };
+
+	// Queries over the hot arrays
+	int FindIndex(int ID) const;							// -1 if not found
+	int FindHighestID() const;								// -1 if empty
+	int FindAtPosition(float x, float y, float z) const;	// first object exactly at the position, -1 if none
+
+	// Hot arrays, Size() entries each
+	const int* GetIDs() const { return m_IDs.data(); };
+	const float* GetPositionX() const { return m_posX.data(); };
+	const float* GetPositionY() const { return m_posY.data(); };
+	const float* GetPositionZ() const { return m_posZ.data(); };
+	const float* GetRotationX() const { return m_rotX.data(); };
+	const float* GetRotationY() const { return m_rotY.data(); };
+	const float* GetRotationZ() const { return m_rotZ.data(); };
+	const float* GetScaleX() const { return m_scaX.data(); };
+	const float* GetScaleY() const { return m_scaY.data(); };
+	const float* GetScaleZ() const { return m_scaZ.data(); };
+
+private:
+	void Write(int index, const SceneObject& object);
+	void Resize(size_t size);
+
+	std::vector<int> m_IDs;
+	std::vector<float> m_posX, m_posY, m_posZ;
+	std::vector<float> m_rotX, m_rotY, m_rotZ;
+	std::vector<float> m_scaX, m_scaY, m_scaZ;
+	std::unordered_map<int, int> m_indexByID;
+};
@@ -0,0 +1,85 @@
+#include "SelectionHighlight.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::SimpleMath;
+
+// Fraction the camera's distance has to change by before the fog is adjusted
+#define HIGHLIGHT_FOG_TOLERANCE 0.05f
+
+SelectionHighlight::SelectionHighlight()
+{
+	m_fogDistance = 0.0f;
+	m_changes = 0;
+}
+
+SelectionHighlight::~SelectionHighlight()
+{
+}
+
+void SelectionHighlight::Update(ID3D11Device* device, IEffectFactory& effectFactory, AssetCache& assetCache, const std::shared_ptr<Model>& selected, const Vector3& cameraPosition)
+{
+	if (!selected)
+	{
+		Clear();
+		return;
+	}
+
+	if (selected != m_source)
+	{
+		Clear();
+		m_source = selected;
+		m_highlighted = assetCache.GetModelCopy(device, effectFactory, selected);
+		m_changes++;
+		if (!m_highlighted)
+		{
+			// Drawn unhighlighted rather than trying to load it again every frame
+			return;
+		}
+
+		m_highlighted->UpdateEffects([&](IEffect* effect)
+		{
+			auto fog = dynamic_cast<IEffectFog*>(effect);
+			if (fog)
+			{
+				fog->SetFogEnabled(true);
+				fog->SetFogColor(Colors::HotPink);
+				m_fogs.push_back(fog);
+			}
+		});
+	}
+
+	if (!m_highlighted || m_highlighted->meshes.empty())
+	{
+		return;
+	}
+
+	// Distance from camera to centre of object
+	float distance = Vector3(cameraPosition - m_highlighted->meshes[0]->boundingBox.Center).Length();
+	if (m_fogs.empty() || fabsf(distance - m_fogDistance) <= distance * HIGHLIGHT_FOG_TOLERANCE)
+	{
+		return;
+	}
+	SetFogDistance(distance);
+}
+
+void SelectionHighlight::Clear()
+{
+	// The shared model was never changed, so letting go of the copy is all it takes to restore it. The asset cache keeps
+	// the copy, which is only ever drawn highlighted, for the next time an object with the same model is selected.
+	m_fogs.clear();
+	m_highlighted.reset();
+	m_source.reset();
+	m_fogDistance = 0.0f;
+}
+
+void SelectionHighlight::SetFogDistance(float distance)
+{
+	// dynamically adjust the fog intensity based on distance
+	for (IEffectFog* fog : m_fogs)
+	{
+		fog->SetFogStart(-distance / 2);
+		fog->SetFogEnd(distance * 2);
+	}
+	m_fogDistance = distance;
+}
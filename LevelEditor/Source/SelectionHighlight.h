@@ -0,0 +1,39 @@
+#pragma once
+#include "../pch.h"
+#include "AssetCache.h"
+#include <memory>
+#include <vector>
+
+// Material override for the selected object. Models are shared by every object with the same model and texture, so
+// the highlight goes on the asset cache's copy of the selected object's model, which has effects of its own, and the
+// shared model is never changed. The copy's fog is set up when the selection or the highlight toggle changes, and the
+// copy let go on deselect, which leaves the object drawing with the shared model exactly as before.
+class SelectionHighlight
+{
+public:
+	SelectionHighlight();
+	~SelectionHighlight();
+
+	// Call every frame before drawing with the selected display object's model, or null for no selection or highlights
+	// off. Only the fog distances are refreshed while the selection stays the same, and only once the camera has moved
+	// far enough for them to change.
+	void Update(ID3D11Device* device, DirectX::IEffectFactory& effectFactory, AssetCache& assetCache, const std::shared_ptr<DirectX::Model>& selected, const DirectX::SimpleMath::Vector3& cameraPosition);
+
+	// Draw the selected object with this instead of its shared model, null if there is no highlight
+	const std::shared_ptr<DirectX::Model>& GetModel() const { return m_highlighted; };
+
+	// Times the override was set up, counted so it can be checked that it isn't every frame
+	int GetChanges() const { return m_changes; };
+
+	// Drop the override, e.g. when the device is lost
+	void Clear();
+
+private:
+	void SetFogDistance(float distance);
+
+	std::shared_ptr<DirectX::Model> m_source;			// shared model the override was made from
+	std::shared_ptr<DirectX::Model> m_highlighted;		// copy with the highlight applied
+	std::vector<DirectX::IEffectFog*> m_fogs;			// the copy's fog effects, found once when it's made
+	float m_fogDistance;
+	int m_changes;
+};
@@ -1,7 +1,11 @@
 #include "ToolMain.h"
 #include "../resource.h"
+#include "SceneFields.h"
 #include <vector>
 #include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
 
 //
 //ToolMain Class
@@ -11,7 +15,6 @@ ToolMain::ToolMain()
 	m_currentChunk = 0;		//default value
 	m_selectedObject = 0;	//initial selection ID
 	m_sceneGraph.clear();	//clear the vector for the scenegraph
-	m_databaseConnection = NULL;
 	m_d3dRenderer.SetSelection(&m_selectedObject);
 
 	ZeroMemory(&m_toolInputCommands, sizeof(InputCommands)); // initialise struct to zero
@@ -21,12 +24,30 @@ ToolMain::ToolMain()
 	m_leftClickTimer = 0;
 	m_actionCooldown = 0.25;
 	m_actionCooldownTimer = 0;
+	m_streaming = false;
+	m_chunkCount = 0;
+	m_journalTimer = 0;
+	m_autosaveTimer = 0;
 }
 
 
 ToolMain::~ToolMain()
 {
-	sqlite3_close(m_databaseConnection);		//close the database connection
+	m_chunkManager.Stop();	//stop loading chunks
+	m_saver.Stop();			//finish writing any save in progress
+	UpdateSaveStatus();		//failed saves flag their changes again
+
+	//unsaved edits stay in the journal and are recovered next time
+	JournalEdits();
+	m_journal.Stop();
+
+	//refresh the startup cache if saving has changed the database, as long as there are no edits the database doesn't have
+	if (m_database.IsOpen() && !m_streaming && m_chunkCount <= 1 && !m_d3dRenderer.GetChangeTracker()->HasChanges() && !m_sceneCache.IsCurrent(DATABASE_PATH))
+	{
+		m_sceneCache.Write(DATABASE_PATH, m_sceneGraph);
+	}
+
+	m_database.Close();		//close the database connection
 }
 
 
@@ -45,10 +66,7 @@ void ToolMain::onActionInitialise(HWND handle, int width, int height)
 	
 
 	//database connection establish
-	int rc;
-	rc = sqlite3_open_v2("database/test.db",&m_databaseConnection, SQLITE_OPEN_READWRITE, NULL);
-
-	if (rc) 
+	if (!m_database.Open(DATABASE_PATH))
 	{
 		TRACE("Can't open database");
 		//if the database cant open. Perhaps a more catastrophic error would be better here
@@ -58,230 +76,544 @@ void ToolMain::onActionInitialise(HWND handle, int width, int height)
 		TRACE("Opened database successfully");
 	}
 
+	//spatial index allows loading part of the level, not available if sqlite was built without R*Tree
+	if (m_database.IsOpen() && !m_database.HasSpatialIndex() && !m_database.CreateSpatialIndex())
+	{
+		TRACE("Can't create spatial index, whole level will be loaded");
+	}
+
+	//background saves use their own connection
+	if (!m_saver.Start(DATABASE_PATH))
+	{
+		TRACE("Can't start background saver");
+	}
+
 	onActionLoad();
 }
 
 void ToolMain::onActionLoad()
 {
+	//make sure a save in progress has reached the database before reading it back
+	m_saver.WaitUntilIdle();
+	UpdateSaveStatus();
+
+	//neighbouring chunks are reloaded from scratch
+	m_chunkManager.Stop();
+	m_d3dRenderer.ClearNeighbourChunks();
+
 	//load current chunk and objects into lists
 	if (!m_sceneGraph.empty())		//is the vector empty
 	{
 		m_sceneGraph.clear();		//if not, empty it
 	}
 
-	//SQL
-	int rc;
-	char *sqlCommand;
-	char *ErrMSG = 0;
-	sqlite3_stmt *pResults;								//results of the query
-	sqlite3_stmt *pResultsChunk;
+	// Scene graph will match the database, nothing to save
+	m_d3dRenderer.GetChangeTracker()->Clear();
+
+	//THE WORLD CHUNKS
+	//the chunk being edited is m_currentChunk, or the first one if there isn't a chunk with that ID
+	std::vector<ChunkObject> chunks;
+	m_database.LoadChunks(chunks);
+	if (!chunks.empty())
+	{
+		m_chunk = chunks[0];
+		for (const ChunkObject& chunk : chunks)
+		{
+			if (chunk.ID == m_currentChunk)
+			{
+				m_chunk = chunk;
+			}
+		}
+		m_currentChunk = m_chunk.ID;
+	}
+
+	//in a world of several chunks only the edited chunk's objects are loaded here, the chunk manager loads the rest
+	m_chunkCount = (int)chunks.size();
+	bool multiChunk = m_chunkCount > 1;
+	int chunkFilter = multiChunk ? m_chunk.ID : -1;
 
 	//OBJECTS IN THE WORLD
-	//prepare SQL Text
-	sqlCommand = "SELECT * from Objects";				//sql command which will return all records from the objects table.
-	//Send Command and fill result object
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResults, 0 );
-	
-	//loop for each row in results until there are no more rows.  ie for every row in the results. We create and object
-	while (sqlite3_step(pResults) == SQLITE_ROW)
-	{	
-		SceneObject newSceneObject;
-		newSceneObject.ID = sqlite3_column_int(pResults, 0);
-		newSceneObject.chunk_ID = sqlite3_column_int(pResults, 1);
-		newSceneObject.model_path		= reinterpret_cast<const char*>(sqlite3_column_text(pResults, 2));
-		newSceneObject.tex_diffuse_path = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 3));
-		newSceneObject.posX = sqlite3_column_double(pResults, 4);
-		newSceneObject.posY = sqlite3_column_double(pResults, 5);
-		newSceneObject.posZ = sqlite3_column_double(pResults, 6);
-		newSceneObject.rotX = sqlite3_column_double(pResults, 7);
-		newSceneObject.rotY = sqlite3_column_double(pResults, 8);
-		newSceneObject.rotZ = sqlite3_column_double(pResults, 9);
-		newSceneObject.scaX = sqlite3_column_double(pResults, 10);
-		newSceneObject.scaY = sqlite3_column_double(pResults, 11);
-		newSceneObject.scaZ = sqlite3_column_double(pResults, 12);
-		newSceneObject.render = sqlite3_column_int(pResults, 13);
-		newSceneObject.collision = sqlite3_column_int(pResults, 14);
-		newSceneObject.collision_mesh = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 15));
-		newSceneObject.collectable = sqlite3_column_int(pResults, 16);
-		newSceneObject.destructable = sqlite3_column_int(pResults, 17);
-		newSceneObject.health_amount = sqlite3_column_int(pResults, 18);
-		newSceneObject.editor_render = sqlite3_column_int(pResults, 19);
-		newSceneObject.editor_texture_vis = sqlite3_column_int(pResults, 20);
-		newSceneObject.editor_normals_vis = sqlite3_column_int(pResults, 21);
-		newSceneObject.editor_collision_vis = sqlite3_column_int(pResults, 22);
-		newSceneObject.editor_pivot_vis = sqlite3_column_int(pResults, 23);
-		newSceneObject.pivotX = sqlite3_column_double(pResults, 24);
-		newSceneObject.pivotY = sqlite3_column_double(pResults, 25);
-		newSceneObject.pivotZ = sqlite3_column_double(pResults, 26);
-		newSceneObject.snapToGround = sqlite3_column_int(pResults, 27);
-		newSceneObject.AINode = sqlite3_column_int(pResults, 28);
-		newSceneObject.audio_path = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 29));
-		newSceneObject.volume = sqlite3_column_double(pResults, 30);
-		newSceneObject.pitch = sqlite3_column_double(pResults, 31);
-		newSceneObject.pan = sqlite3_column_int(pResults, 32);
-		newSceneObject.one_shot = sqlite3_column_int(pResults, 33);
-		newSceneObject.play_on_init = sqlite3_column_int(pResults, 34);
-		newSceneObject.play_in_editor = sqlite3_column_int(pResults, 35);
-		newSceneObject.min_dist = sqlite3_column_double(pResults, 36);
-		newSceneObject.max_dist = sqlite3_column_double(pResults, 37);
-		newSceneObject.camera = sqlite3_column_int(pResults, 38);
-		newSceneObject.path_node = sqlite3_column_int(pResults, 39);
-		newSceneObject.path_node_start = sqlite3_column_int(pResults, 40);
-		newSceneObject.path_node_end = sqlite3_column_int(pResults, 41);
-		newSceneObject.parent_id = sqlite3_column_int(pResults, 42);
-		newSceneObject.editor_wireframe = sqlite3_column_int(pResults, 43);
-		newSceneObject.name = reinterpret_cast<const char*>(sqlite3_column_text(pResults, 44));
-
-		newSceneObject.light_type = sqlite3_column_int(pResults, 45);
-		newSceneObject.light_diffuse_r = sqlite3_column_double(pResults, 46);
-		newSceneObject.light_diffuse_g = sqlite3_column_double(pResults, 47);
-		newSceneObject.light_diffuse_b = sqlite3_column_double(pResults, 48);
-		newSceneObject.light_specular_r = sqlite3_column_double(pResults, 49);
-		newSceneObject.light_specular_g = sqlite3_column_double(pResults, 50);
-		newSceneObject.light_specular_b = sqlite3_column_double(pResults, 51);
-		newSceneObject.light_spot_cutoff = sqlite3_column_double(pResults, 52);
-		newSceneObject.light_constant = sqlite3_column_double(pResults, 53);
-		newSceneObject.light_linear = sqlite3_column_double(pResults, 54);
-		newSceneObject.light_quadratic = sqlite3_column_double(pResults, 55);
-	
+	//new objects need IDs above every object in the database, not just the loaded ones
+	m_d3dRenderer.SetStoredTopID(m_database.GetHighestID());
+
+	//big levels only load the objects around the camera, the rest are streamed in as it moves
+	BenchmarkTimer loadTimer;
+	std::wstring loadedFrom;
+	m_streaming = m_database.HasSpatialIndex() && m_database.CountObjects() > STREAMING_MIN_OBJECTS;
+	m_loadedIDs.clear();
+	if (m_streaming)
+	{
+		m_streamCentre = m_d3dRenderer.GetCamera()->GetPosition();
+		SpatialRegion region = SpatialRegion::Around(m_streamCentre.x, m_streamCentre.y, m_streamCentre.z, STREAMING_RADIUS);
+		m_database.LoadObjectsInRegion(region, chunkFilter, m_loadedIDs, m_sceneGraph);
+		loadedFrom = L"around the camera";
+	}
+	else if (multiChunk)
+	{
+		m_database.LoadObjectsInChunk(m_chunk.ID, m_sceneGraph);
+		loadedFrom = L"in chunk " + std::to_wstring(m_chunk.ID);
+	}
+	else if (m_sceneCache.Load(DATABASE_PATH, m_sceneGraph))
+	{
+		//cache matches the database, no need to parse any rows
+		loadedFrom = L"from cache";
+	}
+	else
+	{
+		//only the columns needed to show and move objects, decoded across every core. The rest load when an object is selected.
+		TRACE("Scene cache not used: %s\n", m_sceneCache.GetLastError().c_str());
+		int threads = std::max(1, (int)std::thread::hardware_concurrency());
+		if (!m_database.LoadHotObjects(m_sceneGraph, threads))
+		{
+			TRACE("Can't load objects: %s\n", m_database.GetLastError().c_str());
+		}
+		loadedFrom = L"from database";
 
-		//send completed object to scenegraph
-		m_sceneGraph.push_back(newSceneObject);
-	}
-
-	//THE WORLD CHUNK
-	//prepare SQL Text
-	sqlCommand = "SELECT * from Chunks";				//sql command which will return all records from  chunks table. There is only one tho.
-														//Send Command and fill result object
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResultsChunk, 0);
-
-
-	sqlite3_step(pResultsChunk);
-	m_chunk.ID = sqlite3_column_int(pResultsChunk, 0);
-	m_chunk.name = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 1));
-	m_chunk.chunk_x_size_metres = sqlite3_column_int(pResultsChunk, 2);
-	m_chunk.chunk_y_size_metres = sqlite3_column_int(pResultsChunk, 3);
-	m_chunk.chunk_base_resolution = sqlite3_column_int(pResultsChunk, 4);
-	m_chunk.heightmap_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 5));
-	m_chunk.tex_diffuse_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 6));
-	m_chunk.tex_splat_alpha_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 7));
-	m_chunk.tex_splat_1_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 8));
-	m_chunk.tex_splat_2_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 9));
-	m_chunk.tex_splat_3_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 10));
-	m_chunk.tex_splat_4_path = reinterpret_cast<const char*>(sqlite3_column_text(pResultsChunk, 11));
-	m_chunk.render_wireframe = sqlite3_column_int(pResultsChunk, 12);
-	m_chunk.render_normals = sqlite3_column_int(pResultsChunk, 13);
-	m_chunk.tex_diffuse_tiling = sqlite3_column_int(pResultsChunk, 14);
-	m_chunk.tex_splat_1_tiling = sqlite3_column_int(pResultsChunk, 15);
-	m_chunk.tex_splat_2_tiling = sqlite3_column_int(pResultsChunk, 16);
-	m_chunk.tex_splat_3_tiling = sqlite3_column_int(pResultsChunk, 17);
-	m_chunk.tex_splat_4_tiling = sqlite3_column_int(pResultsChunk, 18);
+		//next startup can skip sql
+		if (!m_sceneCache.Write(DATABASE_PATH, m_sceneGraph))
+		{
+			TRACE("Can't write scene cache: %s\n", m_sceneCache.GetLastError().c_str());
+		}
+	}
+	m_statusMessage = L"Loaded " + std::to_wstring(m_sceneGraph.size()) + L" objects " + loadedFrom + L" in " + std::to_wstring(loadTimer.GetElapsedSeconds()) + L"s";
 
+	for (const SceneObject& object : m_sceneGraph)
+	{
+		m_loadedIDs.insert(object.ID);
+	}
 
 	//Process REsults into renderable
 	m_d3dRenderer.BuildDisplayList(&m_sceneGraph);
+	const AssetCacheStats& assets = m_d3dRenderer.GetAssetCacheStats();
+	m_statusMessage += L", " + std::to_wstring(assets.models) + L" models and " + std::to_wstring(assets.textures) + L" textures";
 	//build the renderable chunk 
 	m_d3dRenderer.BuildDisplayChunk(&m_chunk);
 
 	//setup for object manipulation
 	m_d3dRenderer.SetManipulatorSceneGraph(&m_sceneGraph, &m_selectedObject);
+
+	//edits a previous session didn't save are replayed on the first load, reloading throws unsaved edits away
+	std::vector<JournalRecord> recovered;
+	if (m_journal.IsRunning())
+	{
+		m_journal.Compact(m_journal.GetCheckpoint());
+	}
+	else if (m_database.IsOpen())
+	{
+		if (!m_journal.Start(DATABASE_PATH, recovered))
+		{
+			TRACE("Can't start edit journal: %s\n", m_journal.GetLastError().c_str());
+		}
+		else if (!m_journal.GetLastError().empty())
+		{
+			TRACE("%s\n", m_journal.GetLastError().c_str());
+		}
+	}
+	m_journaledObjects.clear();
+	m_d3dRenderer.GetDisplayChunk()->CopyHeightMap(m_journaledHeightMap);
+	if (!recovered.empty())
+	{
+		RecoverEdits(recovered);
+	}
+
+	//chunks around the edited one are loaded in the background as the camera moves
+	if (multiChunk)
+	{
+		m_chunkManager.Start(DATABASE_PATH, chunks, m_chunk.ID);
+	}
 }
 
-void ToolMain::onActionSave()
+void ToolMain::RecoverEdits(const std::vector<JournalRecord>& records)
 {
-	//SQL
-	int rc;
-	char *sqlCommand;
-	char *ErrMSG = 0;
-	sqlite3_stmt *pResults;								//results of the query
-	
+	SceneChangeTracker* changes = m_d3dRenderer.GetChangeTracker();
+	std::unordered_map<int, size_t> indexByID;
+	for (size_t i = 0; i < m_sceneGraph.size(); i++)
+	{
+		indexByID[m_sceneGraph[i].ID] = i;
+	}
+
+	//records hold absolute values, so replaying them in order gives the state when the last one was written
+	std::unordered_set<int> deleted;
+	std::vector<BYTE> heightMap = m_journaledHeightMap;
+	bool terrainChanged = false;
+	for (const JournalRecord& record : records)
+	{
+		int ID = record.object.ID;
+		auto found = indexByID.find(ID);
 
-	//OBJECTS IN THE WORLD Delete them all
-	//prepare SQL Text
-	sqlCommand = "DELETE FROM Objects";	 //will delete the whole object table.   Slightly risky but hey.
-	rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand, -1, &pResults, 0);
-	sqlite3_step(pResults);
-
-	//Populate with our new objects
-	std::wstring sqlCommand2;
-	int numObjects = m_sceneGraph.size();	//Loop thru the scengraph.
-
-	for (int i = 0; i < numObjects; i++)
-	{
-		std::stringstream command;
-		command << "INSERT INTO Objects " 
-			<<"VALUES(" << m_sceneGraph.at(i).ID << ","
-			<< m_sceneGraph.at(i).chunk_ID  << ","
-			<< "'" << m_sceneGraph.at(i).model_path <<"'" << ","
-			<< "'" << m_sceneGraph.at(i).tex_diffuse_path << "'" << ","
-			<< m_sceneGraph.at(i).posX << ","
-			<< m_sceneGraph.at(i).posY << ","
-			<< m_sceneGraph.at(i).posZ << ","
-			<< m_sceneGraph.at(i).rotX << ","
-			<< m_sceneGraph.at(i).rotY << ","
-			<< m_sceneGraph.at(i).rotZ << ","
-			<< m_sceneGraph.at(i).scaX << ","
-			<< m_sceneGraph.at(i).scaY << ","
-			<< m_sceneGraph.at(i).scaZ << ","
-			<< m_sceneGraph.at(i).render << ","
-			<< m_sceneGraph.at(i).collision << ","
-			<< "'" << m_sceneGraph.at(i).collision_mesh << "'" << ","
-			<< m_sceneGraph.at(i).collectable << ","
-			<< m_sceneGraph.at(i).destructable << ","
-			<< m_sceneGraph.at(i).health_amount << ","
-			<< m_sceneGraph.at(i).editor_render << ","
-			<< m_sceneGraph.at(i).editor_texture_vis << ","
-			<< m_sceneGraph.at(i).editor_normals_vis << ","
-			<< m_sceneGraph.at(i).editor_collision_vis << ","
-			<< m_sceneGraph.at(i).editor_pivot_vis << ","
-			<< m_sceneGraph.at(i).pivotX << ","
-			<< m_sceneGraph.at(i).pivotY << ","
-			<< m_sceneGraph.at(i).pivotZ << ","
-			<< m_sceneGraph.at(i).snapToGround << ","
-			<< m_sceneGraph.at(i).AINode << ","
-			<< "'" << m_sceneGraph.at(i).audio_path << "'" << ","
-			<< m_sceneGraph.at(i).volume << ","
-			<< m_sceneGraph.at(i).pitch << ","
-			<< m_sceneGraph.at(i).pan << ","
-			<< m_sceneGraph.at(i).one_shot << ","
-			<< m_sceneGraph.at(i).play_on_init << ","
-			<< m_sceneGraph.at(i).play_in_editor << ","
-			<< m_sceneGraph.at(i).min_dist << ","
-			<< m_sceneGraph.at(i).max_dist << ","
-			<< m_sceneGraph.at(i).camera << ","
-			<< m_sceneGraph.at(i).path_node << ","
-			<< m_sceneGraph.at(i).path_node_start << ","
-			<< m_sceneGraph.at(i).path_node_end << ","
-			<< m_sceneGraph.at(i).parent_id << ","
-			<< m_sceneGraph.at(i).editor_wireframe << ","
-			<< "'" << m_sceneGraph.at(i).name << "'" << ","
-
-			<< m_sceneGraph.at(i).light_type << ","
-			<< m_sceneGraph.at(i).light_diffuse_r << ","
-			<< m_sceneGraph.at(i).light_diffuse_g << ","
-			<< m_sceneGraph.at(i).light_diffuse_b << ","
-			<< m_sceneGraph.at(i).light_specular_r << ","
-			<< m_sceneGraph.at(i).light_specular_g << ","
-			<< m_sceneGraph.at(i).light_specular_b << ","
-			<< m_sceneGraph.at(i).light_spot_cutoff << ","
-			<< m_sceneGraph.at(i).light_constant << ","
-			<< m_sceneGraph.at(i).light_linear << ","
-			<< m_sceneGraph.at(i).light_quadratic
-
-			<< ")";
-		std::string sqlCommand2 = command.str();
-		rc = sqlite3_prepare_v2(m_databaseConnection, sqlCommand2.c_str(), -1, &pResults, 0);
-		sqlite3_step(pResults);	
+		switch (record.type)
+		{
+		case JournalRecordType::OBJECT:
+			if (found != indexByID.end())
+			{
+				m_sceneGraph[found->second] = record.object;
+			}
+			else
+			{
+				indexByID[ID] = m_sceneGraph.size();
+				m_sceneGraph.push_back(record.object);
+			}
+			deleted.erase(ID);
+			changes->MarkModified(ID);
+			m_loadedIDs.insert(ID);
+			break;
+
+		case JournalRecordType::TRANSFORM:
+			//every object's first record since the last save is a whole one, so only objects streamed out are missed
+			if (found != indexByID.end() && deleted.find(ID) == deleted.end())
+			{
+				SceneObject& object = m_sceneGraph[found->second];
+				CopyFields(object, record.object, SceneObjectFields(), FIELD_TRANSFORM);
+				changes->MarkModified(ID);
+			}
+			break;
+
+		case JournalRecordType::DELETE_OBJECT:
+			deleted.insert(ID);
+			changes->MarkDeleted(ID);
+			m_loadedIDs.insert(ID);
+			break;
+
+		case JournalRecordType::TERRAIN_TILE:
+			if (record.chunkID == m_chunk.ID && heightMap.size() == TERRAINRESOLUTION * TERRAINRESOLUTION)
+			{
+				for (int row = 0; row < JOURNAL_TILE_SIZE; row++)
+				{
+					int start = (record.tileZ * JOURNAL_TILE_SIZE + row) * TERRAINRESOLUTION + record.tileX * JOURNAL_TILE_SIZE;
+					memcpy(&heightMap[start], &record.heights[row * JOURNAL_TILE_SIZE], JOURNAL_TILE_SIZE);
+				}
+				terrainChanged = true;
+			}
+			break;
+		}
+	}
+
+	if (!deleted.empty())
+	{
+		m_sceneGraph.erase(std::remove_if(m_sceneGraph.begin(), m_sceneGraph.end(),
+			[&deleted](const SceneObject& object) { return deleted.find(object.ID) != deleted.end(); }), m_sceneGraph.end());
+	}
+	if (m_selectedObject >= (int)m_sceneGraph.size())
+	{
+		m_selectedObject = -1;
+	}
+	m_d3dRenderer.BuildDisplayList(&m_sceneGraph);
+
+	if (terrainChanged)
+	{
+		m_d3dRenderer.ApplyHeightMap(heightMap);
+		m_journaledHeightMap = heightMap;
 	}
-	
-	m_d3dRenderer.GetDisplayChunk()->SaveHeightMap(); // also save height map
 
-	MessageBox(NULL, L"Objects and terrain saved", L"Notification", MB_OK);
+	//these are in the journal already
+	std::unordered_set<int> journaled;
+	changes->TakeUnjournaled(journaled);
+
+	m_statusMessage += L", recovered " + std::to_wstring(records.size()) + L" unsaved edits";
+}
+
+void ToolMain::JournalEdits()
+{
+	if (!m_journal.IsRunning())
+	{
+		return;
+	}
+
+	// Objects that can't be found have been deleted
+	std::unordered_set<int> IDs;
+	m_d3dRenderer.GetChangeTracker()->TakeUnjournaled(IDs);
+	for (int ID : IDs)
+	{
+		int index;
+		SceneObject* object = m_d3dRenderer.GetObjectByID(ID, index);
+		if (object == nullptr)
+		{
+			m_journal.AppendDelete(ID);
+			m_journaledObjects.erase(ID);
+			continue;
+		}
+
+		auto journaled = m_journaledObjects.find(ID);
+		if (journaled != m_journaledObjects.end() && FieldsEqual(journaled->second, *object, SceneObjectFields(), FIELD_TRANSFORM))
+		{
+			m_journal.AppendTransform(*object);
+		}
+		else
+		{
+			m_journal.AppendObject(*object);
+		}
+		m_journaledObjects[ID] = *object;
+	}
+
+	// Sculpting touches a small area at a time, so only the tiles that differ are written
+	DisplayChunk* chunk = m_d3dRenderer.GetDisplayChunk();
+	if (chunk->IsHeightMapDirty())
+	{
+		std::vector<BYTE> heightMap;
+		chunk->CopyHeightMap(heightMap);
+		if (m_journaledHeightMap.size() != heightMap.size())
+		{
+			m_journaledHeightMap = heightMap;
+			return;
+		}
+
+		int tiles = TERRAINRESOLUTION / JOURNAL_TILE_SIZE;
+		for (int tileZ = 0; tileZ < tiles; tileZ++)
+		{
+			for (int tileX = 0; tileX < tiles; tileX++)
+			{
+				for (int row = 0; row < JOURNAL_TILE_SIZE; row++)
+				{
+					int start = (tileZ * JOURNAL_TILE_SIZE + row) * TERRAINRESOLUTION + tileX * JOURNAL_TILE_SIZE;
+					if (memcmp(&heightMap[start], &m_journaledHeightMap[start], JOURNAL_TILE_SIZE) != 0)
+					{
+						m_journal.AppendTerrainTile(m_chunk.ID, tileX, tileZ, heightMap.data(), TERRAINRESOLUTION);
+						break;
+					}
+				}
+			}
+		}
+		m_journaledHeightMap.swap(heightMap);
+	}
+}
+
+void ToolMain::onActionSave()
+{
+	QueueSave(true, true);
 }
 
 void ToolMain::onActionSaveTerrain()
 {
-	m_d3dRenderer.SaveDisplayChunk(&m_chunk);
+	QueueSave(false, true);
+}
+
+void ToolMain::QueueSave(bool saveObjects, bool saveTerrain)
+{
+	SaveJob job;
+
+	// Journal records up to here are covered by a full save, and can go once it has succeeded.
+	// Objects are journaled whole again after this, so the records that stay don't depend on the ones dropped.
+	JournalEdits();
+	if (saveObjects && saveTerrain && m_journal.IsRunning())
+	{
+		job.checkpoint = m_journal.GetCheckpoint();
+		m_journaledObjects.clear();
+	}
+
+	// Copy only the objects that have changed, so the snapshot is as small as the edit
+	if (saveObjects)
+	{
+		SceneChangeTracker* changes = m_d3dRenderer.GetChangeTracker();
+		const std::unordered_set<int>& modified = changes->GetModified();
+		if (!modified.empty())
+		{
+			for (const SceneObject& object : m_sceneGraph)
+			{
+				if (modified.find(object.ID) != modified.end())
+				{
+					job.objects.push_back(object);
+					m_loadedIDs.insert(object.ID);	//once saved, streaming mustn't load it a second time
+				}
+			}
+		}
+
+		job.changes = *changes;
+		changes->Clear();
+	}
+
+	// Heightmap is small enough to copy whole
+	DisplayChunk* chunk = m_d3dRenderer.GetDisplayChunk();
+	if (saveTerrain && chunk->IsHeightMapDirty())
+	{
+		job.saveHeightMap = true;
+		job.heightMapPath = chunk->GetHeightMapPath();
+		chunk->CopyHeightMap(job.heightMap);
+		chunk->SetHeightMapDirty(false);
+	}
+
+	m_saver.Queue(job);
+	m_statusMessage = L"Saving...";
+}
+
+void ToolMain::UpdateSaveStatus()
+{
+	SaveResult result;
+	while (m_saver.PollResult(result))
+	{
+		if (result.success)
+		{
+			if (result.job.checkpoint > 0)
+			{
+				m_journal.Compact(result.job.checkpoint);
+			}
+			m_statusMessage = L"Saved " + std::to_wstring(result.stats.rows) + L" changed objects in " + std::to_wstring(result.stats.seconds) + L"s (" + std::to_wstring((int)result.stats.GetRowsPerSecond()) + L" rows/s)";
+		}
+		else
+		{
+			m_statusMessage = L"Save failed: " + std::wstring(result.error.begin(), result.error.end());
+
+			// Flag the changes again so the next save retries them, unless they have been superseded since
+			SceneChangeTracker* changes = m_d3dRenderer.GetChangeTracker();
+			for (int ID : result.job.changes.GetDeleted())
+			{
+				if (changes->GetModified().find(ID) == changes->GetModified().end())
+				{
+					changes->MarkDeleted(ID);
+				}
+			}
+			for (int ID : result.job.changes.GetModified())
+			{
+				if (changes->GetDeleted().find(ID) == changes->GetDeleted().end())
+				{
+					changes->MarkModified(ID);
+				}
+			}
+			if (result.job.saveHeightMap)
+			{
+				m_d3dRenderer.GetDisplayChunk()->SetHeightMapDirty(true);
+			}
+		}
+	}
+}
+
+void ToolMain::StreamObjects()
+{
+	// Wait until the camera has moved far enough for a new query to be worthwhile
+	DirectX::SimpleMath::Vector3 camera = m_d3dRenderer.GetCamera()->GetPosition();
+	if (DirectX::SimpleMath::Vector3::Distance(camera, m_streamCentre) < STREAMING_STEP)
+	{
+		return;
+	}
+	m_streamCentre = camera;
+
+	// Release what the camera has left behind so memory stays bounded however far it flies. Neighbouring chunks'
+	// objects are left to UpdateChunks, and anything pinned is kept as it is for chunks.
+	int chunkFilter = m_chunkCount > 1 ? m_chunk.ID : -1;
+	SpatialRegion keepRegion = SpatialRegion::Around(camera.x, camera.y, camera.z, STREAMING_UNLOAD_RADIUS);
+	std::unordered_set<int> keep;
+	GetPinnedIDs(keep);
+	std::vector<int> removed;
+	m_d3dRenderer.RemoveObjects([&](const SceneObject& object)
+	{
+		return (chunkFilter == -1 || object.chunk_ID == chunkFilter) && !keepRegion.Contains(object.posX, object.posY, object.posZ);
+	}, keep, removed);
+	for (int ID : removed)
+	{
+		m_loadedIDs.erase(ID);
+	}
+
+	// Objects already loaded or deleted are skipped by the query
+	int firstNew = m_sceneGraph.size();
+	SpatialRegion region = SpatialRegion::Around(camera.x, camera.y, camera.z, STREAMING_RADIUS);
+	if (m_database.LoadObjectsInRegion(region, chunkFilter, m_loadedIDs, m_sceneGraph) <= 0)
+	{
+		return;
+	}
+
+	for (int i = firstNew; i < (int)m_sceneGraph.size(); i++)
+	{
+		m_loadedIDs.insert(m_sceneGraph[i].ID);
+	}
+
+	// Only the new objects need display objects
+	m_d3dRenderer.AppendDisplayList(&m_sceneGraph, firstNew);
+}
+
+void ToolMain::UpdateChunks()
+{
+	// Queue chunks around the camera and release any that have been evicted
+	DirectX::SimpleMath::Vector3 camera = m_d3dRenderer.GetCamera()->GetPosition();
+	std::vector<int> evicted;
+	m_chunkManager.Update(camera.x, camera.z, evicted);
+
+	std::unordered_set<int> keep;
+	if (!evicted.empty())
+	{
+		GetPinnedIDs(keep);
+	}
+
+	for (int chunkID : evicted)
+	{
+		m_d3dRenderer.RemoveNeighbourChunk(chunkID);
+
+		std::vector<int> removed;
+		m_d3dRenderer.RemoveChunkObjects(chunkID, keep, removed);
+		for (int ID : removed)
+		{
+			m_loadedIDs.erase(ID);
+		}
+	}
+
+	// Build the chunks that have finished loading
+	std::shared_ptr<LoadedChunk> loaded;
+	while (m_chunkManager.PollLoaded(loaded))
+	{
+		if (!loaded->success)
+		{
+			TRACE("Can't load chunk %d: %s\n", loaded->chunk.ID, loaded->error.c_str());
+			continue;
+		}
+
+		float originX, originZ;
+		ChunkManager::GetChunkOrigin(loaded->chunk.ID, originX, originZ);
+		m_d3dRenderer.AddNeighbourChunk(&loaded->chunk, originX, originZ, loaded->heightMap);
+
+		// Skip objects that are still loaded from last time, or that have been deleted but not saved
+		const std::unordered_set<int>& deleted = m_d3dRenderer.GetChangeTracker()->GetDeleted();
+		int firstNew = m_sceneGraph.size();
+		for (const SceneObject& object : loaded->objects)
+		{
+			if (m_loadedIDs.find(object.ID) == m_loadedIDs.end() && deleted.find(object.ID) == deleted.end())
+			{
+				m_sceneGraph.push_back(object);
+				m_loadedIDs.insert(object.ID);
+			}
+		}
+
+		if ((int)m_sceneGraph.size() > firstNew)
+		{
+			m_d3dRenderer.AppendDisplayList(&m_sceneGraph, firstNew);
+		}
+	}
+}
+
+void ToolMain::GetPinnedIDs(std::unordered_set<int>& keep)
+{
+	// Objects with unsaved changes stay loaded, as do those in saves that haven't reported back, which reloading
+	// could read old rows for, and those undo or redo would look for
+	keep = m_d3dRenderer.GetChangeTracker()->GetModified();
+	m_saver.GetSavingIDs(keep);
+	m_d3dRenderer.GetUndoObjectIDs(keep);
+}
+
+void ToolMain::LoadSelectionColdColumns()
+{
+	if (m_selectedObject < 0 || m_selectedObject >= (int)m_sceneGraph.size() || m_sceneGraph[m_selectedObject].coldLoaded)
+	{
+		return;
+	}
+
+	if (!m_database.LoadColdColumns(m_sceneGraph[m_selectedObject]))
+	{
+		TRACE("Can't load object %d: %s\n", m_sceneGraph[m_selectedObject].ID, m_database.GetLastError().c_str());
+	}
+}
+
+std::wstring ToolMain::GetStatusMessage()
+{
+	if (m_saver.IsBusy())
+	{
+		return L"Saving...";
+	}
+
+	// Progress while models stream in after a load
+	int loading = m_d3dRenderer.GetPendingAssetCount();
+	if (loading > 0)
+	{
+		return m_statusMessage + L", " + std::to_wstring(loading) + L" models loading";
+	}
+
+	return m_statusMessage;
 }
 
 void ToolMain::onActionNewObject()
@@ -299,6 +631,7 @@ void ToolMain::onActionDelObject()
 	// if an object is selected, add action and object to undo stacks and delete the object
 	if (m_selectedObject != -1)
 	{
+		LoadSelectionColdColumns();		//undoing the delete after a save needs the whole object
 		m_d3dRenderer.AddAction(Action::REMOVE);
 		m_d3dRenderer.AddToObjectStack(m_sceneGraph.at(m_selectedObject));
 		m_d3dRenderer.DeleteSceneObject(m_selectedObject);
@@ -310,6 +643,7 @@ void ToolMain::onActionCopy()
 	// if an object is selected, copy it
 	if (m_selectedObject != -1)
 	{
+		LoadSelectionColdColumns();		//pasted objects are new rows, so need every column
 		m_haveCopiedObject = true;
 		m_copiedObject = m_sceneGraph[m_selectedObject];
 	}
@@ -335,17 +669,102 @@ void ToolMain::onActionPaste()
 		m_d3dRenderer.AddAction(Action::ADD);
 		m_d3dRenderer.AddToObjectStack(newSceneObject);
 
-		//send completed object to scenegraph
-		m_sceneGraph.push_back(newSceneObject);
+		//send completed object to scenegraph, and flag it for saving
+		int index = m_d3dRenderer.InsertObject(newSceneObject);
+		m_d3dRenderer.GetChangeTracker()->MarkModified(newSceneObject.ID);
 
-		// rebuild display list and select the new object
-		m_d3dRenderer.BuildDisplayList(&m_sceneGraph);
-		m_selectedObject = m_d3dRenderer.GetDisplayList()->size() - 1;
-		m_d3dRenderer.GetManipulator()->SetObject(&m_d3dRenderer.GetDisplayList()->back());
+		// select the new object
+		m_selectedObject = index;
+		m_d3dRenderer.GetManipulator()->SetObject(&m_d3dRenderer.GetDisplayList()->at(index));
 	}
 }
 
 
+void ToolMain::onActionBenchmark()
+{
+	Benchmark benchmark;
+	std::string error;
+
+	// Test level is small, so repeat the scene graph with new IDs until each size is reached
+	int sizes[] = { 100, 1000, 10000 };
+	for (int size : sizes)
+	{
+		std::vector<SceneObject> objects;
+		SceneBenchmark::ReplicateObjects(m_sceneGraph, size, objects);
+		if (!objects.empty() && !SceneBenchmark::RunDatabase(&m_database, "database/benchmark.db", objects, benchmark, error))
+		{
+			MessageBox(NULL, std::wstring(error.begin(), error.end()).c_str(), L"Error", MB_OK);
+			return;
+		}
+	}
+
+	// Scene graph loops only get interesting on much bigger levels
+	int layoutSizes[] = { 100000, 1000000 };
+	for (int size : layoutSizes)
+	{
+		std::vector<SceneObject> objects;
+		SceneBenchmark::ReplicateObjects(m_sceneGraph, size, objects);
+		SceneBenchmark::RunLayouts(objects, benchmark);
+	}
+
+	// Loading every model and texture from disk, as when a level is opened, on one worker and on every core
+	int workerCounts[] = { 1, std::max(1, (int)std::thread::hardware_concurrency()) };
+	for (int workers : workerCounts)
+	{
+		double seconds = m_d3dRenderer.TimeAssetLoad(workers);
+		benchmark.Add("asset_load", std::to_string(workers) + "_threads", (int)m_sceneGraph.size(), seconds);
+	}
+
+	// Rebuilding the whole display list, as on load. Models and textures come from the asset cache.
+	BenchmarkTimer rebuildTimer;
+	m_d3dRenderer.BuildDisplayList(&m_sceneGraph);
+	benchmark.Add("display_list", "rebuild", (int)m_sceneGraph.size(), rebuildTimer.GetElapsedSeconds());
+
+	// Clicking on an object in levels from small to huge, the time is for one pick
+	int pickSizes[] = { 1000, 10000, 100000, 1000000 };
+	for (int pickObjects : pickSizes)
+	{
+		benchmark.Add("picking", "ray", pickObjects, m_d3dRenderer.TimePicking(pickObjects, 1000));
+	}
+
+	// Frames of the current view with nothing selected and with the first object highlighted, the time is for one frame.
+	// Load a generated level to see it on a large scene.
+	if (!m_sceneGraph.empty())
+	{
+		benchmark.Add("render", "frame", (int)m_sceneGraph.size(), m_d3dRenderer.TimeRender(100, -1));
+		benchmark.Add("render", "frame_highlighted", (int)m_sceneGraph.size(), m_d3dRenderer.TimeRender(100, 0));
+	}
+
+	// Single object edits, which keep the display list in step instead of rebuilding it. The probe object isn't saved.
+	if (!m_sceneGraph.empty())
+	{
+		int topID = m_d3dRenderer.m_topID;
+		SceneObject probe = m_sceneGraph.front();
+		probe.ID = topID + 1;
+
+		BenchmarkTimer editTimer;
+		m_d3dRenderer.InsertObject(probe);
+		benchmark.Add("display_list", "insert_one", (int)m_sceneGraph.size(), editTimer.GetElapsedSeconds());
+		editTimer.Start();
+		m_d3dRenderer.UpdateObject(probe.ID);
+		benchmark.Add("display_list", "update_one", (int)m_sceneGraph.size(), editTimer.GetElapsedSeconds());
+		editTimer.Start();
+		m_d3dRenderer.RemoveObject(probe.ID);
+		benchmark.Add("display_list", "remove_one", (int)m_sceneGraph.size(), editTimer.GetElapsedSeconds());
+
+		m_d3dRenderer.m_topID = topID;
+	}
+
+	// Keep results on disk so they can be tracked over time
+	benchmark.WriteCSV("benchmark_results.csv");
+	const AssetCacheStats& assets = m_d3dRenderer.GetAssetCacheStats();
+	std::wstring summary = benchmark.GetSummary();
+	summary += L"Asset cache: " + std::to_wstring(assets.models) + L" models (" + std::to_wstring(assets.modelBytes / 1024) + L" KB), "
+		+ std::to_wstring(assets.textures) + L" textures (" + std::to_wstring(assets.textureBytes / 1024) + L" KB), "
+		+ std::to_wstring(assets.modelHits) + L" model hits, " + std::to_wstring(assets.modelMisses) + L" misses";
+	MessageBox(NULL, summary.c_str(), L"Benchmark", MB_OK);
+}
+
 void ToolMain::Tick(MSG *msg)
 {
 	//do we have a selection
@@ -359,9 +778,44 @@ void ToolMain::Tick(MSG *msg)
 	
 	
 
+	// the object dialog, manipulator and undo stacks all work on the selection, so give it every column before they see it
+	LoadSelectionColdColumns();
+
 	//Renderer Update Call
 	m_d3dRenderer.Tick(&m_toolInputCommands);
 
+	// pick up finished background saves
+	UpdateSaveStatus();
+
+	// journal edits a few times a second, the journal syncs them to disk in the background
+	m_journalTimer += m_d3dRenderer.GetDeltaTime();
+	if (m_journalTimer >= JOURNAL_EDIT_INTERVAL)
+	{
+		m_journalTimer = 0;
+		JournalEdits();
+	}
+
+	// save unsaved changes every so often, unless a save is already running
+	m_autosaveTimer += m_d3dRenderer.GetDeltaTime();
+	if (m_autosaveTimer >= AUTOSAVE_INTERVAL)
+	{
+		m_autosaveTimer = 0;
+		if (m_database.IsOpen() && !m_saver.IsBusy() && (m_d3dRenderer.GetChangeTracker()->HasChanges() || m_d3dRenderer.GetDisplayChunk()->IsHeightMapDirty()))
+		{
+			QueueSave(true, true);
+		}
+	}
+
+	// load more of the level if the camera has moved
+	if (m_streaming)
+	{
+		StreamObjects();
+	}
+	if (m_chunkManager.IsRunning())
+	{
+		UpdateChunks();
+	}
+
 	// increment timers
 	m_leftClickTimer += m_d3dRenderer.GetDeltaTime();
 	m_actionCooldownTimer += m_d3dRenderer.GetDeltaTime();
@@ -566,6 +1020,17 @@ void ToolMain::UpdateInput(MSG * msg)
 		onActionCopy();
 	}
 
+	// run benchmarks
+	if (m_keyArray['B'] && m_toolInputCommands.ctrl)
+	{
+		if (m_actionCooldownTimer > m_actionCooldown)
+		{
+			m_actionCooldownTimer = 0;
+			m_keyArray['B'] = false;
+			onActionBenchmark();
+		}
+	}
+
 	// paste object
 	if (m_keyArray['V'] && m_toolInputCommands.ctrl)
 	{
@@ -5,8 +5,31 @@
 #include "Game.h"
 #include "../sqlite3.h"
 #include "SceneObject.h"
+#include "SceneDatabase.h"
+#include "SceneSaver.h"
+#include "SceneCache.h"
+#include "ChunkManager.h"
+#include "SceneBenchmark.h"
+#include "EditJournal.h"
 #include "InputCommands.h"
 #include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+// Level database, the startup cache is written next to it
+#define DATABASE_PATH "database/test.db"
+
+// Levels with more objects than this only load the area around the camera, if the database has a spatial index
+#define STREAMING_MIN_OBJECTS 5000
+#define STREAMING_RADIUS 200.0f		// half the size of the box loaded around the camera
+#define STREAMING_STEP 50.0f		// distance the camera moves before more objects are loaded
+#define STREAMING_UNLOAD_RADIUS 300.0f	// objects further than this are released, beyond the load box so turning back doesn't reload them
+
+// Edits are journaled this often in seconds, so dragging an object writes a few records rather than one a frame
+#define JOURNAL_EDIT_INTERVAL 0.25f
+
+// Unsaved changes are saved automatically this often, in seconds
+#define AUTOSAVE_INTERVAL 120.0f
 
 class ToolMain
 {
@@ -24,6 +47,7 @@ public: //methods
 	afx_msg void	onActionDelObject();									//delete selected object
 	afx_msg void	onActionCopy();											//copy object
 	afx_msg void	onActionPaste();										//paste object
+	afx_msg void	onActionBenchmark();									//time tool operations and write the results to file
 
 	void	Tick(MSG *msg);
 	void	UpdateInput(MSG *msg);
@@ -31,6 +55,9 @@ public: //methods
 	// getter for game
 	Game*	GetGame() { return &m_d3dRenderer; };
 
+	// result of the last load or save, for the status bar
+	std::wstring GetStatusMessage();
+
 public:	//variables
 	std::vector<SceneObject>    m_sceneGraph;	//our scenegraph storing all the objects in the current chunk
 	ChunkObject					m_chunk;		//our landscape chunk
@@ -38,6 +65,14 @@ public:	//variables
 
 private:	//methods
 	void	onContentAdded();
+	void	QueueSave(bool saveObjects, bool saveTerrain);		//snapshot changes and hand them to the background saver
+	void	UpdateSaveStatus();									//collect results from the background saver
+	void	StreamObjects();									//load objects around the camera as it moves
+	void	UpdateChunks();										//load and unload neighbouring chunks as the camera moves
+	void	GetPinnedIDs(std::unordered_set<int>& keep);		//objects that mustn't be unloaded, see UpdateChunks
+	void	LoadSelectionColdColumns();						//read the columns a lazy load skipped for the selected object
+	void	JournalEdits();										//append edits made since the last call to the edit journal
+	void	RecoverEdits(const std::vector<JournalRecord>& records);	//replay edits a previous session didn't save
 
 	
 		
@@ -47,7 +82,26 @@ private:	//variables
 	InputCommands m_toolInputCommands;		//input commands that we want to use and possibly pass over to the renderer
 	CRect	WindowRECT;		//Window area rectangle. 
 	char	m_keyArray[256];
-	sqlite3 *m_databaseConnection;	//sqldatabase handle
+	SceneDatabase m_database;	//sqldatabase connection
+	SceneSaver m_saver;			//writes saves on a background thread
+	SceneCache m_sceneCache;	//binary copy of the scene graph for fast startup
+	std::wstring m_statusMessage;	//result of the last load or save
+
+	// Partial loading
+	bool m_streaming;							//only part of the level is loaded
+	std::unordered_set<int> m_loadedIDs;		//every object ID that is in the scene graph or has been deleted from it
+	DirectX::SimpleMath::Vector3 m_streamCentre;	//camera position when objects were last loaded
+
+	// Multi chunk worlds
+	ChunkManager m_chunkManager;				//loads the chunks around the one being edited
+	int m_chunkCount;							//rows in the Chunks table
+
+	// Crash recovery
+	EditJournal m_journal;									//unsaved edits, on disk next to the database
+	std::unordered_map<int, SceneObject> m_journaledObjects;	//state last journaled, so a move only needs a transform record
+	std::vector<BYTE> m_journaledHeightMap;					//heightmap as last journaled, changed tiles are found by comparing with it
+	float m_journalTimer;
+	float m_autosaveTimer;
 
 	int m_width;		//dimensions passed to directX
 	int m_height;
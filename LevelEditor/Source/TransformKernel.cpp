@@ -0,0 +1,389 @@
+#include "TransformKernel.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORM_KERNEL_SSE2
+#include <emmintrin.h>
+#endif
+
+#define DEGREES_TO_RADIANS 0.0174532925f
+
+// Below this many objects a thread isn't worth starting
+#define TRANSFORM_MIN_CHUNK 16384
+
+// One object, written the way SimpleMath builds it: a quaternion from yaw, pitch and roll turned into a rotation
+// matrix, scaled row by row and translated
+static void BuildObject(const TransformInput& input, int i, const TransformOutput& output)
+{
+	float halfPitch = input.rotX[i] * DEGREES_TO_RADIANS * 0.5f;
+	float halfYaw = input.rotY[i] * DEGREES_TO_RADIANS * 0.5f;
+	float halfRoll = input.rotZ[i] * DEGREES_TO_RADIANS * 0.5f;
+	float sp = sinf(halfPitch), cp = cosf(halfPitch);
+	float sy = sinf(halfYaw), cy = cosf(halfYaw);
+	float sr = sinf(halfRoll), cr = cosf(halfRoll);
+
+	float x = sp * cy * cr + cp * sy * sr;
+	float y = cp * sy * cr - sp * cy * sr;
+	float z = cp * cy * sr - sp * sy * cr;
+	float w = cp * cy * cr + sp * sy * sr;
+
+	float scale[3] = { input.scaX[i], input.scaY[i], input.scaZ[i] };
+	float rotation[3][3] = {
+		{ 1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w) },
+		{ 2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w) },
+		{ 2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y) } };
+	float translation[3] = { input.posX[i], input.posY[i], input.posZ[i] };
+
+	float world[3][3];
+	for (int row = 0; row < 3; row++)
+	{
+		for (int column = 0; column < 3; column++)
+		{
+			world[row][column] = rotation[row][column] * scale[row];
+		}
+	}
+
+	if (output.worlds)
+	{
+		float* matrix = output.worlds + (size_t)i * 16;
+		for (int row = 0; row < 3; row++)
+		{
+			matrix[row * 4 + 0] = world[row][0];
+			matrix[row * 4 + 1] = world[row][1];
+			matrix[row * 4 + 2] = world[row][2];
+			matrix[row * 4 + 3] = 0.0f;
+		}
+		matrix[12] = translation[0];
+		matrix[13] = translation[1];
+		matrix[14] = translation[2];
+		matrix[15] = 1.0f;
+	}
+
+	// Undoing the translation, then the rotation with its transpose, then the scale
+	if (output.inverses)
+	{
+		float inverseScale[3] = { 1.0f / scale[0], 1.0f / scale[1], 1.0f / scale[2] };
+		float* matrix = output.inverses + (size_t)i * 16;
+		for (int row = 0; row < 3; row++)
+		{
+			matrix[row * 4 + 0] = rotation[0][row] * inverseScale[0];
+			matrix[row * 4 + 1] = rotation[1][row] * inverseScale[1];
+			matrix[row * 4 + 2] = rotation[2][row] * inverseScale[2];
+			matrix[row * 4 + 3] = 0.0f;
+		}
+		for (int column = 0; column < 3; column++)
+		{
+			matrix[12 + column] = -(translation[0] * matrix[column] + translation[1] * matrix[4 + column] + translation[2] * matrix[8 + column]);
+		}
+		matrix[15] = 1.0f;
+	}
+
+	// World box around the transformed local box, each world axis takes the local extents along it
+	if (output.boxes)
+	{
+		float center[3] = { 0.0f, 0.0f, 0.0f };
+		float extents[3] = { 0.0f, 0.0f, 0.0f };
+		if (input.localMinX)
+		{
+			float localMin[3] = { input.localMinX[i], input.localMinY[i], input.localMinZ[i] };
+			float localMax[3] = { input.localMaxX[i], input.localMaxY[i], input.localMaxZ[i] };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				center[axis] = (localMin[axis] + localMax[axis]) * 0.5f;
+				extents[axis] = (localMax[axis] - localMin[axis]) * 0.5f;
+			}
+		}
+
+		float* box = output.boxes + (size_t)i * 6;
+		for (int column = 0; column < 3; column++)
+		{
+			float worldCenter = translation[column] + center[0] * world[0][column] + center[1] * world[1][column] + center[2] * world[2][column];
+			float worldExtent = extents[0] * fabsf(world[0][column]) + extents[1] * fabsf(world[1][column]) + extents[2] * fabsf(world[2][column]);
+			box[column] = worldCenter - worldExtent;
+			box[3 + column] = worldCenter + worldExtent;
+		}
+	}
+}
+
+void TransformKernel::BuildScalar(const TransformInput& input, int first, int count, const TransformOutput& output)
+{
+	for (int i = first; i < first + count; i++)
+	{
+		BuildObject(input, i, output);
+	}
+}
+
+#ifdef TRANSFORM_KERNEL_SSE2
+
+// Sine and cosine of four angles at once, reduced to [-pi/2, pi/2] then the same minimax polynomials DirectXMath's
+// XMVectorSinCos uses
+static void SinCos(__m128 angles, __m128& sines, __m128& cosines)
+{
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 pi = _mm_set1_ps(3.141592654f);
+	const __m128 halfPi = _mm_set1_ps(1.570796327f);
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	// Into [-pi, pi]
+	__m128 turns = _mm_mul_ps(angles, _mm_set1_ps(0.159154943f));
+	turns = _mm_cvtepi32_ps(_mm_cvtps_epi32(turns));
+	__m128 x = _mm_sub_ps(angles, _mm_mul_ps(turns, _mm_set1_ps(6.283185307f)));
+
+	// Reflected into [-pi/2, pi/2], where sin stays the same and cos flips
+	__m128 sign = _mm_and_ps(x, signMask);
+	__m128 reflected = _mm_sub_ps(_mm_or_ps(pi, sign), x);
+	__m128 inRange = _mm_cmple_ps(_mm_andnot_ps(signMask, x), halfPi);
+	x = _mm_or_ps(_mm_and_ps(inRange, x), _mm_andnot_ps(inRange, reflected));
+	__m128 cosineSign = _mm_or_ps(_mm_and_ps(inRange, one), _mm_andnot_ps(inRange, _mm_set1_ps(-1.0f)));
+
+	__m128 x2 = _mm_mul_ps(x, x);
+
+	__m128 sine = _mm_set1_ps(-2.3889859e-08f);
+	sine = _mm_add_ps(_mm_mul_ps(sine, x2), _mm_set1_ps(2.7525562e-06f));
+	sine = _mm_add_ps(_mm_mul_ps(sine, x2), _mm_set1_ps(-0.00019840874f));
+	sine = _mm_add_ps(_mm_mul_ps(sine, x2), _mm_set1_ps(0.0083333310f));
+	sine = _mm_add_ps(_mm_mul_ps(sine, x2), _mm_set1_ps(-0.16666667f));
+	sine = _mm_add_ps(_mm_mul_ps(sine, x2), one);
+	sines = _mm_mul_ps(sine, x);
+
+	__m128 cosine = _mm_set1_ps(-2.6051615e-07f);
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, x2), _mm_set1_ps(2.4760495e-05f));
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, x2), _mm_set1_ps(-0.0013888378f));
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, x2), _mm_set1_ps(0.041666638f));
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, x2), _mm_set1_ps(-0.5f));
+	cosine = _mm_add_ps(_mm_mul_ps(cosine, x2), one);
+	cosines = _mm_mul_ps(cosine, cosineSign);
+}
+
+// values[k] holds element k of four objects' matrices, written out as four whole matrices
+static void StoreMatrices(float* matrices, __m128 values[16])
+{
+	for (int row = 0; row < 4; row++)
+	{
+		__m128 a = values[row * 4 + 0];
+		__m128 b = values[row * 4 + 1];
+		__m128 c = values[row * 4 + 2];
+		__m128 d = values[row * 4 + 3];
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		_mm_storeu_ps(matrices + 0 * 16 + row * 4, a);
+		_mm_storeu_ps(matrices + 1 * 16 + row * 4, b);
+		_mm_storeu_ps(matrices + 2 * 16 + row * 4, c);
+		_mm_storeu_ps(matrices + 3 * 16 + row * 4, d);
+	}
+}
+
+// As StoreMatrices for four objects' boxes of six floats
+static void StoreBoxes(float* boxes, __m128 values[6])
+{
+	__m128 a = values[0], b = values[1], c = values[2], d = values[3];
+	_MM_TRANSPOSE4_PS(a, b, c, d);
+	__m128 e = values[4], f = values[5], g = _mm_setzero_ps(), h = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(e, f, g, h);
+
+	_mm_storeu_ps(boxes + 0, a);
+	_mm_storel_pi(reinterpret_cast<__m64*>(boxes + 4), e);
+	_mm_storeu_ps(boxes + 6, b);
+	_mm_storel_pi(reinterpret_cast<__m64*>(boxes + 10), f);
+	_mm_storeu_ps(boxes + 12, c);
+	_mm_storel_pi(reinterpret_cast<__m64*>(boxes + 16), g);
+	_mm_storeu_ps(boxes + 18, d);
+	_mm_storel_pi(reinterpret_cast<__m64*>(boxes + 22), h);
+}
+
+void TransformKernel::BuildSimd(const TransformInput& input, int first, int count, const TransformOutput& output)
+{
+	const __m128 halfRadians = _mm_set1_ps(DEGREES_TO_RADIANS * 0.5f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+
+	int i = first;
+	int simdEnd = first + (count & ~3);
+	for (; i < simdEnd; i += 4)
+	{
+		__m128 sp, cp, sy, cy, sr, cr;
+		SinCos(_mm_mul_ps(_mm_loadu_ps(input.rotX + i), halfRadians), sp, cp);
+		SinCos(_mm_mul_ps(_mm_loadu_ps(input.rotY + i), halfRadians), sy, cy);
+		SinCos(_mm_mul_ps(_mm_loadu_ps(input.rotZ + i), halfRadians), sr, cr);
+
+		__m128 cpcy = _mm_mul_ps(cp, cy), spsy = _mm_mul_ps(sp, sy);
+		__m128 spcy = _mm_mul_ps(sp, cy), cpsy = _mm_mul_ps(cp, sy);
+		__m128 x = _mm_add_ps(_mm_mul_ps(spcy, cr), _mm_mul_ps(cpsy, sr));
+		__m128 y = _mm_sub_ps(_mm_mul_ps(cpsy, cr), _mm_mul_ps(spcy, sr));
+		__m128 z = _mm_sub_ps(_mm_mul_ps(cpcy, sr), _mm_mul_ps(spsy, cr));
+		__m128 w = _mm_add_ps(_mm_mul_ps(cpcy, cr), _mm_mul_ps(spsy, sr));
+
+		__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		__m128 xw = _mm_mul_ps(x, w), yw = _mm_mul_ps(y, w), zw = _mm_mul_ps(z, w);
+
+		__m128 rotation[3][3] = {
+			{ _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, zw)), _mm_mul_ps(two, _mm_sub_ps(xz, yw)) },
+			{ _mm_mul_ps(two, _mm_sub_ps(xy, zw)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), _mm_mul_ps(two, _mm_add_ps(yz, xw)) },
+			{ _mm_mul_ps(two, _mm_add_ps(xz, yw)), _mm_mul_ps(two, _mm_sub_ps(yz, xw)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))) } };
+		__m128 scale[3] = { _mm_loadu_ps(input.scaX + i), _mm_loadu_ps(input.scaY + i), _mm_loadu_ps(input.scaZ + i) };
+		__m128 translation[3] = { _mm_loadu_ps(input.posX + i), _mm_loadu_ps(input.posY + i), _mm_loadu_ps(input.posZ + i) };
+
+		__m128 world[3][3];
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 3; column++)
+			{
+				world[row][column] = _mm_mul_ps(rotation[row][column], scale[row]);
+			}
+		}
+
+		if (output.worlds)
+		{
+			__m128 values[16] = {
+				world[0][0], world[0][1], world[0][2], zero,
+				world[1][0], world[1][1], world[1][2], zero,
+				world[2][0], world[2][1], world[2][2], zero,
+				translation[0], translation[1], translation[2], one };
+			StoreMatrices(output.worlds + (size_t)i * 16, values);
+		}
+
+		if (output.inverses)
+		{
+			__m128 inverseScale[3] = { _mm_div_ps(one, scale[0]), _mm_div_ps(one, scale[1]), _mm_div_ps(one, scale[2]) };
+			__m128 inverse[3][3];
+			for (int row = 0; row < 3; row++)
+			{
+				for (int column = 0; column < 3; column++)
+				{
+					inverse[row][column] = _mm_mul_ps(rotation[column][row], inverseScale[column]);
+				}
+			}
+
+			__m128 inverseTranslation[3];
+			for (int column = 0; column < 3; column++)
+			{
+				__m128 sum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(translation[0], inverse[0][column]), _mm_mul_ps(translation[1], inverse[1][column])),
+					_mm_mul_ps(translation[2], inverse[2][column]));
+				inverseTranslation[column] = _mm_xor_ps(sum, signMask);
+			}
+
+			__m128 values[16] = {
+				inverse[0][0], inverse[0][1], inverse[0][2], zero,
+				inverse[1][0], inverse[1][1], inverse[1][2], zero,
+				inverse[2][0], inverse[2][1], inverse[2][2], zero,
+				inverseTranslation[0], inverseTranslation[1], inverseTranslation[2], one };
+			StoreMatrices(output.inverses + (size_t)i * 16, values);
+		}
+
+		if (output.boxes)
+		{
+			__m128 center[3] = { zero, zero, zero };
+			__m128 extents[3] = { zero, zero, zero };
+			if (input.localMinX)
+			{
+				__m128 localMin[3] = { _mm_loadu_ps(input.localMinX + i), _mm_loadu_ps(input.localMinY + i), _mm_loadu_ps(input.localMinZ + i) };
+				__m128 localMax[3] = { _mm_loadu_ps(input.localMaxX + i), _mm_loadu_ps(input.localMaxY + i), _mm_loadu_ps(input.localMaxZ + i) };
+				for (int axis = 0; axis < 3; axis++)
+				{
+					center[axis] = _mm_mul_ps(_mm_add_ps(localMin[axis], localMax[axis]), half);
+					extents[axis] = _mm_mul_ps(_mm_sub_ps(localMax[axis], localMin[axis]), half);
+				}
+			}
+
+			__m128 values[6];
+			for (int column = 0; column < 3; column++)
+			{
+				__m128 worldCenter = _mm_add_ps(translation[column], _mm_add_ps(_mm_add_ps(_mm_mul_ps(center[0], world[0][column]), _mm_mul_ps(center[1], world[1][column])),
+					_mm_mul_ps(center[2], world[2][column])));
+				__m128 worldExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extents[0], _mm_andnot_ps(signMask, world[0][column])), _mm_mul_ps(extents[1], _mm_andnot_ps(signMask, world[1][column]))),
+					_mm_mul_ps(extents[2], _mm_andnot_ps(signMask, world[2][column])));
+				values[column] = _mm_sub_ps(worldCenter, worldExtent);
+				values[3 + column] = _mm_add_ps(worldCenter, worldExtent);
+			}
+			StoreBoxes(output.boxes + (size_t)i * 6, values);
+		}
+	}
+
+	// Fewer than four left
+	BuildScalar(input, i, first + count - i, output);
+}
+
+bool TransformKernel::HasSimd()
+{
+	return true;
+}
+
+#else
+
+void TransformKernel::BuildSimd(const TransformInput& input, int first, int count, const TransformOutput& output)
+{
+	BuildScalar(input, first, count, output);
+}
+
+bool TransformKernel::HasSimd()
+{
+	return false;
+}
+
+#endif
+
+void TransformKernel::Build(const TransformInput& input, int count, const TransformOutput& output, int threadCount)
+{
+	threadCount = std::max(1, std::min(threadCount, count / TRANSFORM_MIN_CHUNK));
+	if (threadCount == 1)
+	{
+		BuildSimd(input, 0, count, output);
+		return;
+	}
+
+	// Chunks are whole groups of four so only the last one has a scalar tail
+	int chunkSize = ((count / threadCount) + 3) & ~3;
+	std::vector<std::thread> workers;
+	for (int first = 0; first < count; first += chunkSize)
+	{
+		int chunkCount = std::min(chunkSize, count - first);
+		workers.push_back(std::thread([&input, &output, first, chunkCount]()
+		{
+			BuildSimd(input, first, chunkCount, output);
+		}));
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+float TransformKernel::Compare(const TransformInput& input, int count)
+{
+	std::vector<float> scalarValues[3] = { std::vector<float>((size_t)count * 16), std::vector<float>((size_t)count * 16), std::vector<float>((size_t)count * 6) };
+	std::vector<float> simdValues[3] = { std::vector<float>((size_t)count * 16), std::vector<float>((size_t)count * 16), std::vector<float>((size_t)count * 6) };
+
+	TransformOutput scalarOutput = { scalarValues[0].data(), scalarValues[1].data(), scalarValues[2].data() };
+	TransformOutput simdOutput = { simdValues[0].data(), simdValues[1].data(), simdValues[2].data() };
+	BuildScalar(input, 0, count, scalarOutput);
+	BuildSimd(input, 0, count, simdOutput);
+
+	// Relative to the largest value in the object's matrix or box, entries summed from big terms carry their rounding
+	float largest = 0.0f;
+	int stride[3] = { 16, 16, 6 };
+	for (int output = 0; output < 3; output++)
+	{
+		for (int object = 0; object < count; object++)
+		{
+			const float* scalar = &scalarValues[output][(size_t)object * stride[output]];
+			const float* simd = &simdValues[output][(size_t)object * stride[output]];
+			float size = 1.0f;
+			for (int i = 0; i < stride[output]; i++)
+			{
+				size = std::max(size, fabsf(scalar[i]));
+			}
+			for (int i = 0; i < stride[output]; i++)
+			{
+				largest = std::max(largest, fabsf(scalar[i] - simd[i]) / size);
+			}
+		}
+	}
+	return largest;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// Per object transform data, one array per field like SceneStore's hot arrays. Rotations are in degrees.
+// The local bounds arrays may be null, the world boxes are then taken around the objects' origins.
+struct TransformInput
+{
+	const float* posX; const float* posY; const float* posZ;
+	const float* rotX; const float* rotY; const float* rotZ;
+	const float* scaX; const float* scaY; const float* scaZ;
+	const float* localMinX; const float* localMinY; const float* localMinZ;
+	const float* localMaxX; const float* localMaxY; const float* localMaxZ;
+};
+
+// Where results go, any can be null if they aren't wanted. Matrices are 16 floats per object, row major for row vectors
+// like SimpleMath::Matrix. Boxes are 6 floats per object, min x, y, z then max x, y, z, the layout AabbTree::Build takes.
+struct TransformOutput
+{
+	float* worlds;
+	float* inverses;
+	float* boxes;
+};
+
+// Builds world matrices, their inverses and world boxes for many objects at once, the same transform DisplayObject
+// caches: scale, then yaw/pitch/roll rotation, then translation. BuildSimd does four objects per step with SSE2
+// and Build splits the objects across threads. BuildScalar is the reference the SIMD path is checked against.
+class TransformKernel
+{
+public:
+	// Objects [first, first + count)
+	static void BuildScalar(const TransformInput& input, int first, int count, const TransformOutput& output);
+	static void BuildSimd(const TransformInput& input, int first, int count, const TransformOutput& output);
+
+	// All count objects, split into chunks across threadCount threads
+	static void Build(const TransformInput& input, int count, const TransformOutput& output, int threadCount);
+
+	// False if BuildSimd falls back to BuildScalar on this build
+	static bool HasSimd();
+
+	// Largest difference between the two paths' results over the objects, relative to the values, for checking the SIMD path
+	static float Compare(const TransformInput& input, int count);
+};